@@ -86,6 +86,8 @@ widgetHandler = {
 
   globals = {}, -- global vars/funcs
 
+  unitCallInFilters = {}, -- callin name ==> { widget ==> filter }
+
   mouseOwner = nil,
   ownedButton = 0,
 
@@ -537,6 +539,9 @@ function widgetHandler:NewWidget()
   wh.RemoveCallIn = function (_, name)
     self:RemoveWidgetCallIn(name, widget)
   end
+  wh.SetUnitCallInFilter = function (_, name, filter)
+    return self:SetWidgetUnitCallInFilter(name, widget, filter)
+  end
 
   wh.AddAction    = function (_, cmd, func, data, types)
     return self.actionHandler:AddAction(widget, cmd, func, data, types)
@@ -784,6 +789,9 @@ function widgetHandler:RemoveWidget(widget)
   for _,listname in ipairs(callInLists) do
     ArrayRemove(self[listname..'List'], widget)
   end
+  for _,filters in pairs(self.unitCallInFilters) do
+    filters[widget] = nil
+  end
   self:UpdateCallIns()
 
   if (widget.whInfo.basename == SELECTOR_BASENAME) then
@@ -814,6 +822,44 @@ function widgetHandler:UpdateCallIn(name)
     _G[name] = nil
   end
   Script.UpdateCallIn(name)
+  self:UpdateUnitCallInFilter(name)
+end
+
+
+--  The engine skips per-unit call-ins for units that match none of the
+--  filters it was given. Widget filters are combined (union), and only
+--  handed over if every widget implementing the call-in has one, so a
+--  widget without a filter still sees all units. A widget can be called
+--  for units outside its own filter if another widget's filter admits them.
+
+function widgetHandler:SetWidgetUnitCallInFilter(name, w, filter)
+  local filters = self.unitCallInFilters[name]
+  if (filters == nil) then
+    filters = {}
+    self.unitCallInFilters[name] = filters
+  end
+  filters[w] = filter
+  return self:UpdateUnitCallInFilter(name)
+end
+
+
+function widgetHandler:UpdateUnitCallInFilter(name)
+  local filters = self.unitCallInFilters[name]
+  if (filters == nil) then
+    return false
+  end
+
+  local combined = {}
+  for _,w in ipairs(self[name .. 'List']) do
+    local filter = filters[w]
+    if (filter == nil) then
+      combined = nil
+      break
+    end
+    combined[#combined + 1] = filter
+  end
+
+  return Script.SetUnitCallInFilter(name, combined)
 end
 
 
@@ -74,6 +74,8 @@ gadgetHandler = {
 
   CMDIDs = {},
 
+  unitCallInFilters = {}, -- callin name ==> { gadget ==> filter }
+
   xViewSize    = 1,
   yViewSize    = 1,
   xViewSizeOld = 1,
@@ -304,6 +306,9 @@ function gadgetHandler:NewGadget()
   gh.RemoveCallIn = function (_, name)
     self:RemoveGadgetCallIn(name, gadget)
   end
+  gh.SetUnitCallInFilter = function (_, name, filter)
+    return self:SetGadgetUnitCallInFilter(name, gadget, filter)
+  end
 
   gh.RegisterCMDID = function(_, id)
     self:RegisterCMDID(gadget, id)
@@ -505,6 +510,9 @@ function gadgetHandler:RemoveGadget(gadget)
   for _,listname in ipairs(CALLIN_LIST) do
     ArrayRemove(self[listname..'List'], gadget)
   end
+  for _,filters in pairs(self.unitCallInFilters) do
+    filters[gadget] = nil
+  end
 
   for id,g in pairs(self.CMDIDs) do
     if (g == gadget) then
@@ -537,6 +545,44 @@ function gadgetHandler:UpdateCallIn(name)
   end
 
   Script.UpdateCallIn(name)
+  self:UpdateUnitCallInFilter(name)
+end
+
+
+--  The engine skips per-unit call-ins for units that match none of the
+--  filters it was given. Gadget filters are combined (union), and only
+--  handed over if every gadget implementing the call-in has one, so a
+--  gadget without a filter still sees all units. A gadget can be called
+--  for units outside its own filter if another gadget's filter admits them.
+
+function gadgetHandler:SetGadgetUnitCallInFilter(name, g, filter)
+  local filters = self.unitCallInFilters[name]
+  if (filters == nil) then
+    filters = {}
+    self.unitCallInFilters[name] = filters
+  end
+  filters[g] = filter
+  return self:UpdateUnitCallInFilter(name)
+end
+
+
+function gadgetHandler:UpdateUnitCallInFilter(name)
+  local filters = self.unitCallInFilters[name]
+  if (filters == nil) then
+    return false
+  end
+
+  local combined = {}
+  for _,g in ipairs(self[name .. 'List']) do
+    local filter = filters[g]
+    if (filter == nil) then
+      combined = nil
+      break
+    end
+    combined[#combined + 1] = filter
+  end
+
+  return Script.SetUnitCallInFilter(name, combined)
 end
 
 
@@ -17,7 +17,9 @@ CONFIG(std::string, HostIPDefault).defaultValue("localhost").dedicatedValue("").
 CONFIG(int, HostPortDefault).defaultValue(8452).minimumValue(0).maximumValue(65535).description("Default Port to use for hosting if not specified in script.txt");
 
 ClientSetup::ClientSetup()
-	: hostIP(configHandler->GetString("HostIPDefault"))
+	: demoKeyFrame(-1)
+	, demoSkipFrame(-1)
+	, hostIP(configHandler->GetString("HostIPDefault"))
 	, hostPort(configHandler->GetInt("HostPortDefault"))
 	, isHost(false)
 {
@@ -73,4 +75,6 @@ void ClientSetup::LoadFromStartScript(const std::string& setup)
 
 	file.GetDef(saveFile, "", "GAME\\SaveFile");
 	file.GetDef(demoFile, "", "GAME\\DemoFile");
+	file.GetDef(demoKeyFrame, "-1", "GAME\\DemoKeyFrame");
+	file.GetDef(demoSkipFrame, "-1", "GAME\\DemoSkipFrame");
 }
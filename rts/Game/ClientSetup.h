@@ -19,6 +19,11 @@ public:
 	std::string saveFile;
 	std::string demoFile;
 
+	//! if demoFile and saveFile are both given, the demo keyframe saveFile was taken at
+	int demoKeyFrame;
+	//! frame to skip to after resuming from demoKeyFrame
+	int demoSkipFrame;
+
 	//! if this client is not the server player, the IP address we connect to
 	//! if this client is the server player, the IP address that other players connect to
 	std::string hostIP;
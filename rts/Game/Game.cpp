@@ -115,13 +115,16 @@
 #include "Net/Protocol/NetProtocol.h"
 #include "System/SafeUtil.h"
 #include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/VFSHandler.h"
 #include "System/LoadSave/LoadSaveHandler.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/Log/ILog.h"
+#include "System/Platform/Misc.h"
 #include "System/Platform/Watchdog.h"
 #include "System/Sound/ISound.h"
 #include "System/Sound/ISoundChannels.h"
 #include "System/Sync/DumpState.h"
+#include "System/Threading/ThreadPool.h"
 #include "System/TimeProfiler.h"
 
 
@@ -220,6 +223,7 @@ CGame::CGame(const std::string& mapName, const std::string& modName, ILoadSaveHa
 	: gameDrawMode(gameNotDrawing)
 	, lastSimFrame(-1)
 	, lastNumQueuedSimFrames(-1)
+	, runningSyncChecksum(0)
 	, numDrawFrames(0)
 
 	, frameStartTime(spring_gettime())
@@ -232,6 +236,7 @@ CGame::CGame(const std::string& mapName, const std::string& modName, ILoadSaveHa
 	, lastSimFrameNetPacketTime(spring_gettime())
 	, lastUnsyncedUpdateTime(spring_gettime())
 	, skipLastDrawTime(spring_gettime())
+	, playStartTime(spring_gettime())
 
 	, updateDeltaSeconds(0.0f)
 	, totalGameTime(0)
@@ -239,6 +244,7 @@ CGame::CGame(const std::string& mapName, const std::string& modName, ILoadSaveHa
 	, skipping(false)
 	, playing(false)
 	, chatting(false)
+	, fastSim(false)
 	, noSpectatorChat(false)
 	, msgProcTimeLeft(0.0f)
 	, consumeSpeedMult(1.0f)
@@ -274,6 +280,12 @@ CGame::CGame(const std::string& mapName, const std::string& modName, ILoadSaveHa
 
 	speedControl = configHandler->GetInt("SpeedControl");
 
+	#if (defined(HEADLESS) && !defined(DEDICATED))
+	// per-subsystem timings are only gathered while the profiler is enabled
+	if ((fastSim = configHandler->GetBool("HeadlessFastSim")))
+		profiler.SetEnabled(true);
+	#endif
+
 	playerRoster.SetSortTypeByCode((PlayerRoster::SortType)configHandler->GetInt("ShowPlayerInfo"));
 
 	CInputReceiver::guiAlpha = configHandler->GetFloat("GuiOpacity");
@@ -453,6 +465,11 @@ void CGame::LoadGame(const std::string& mapName)
 	Watchdog::DeregisterThread(WDT_LOAD);
 	AddTimedJobs();
 
+	// only a complete load is worth prefetching next time
+	vfsHandler->EndLoadManifest(!forcedQuit);
+	// prefetching is done, async work now yields to the sim and renderer
+	ThreadPool::SetAsyncBackgroundPriority(true);
+
 	finishedLoading = true;
 	globalQuit |= forcedQuit;
 }
@@ -777,6 +794,11 @@ void CGame::LoadFinalize()
 		benchmark.ResetState();
 	}
 
+	// savegames do not contain any Lua state, a demo resumed from one of
+	// its keyframes would not play out the same once a gadget acts on it
+	if (gameServer != nullptr && gameSetup->hostDemo && (luaRules != nullptr || luaGaia != nullptr))
+		gameServer->DisableDemoKeyFrames("synced Lua gadgets are loaded and their state can not be saved");
+
 	lastReadNetTime = spring_gettime();
 	lastSimFrameTime = lastReadNetTime;
 	lastDrawFrameTime = lastReadNetTime;
@@ -1130,6 +1152,11 @@ bool CGame::UpdateUnsynced(const spring_time currentTime)
 		}
 	}
 
+	// fast headless sims only need the periodic unsynced bookkeeping (Lua
+	// GC, etc); run it at 1Hz so (almost) all time is spent in SimFrame
+	if (fastSim && (currentTime - lastUnsyncedUpdateTime).toMilliSecsf() < 1000.0f)
+		return true;
+
 	if (skipping) {
 		// when fast-forwarding, maintain a draw-rate of 2Hz
 		if (spring_tomsecs(currentTime - skipLastDrawTime) < 500.0f)
@@ -1516,6 +1543,7 @@ void CGame::StartPlaying()
 	lastReadNetTime = spring_gettime();
 
 	gu->startTime = gu->gameTime;
+	playStartTime = spring_gettime();
 	gu->myTeam = playerHandler->Player(gu->myPlayerNum)->team;
 	gu->myAllyTeam = teamHandler->AllyTeam(gu->myTeam);
 //	grouphandler->team = gu->myTeam;
@@ -1618,7 +1646,7 @@ void CGame::SimFrame() {
 	eventHandler.DbgTimingInfo(TIMING_SIM, lastFrameTime, lastSimFrameTime);
 
 	#ifdef HEADLESS
-	{
+	if (!fastSim) {
 		const float msecMaxSimFrameTime = 1000.0f / (GAME_SPEED * gs->wantedSpeedFactor);
 		const float msecDifSimFrameTime = (lastSimFrameTime - lastFrameTime).toMilliSecsf();
 		// multiply by 0.5 to give unsynced code some execution time (50% of our sleep-budget)
@@ -1635,6 +1663,56 @@ void CGame::SimFrame() {
 
 	ASSERT_SYNCED(gsRNG.GetGenState());
 	LEAVE_SYNCED_CODE();
+
+	SaveDemoKeyFrame();
+}
+
+
+void CGame::SaveDemoKeyFrame()
+{
+	// only the host has the demo (and knows where frames are in it)
+	if (gameServer == nullptr || !gameSetup->hostDemo)
+		return;
+	// fast-forwarding, frames pass by too quickly
+	if (skipping)
+		return;
+
+	const std::string saveName = gameServer->GetDemoKeyFrameSaveName(gs->frameNum);
+
+	if (saveName.empty())
+		return;
+	if (!FileSystem::CreateDirectory(FileSystem::GetDirectory(saveName)))
+		return;
+
+	ILoadSaveHandler* ls = ILoadSaveHandler::Create(true);
+	ls->mapName = gameSetup->mapName;
+	ls->modName = gameSetup->modName;
+	// the keyframe is indexed with the size and checksum of the written file
+	ls->asyncWrite = false;
+	ls->SaveGame(saveName);
+	delete ls;
+
+	gameServer->AddDemoKeyFrame(gs->frameNum);
+}
+
+
+void CGame::PrintSimThroughput() const
+{
+	const float wallSecs = std::max(0.001f, (spring_gettime() - playStartTime).toSecsf());
+	const float simSecs = gs->frameNum / float(GAME_SPEED);
+
+	LOG("[Game::%s] simulated %d frames (%.1fs) in %.1fs wall-clock time: %.1f frames/s (%.2fx realtime), peak memory usage %uMB",
+		__func__, gs->frameNum, simSecs, wallSecs, gs->frameNum / wallSecs, simSecs / wallSecs, unsigned(Platform::PeakMemoryUsage()));
+#ifdef SYNCCHECK
+	LOG("[Game::%s] sync checksum %08x", __func__, runningSyncChecksum);
+#else
+	// no per-frame checksums are computed, see ClientReadNet
+	LOG("[Game::%s] sync checksum n/a (built without SYNCCHECK)", __func__);
+#endif
+
+	// refresh totals; the profiler only resorts itself once per second
+	if (fastSim)
+		profiler.Update();
 }
 
 
@@ -1666,6 +1744,7 @@ void CGame::GameEnd(const std::vector<unsigned char>& winningAllyTeams, bool tim
 
 	CEndGameBox::Create(winningAllyTeams);
 #ifdef    HEADLESS
+	PrintSimThroughput();
 	profiler.PrintProfilingInfo();
 #endif // HEADLESS
 
@@ -1955,6 +2034,21 @@ void CGame::SaveGame(const std::string& filename, bool overwrite, bool usecreg)
 }
 
 
+void CGame::LoadDemoKeyFrame(int keyFrameNum, int skipFrameNum)
+{
+	if (gameServer == nullptr || !gameSetup->hostDemo) {
+		LOG_L(L_WARNING, "[Game::%s] demo keyframes can only be loaded by the host", __func__);
+		return;
+	}
+
+	LOG("[Game::%s] resuming demo from keyframe %d (skipping to %d)", __func__, keyFrameNum, skipFrameNum);
+
+	// signal SpringApp
+	gu->reloadScript = gameServer->GetDemoKeyFrameScript(keyFrameNum, skipFrameNum);
+	gu->globalReload = true;
+}
+
+
 void CGame::ReloadGame()
 {
 	if (saveFile) {
@@ -102,6 +102,8 @@ public:
 
 	void ReloadGame();
 	void SaveGame(const std::string& filename, bool overwrite, bool usecreg);
+	/// reload the demo being watched from a keyframe snapshot
+	void LoadDemoKeyFrame(int keyFrameNum, int skipFrameNum);
 
 	void ResizeEvent() override;
 
@@ -143,7 +145,9 @@ private:
 	void UpdateNumQueuedSimFrames();
 	void UpdateNetMessageProcessingTimeLeft();
 	void SimFrame();
+	void SaveDemoKeyFrame();
 	void StartPlaying();
+	void PrintSimThroughput() const;
 
 public:
 	GameDrawMode gameDrawMode;
@@ -153,6 +157,9 @@ public:
 	int lastSimFrame;
 	int lastNumQueuedSimFrames;
 
+	/// hash over the sync-checksums of all frames so far (SYNCCHECK builds)
+	unsigned int runningSyncChecksum;
+
 	// number of Draw() calls per 1000ms
 	unsigned int numDrawFrames;
 
@@ -166,6 +173,7 @@ public:
 	spring_time lastSimFrameNetPacketTime;
 	spring_time lastUnsyncedUpdateTime;
 	spring_time skipLastDrawTime;
+	spring_time playStartTime; ///< wall-clock time of StartPlaying()
 
 	float updateDeltaSeconds;
 	/// Time in seconds, stops at game end
@@ -189,6 +197,8 @@ public:
 	bool skipping;
 	bool playing;
 	bool chatting;
+	/// headless-only, see HeadlessFastSim
+	bool fastSim;
 
 	/// Prevents spectator msgs from being seen by players
 	bool noSpectatorChat;
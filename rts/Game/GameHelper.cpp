@@ -39,6 +39,7 @@
 #include "System/myMath.h"
 #include "System/Sound/ISoundChannels.h"
 #include "System/Sync/SyncTracer.h"
+#include "System/Threading/ThreadPool.h"
 
 
 static CGameHelper gGameHelper;
@@ -63,8 +64,8 @@ void CGameHelper::Update()
 	for (size_t n = 0; n < waitingDamages[wdIdx].size(); n++) {
 		const WaitingDamage& wd = waitingDamages[wdIdx][n];
 
-		CUnit* attackee = unitHandler->GetUnit(wd.targetID);
-		CUnit* attacker = unitHandler->GetUnit(wd.attackerID); // null if wd.attacker is -1
+		CUnit* attackee = unitHandler->GetUnit(wd.target);
+		CUnit* attacker = unitHandler->GetUnit(wd.attacker); // null if wd.attacker.id is -1 or stale
 
 		if (attackee == nullptr)
 			continue;
@@ -152,7 +153,7 @@ void CGameHelper::DoExplosionDamage(
 		unit->DoDamage(expDamages, expImpulse, owner, weaponDefID, projectileID);
 	} else {
 		// damage later
-		waitingDamages[(gs->frameNum + int(expDist / expSpeed) - 3) & (waitingDamages.size() - 1)].emplace_back(std::move(expDamages), expImpulse, ((owner != nullptr)? owner->id: -1), unit->id, weaponDefID, projectileID);
+		waitingDamages[(gs->frameNum + int(expDist / expSpeed) - 3) & (waitingDamages.size() - 1)].emplace_back(std::move(expDamages), expImpulse, ((owner != nullptr)? unitHandler->GetUnitHandle(owner->id): SimObjectHandle()), unitHandler->GetUnitHandle(unit->id), weaponDefID, projectileID);
 	}
 }
 
@@ -630,13 +631,16 @@ namespace {
 } // end of namespace
 
 
-void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets)
+// per-thread replacement for the tempNum trick, which can not be shared between threads
+static std::array<std::vector<unsigned int>, ThreadPool::MAX_THREADS> targetUnitMarks;
+static std::array<unsigned int, ThreadPool::MAX_THREADS> targetUnitMarkGens = {{0}};
+
+void CGameHelper::GatherWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<SWeaponTargetCandidate>& candidates)
 {
 	const CUnit* owner    = weapon->owner;
 	const float radius    = weapon->range;
 	const float3& pos     = owner->pos;
 	const float aHeight   = weapon->aimFromPos.y;
-	const CUnit* lastAttacker = ((owner->lastAttackFrame + 200) <= gs->frameNum) ? owner->lastAttacker : nullptr;
 
 	const WeaponDef* weaponDef = weapon->weaponDef;
 	const float heightMod = weaponDef->heightmod;
@@ -645,10 +649,20 @@ void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoi
 	const float secDamage = weapon->damages->GetDefault() * weapon->salvoSize / weapon->reloadTime * GAME_SPEED;
 	const bool paralyzer  = (weapon->damages->paralyzeDamageTime != 0);
 
-	// copy on purpose since the below calls lua
+	const int threadNum = ThreadPool::GetThreadNum();
+
+	std::vector<unsigned int>& unitMarks = targetUnitMarks[threadNum];
+	unsigned int& unitMarkGen = targetUnitMarkGens[threadNum];
+
+	unitMarks.resize(unitHandler->MaxUnits(), 0);
+
+	if ((++unitMarkGen) == 0) {
+		std::fill(unitMarks.begin(), unitMarks.end(), 0);
+		unitMarkGen = 1;
+	}
+
 	QuadFieldQuery qfQuery;
 	quadField->GetQuads(qfQuery, pos, radius + (aHeight - std::max(0.0f, readMap->GetInitMinHeight())) * heightMod);
-	const int tempNum = gs->GetTempNum();
 
 	for (int t = 0; t < teamHandler->ActiveAllyTeams(); ++t) {
 		if (teamHandler->Ally(owner->allyteam, t))
@@ -658,10 +672,10 @@ void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoi
 			const std::vector<CUnit*>& allyTeamUnits = quadField->GetQuad(qi).teamUnits[t];
 
 			for (CUnit* targetUnit: allyTeamUnits) {
-				if (targetUnit->tempNum == tempNum)
+				if (unitMarks[targetUnit->id] == unitMarkGen)
 					continue;
 
-				targetUnit->tempNum = tempNum;
+				unitMarks[targetUnit->id] = unitMarkGen;
 
 				float targetPriority = 1.0f;
 
@@ -690,7 +704,6 @@ void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoi
 
 				const float dist2D = (pos - targPos).Length2D();
 				const float rangeMul = (dist2D * weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
-				const float damageMul = weapon->damages->Get(targetUnit->armorType) * targetUnit->curArmorMultiple;
 
 				targetPriority *= rangeMul;
 
@@ -700,42 +713,60 @@ void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoi
 					if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health))
 						targetPriority *= 4.0f;
 
-					if (weapon->hasTargetWeight)
-						targetPriority *= weapon->TargetWeight(targetUnit);
-
 				} else {
 					targetPriority *= (secDamage + 10000.0f);
 				}
 
-				if (targetLOSState & LOS_PREVLOS) {
-					targetPriority /= (damageMul * targetUnit->power * (0.7f + gsRNG.NextFloat() * 0.6f));
+				candidates.push_back({targetUnit, targetPriority, targetLOSState});
+			}
+		}
+	}
+}
+
+void CGameHelper::ScoreWeaponTargets(const CWeapon* weapon, const std::vector<SWeaponTargetCandidate>& candidates, std::vector<std::pair<float, CUnit*>>& targets)
+{
+	const CUnit* owner = weapon->owner;
+	const CUnit* lastAttacker = ((owner->lastAttackFrame + 200) <= gs->frameNum) ? owner->lastAttacker : nullptr;
 
-					if (targetUnit->category & weapon->badTargetCategory)
-						targetPriority *= 100.0f;
+	const WeaponDef* weaponDef = weapon->weaponDef;
 
-					if (targetUnit->IsCrashing())
-						targetPriority *= 1000.0f;
+	// NOTE:
+	//   the factors are applied in the same order as when this was a single pass, so
+	//   the final priorities (and RNG draws) do not depend on how candidates are gathered
+	for (const SWeaponTargetCandidate& candidate: candidates) {
+		CUnit* targetUnit = candidate.unit;
 
-					if (targetUnit == lastAttacker)
-						targetPriority *= 0.5f;
-				}
+		float targetPriority = candidate.priority;
 
-				const bool allow = eventHandler.AllowWeaponTarget(owner->id, targetUnit->id, weapon->weaponNum, weaponDef->id, &targetPriority);
-				//Lua call may have changed tempNum, so needs to be set again.
-				targetUnit->tempNum = tempNum;
+		if ((candidate.losStatus & LOS_INLOS) && weapon->hasTargetWeight)
+			targetPriority *= weapon->TargetWeight(targetUnit);
 
-				if (!allow)
-					continue;
+		if (candidate.losStatus & LOS_PREVLOS) {
+			const float damageMul = weapon->damages->Get(targetUnit->armorType) * targetUnit->curArmorMultiple;
 
-				targets.push_back(std::pair<float, CUnit*>(targetPriority, targetUnit));
-			}
+			targetPriority /= (damageMul * targetUnit->power * (0.7f + gsRNG.NextFloat() * 0.6f));
+
+			if (targetUnit->category & weapon->badTargetCategory)
+				targetPriority *= 100.0f;
+
+			if (targetUnit->IsCrashing())
+				targetPriority *= 1000.0f;
+
+			if (targetUnit == lastAttacker)
+				targetPriority *= 0.5f;
 		}
+
+		if (!eventHandler.AllowWeaponTarget(owner->id, targetUnit->id, weapon->weaponNum, weaponDef->id, &targetPriority))
+			continue;
+
+		targets.push_back(std::pair<float, CUnit*>(targetPriority, targetUnit));
 	}
+
 	std::stable_sort(targets.begin(), targets.end(), [](const std::pair<float, CUnit*>& a, const std::pair<float, CUnit*>& b) { return (a.first < b.first); });
 
 #ifdef TRACE_SYNC
 	{
-		tracefile << "[GenerateWeaponTargets] ownerID, attackRadius: " << owner->id << ", " << radius << " ";
+		tracefile << "[ScoreWeaponTargets] ownerID, attackRadius: " << owner->id << ", " << weapon->range << " ";
 
 		for (const auto& ti: targets) {
 			tracefile << "\tpriority: " << (ti.first) <<  ", targetID: " << (ti.second)->id <<  " ";
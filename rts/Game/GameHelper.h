@@ -4,8 +4,10 @@
 #define GAME_HELPER_H
 
 #include "Sim/Misc/DamageArray.h"
+#include "Sim/Misc/SimObjectHandleTable.h"
 #include "Sim/Projectiles/ExplosionListener.h"
 #include "Sim/Units/CommandAI/Command.h"
+#include "Sim/Weapons/WeaponTarget.h"
 #include "System/float3.h"
 #include "System/type2.h"
 
@@ -121,7 +123,13 @@ public:
 	 */
 	static float3 ClosestBuildSite(int team, const UnitDef* unitDef, float3 pos, float searchRadius, int minDist, int facing = 0);
 
-	static void GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets);
+	/**
+	 * GatherWeaponTargets only reads sim-state and may be called from worker threads,
+	 * ScoreWeaponTargets draws from the synced RNG and calls into Lua so must be run
+	 * serially in a deterministic order.
+	 */
+	static void GatherWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<SWeaponTargetCandidate>& candidates);
+	static void ScoreWeaponTargets(const CWeapon* weapon, const std::vector<SWeaponTargetCandidate>& candidates, std::vector<std::pair<float, CUnit*>>& targets);
 
 	void Init();
 	void Update();
@@ -155,18 +163,22 @@ public:
 	void Explosion(const CExplosionParams& params);
 
 private:
+	// damage is applied up to waitingDamages.size() frames after the
+	// explosion, by which time either unit ID may have been recycled
+	// so both units are referenced through handles rather than IDs
 	struct WaitingDamage {
-		WaitingDamage(const DamageArray& _damage, const float3& _impulse, int _attackerID, int _targetID, int _weaponID, int _projectileID)
-		: attackerID(_attackerID)
-		, targetID(_targetID)
+		WaitingDamage(const DamageArray& _damage, const float3& _impulse, SimObjectHandle _attacker, SimObjectHandle _target, int _weaponID, int _projectileID)
+		: attacker(_attacker)
+		, target(_target)
 		, weaponID(_weaponID)
 		, projectileID(_projectileID)
 		, damage(_damage)
 		, impulse(_impulse)
 		{}
 
-		int attackerID;
-		int targetID;
+		SimObjectHandle attacker;
+		SimObjectHandle target;
+
 		int weaponID;
 		int projectileID;
 
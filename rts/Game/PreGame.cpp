@@ -35,6 +35,7 @@
 #include "System/Exceptions.h"
 #include "System/SafeUtil.h"
 #include "System/SpringExitCode.h"
+#include "System/StringUtil.h"
 #include "System/TimeProfiler.h"
 #include "System/TdfParser.h"
 #include "System/Input/KeyInput.h"
@@ -49,6 +50,7 @@
 #include "System/Net/UnpackPacket.h"
 #include "System/Platform/errorhandler.h"
 #include "System/Sync/SyncedPrimitiveBase.h"
+#include "System/Threading/ThreadPool.h"
 #include "lib/luasocket/src/restrictions.h"
 #ifdef SYNCDEBUG
 	#include "System/Sync/SyncDebugger.h"
@@ -59,6 +61,7 @@ using netcode::RawPacket;
 using std::string;
 
 CONFIG(bool, DemoFromDemo).defaultValue(false);
+CONFIG(bool, PrefetchArchiveFiles).defaultValue(true).description("Decompress the archive files read by a previous load of the same game and map on worker threads, ahead of the loading sequence.");
 
 static char mapChecksumMsgBuf[1024] = {0};
 static char modChecksumMsgBuf[1024] = {0};
@@ -116,6 +119,13 @@ void CPreGame::LoadDemo(const std::string& demo)
 		wantDemo = false;
 
 	ReadDataFromDemo(demo);
+
+	// resuming from a keyframe; the server seeks its demo-stream
+	// once the snapshot has been loaded (see CGameServer::PostLoad)
+	if (!clientSetup->saveFile.empty()) {
+		savefile = ILoadSaveHandler::Create(true);
+		savefile->LoadGameStartInfo(clientSetup->saveFile);
+	}
 }
 
 void CPreGame::LoadSavefile(const std::string& save, bool usecreg)
@@ -542,6 +552,19 @@ void CPreGame::GameDataReceived(std::shared_ptr<const netcode::RawPacket> packet
 	std::snprintf(mapChecksumMsgBuf, sizeof(mapChecksumMsgBuf), "[PreGame::%s][map-checksums={0x%x,0x%x}]", __func__, mapChecksums.first, mapChecksums.second);
 	std::snprintf(modChecksumMsgBuf, sizeof(modChecksumMsgBuf), "[PreGame::%s][mod-checksums={0x%x,0x%x}]", __func__, modChecksums.first, modChecksums.second);
 
+	// the manifest lists every VFS file the previous load of this game and
+	// map read (saved by CGame::LoadGame); keyed by the host's checksums
+	// the prefetch jobs run on async workers, which must not be throttled
+	// while loading (CGame::LoadGame lowers their priority again)
+	ThreadPool::SetAsyncBackgroundPriority(false);
+
+	if (configHandler->GetBool("PrefetchArchiveFiles")) {
+		const std::string& manifestName = IntToString(modChecksums.first, "%08x") + "-" + IntToString(mapChecksums.first, "%08x");
+		const std::string& manifestPath = FileSystem::GetCacheDir() + "/prefetch/" + manifestName + ".txt";
+
+		vfsHandler->BeginLoadManifest(manifestPath);
+	}
+
 	// script.txt allows to disable demo file recording (host only, used for menu)
 	if (clientSetup->isHost && !gameSetup->recordDemo)
 		wantDemo = false;
@@ -453,7 +453,14 @@ public:
 			"Fast-forwards to a given frame, or stops fast-forwarding") {}
 
 	bool Execute(const SyncedAction& action) const {
-		if (action.GetArgs().find_first_of("start") == 0) {
+		if (action.GetArgs().compare(0, 9, "keyframe ") == 0) {
+			std::istringstream buf(action.GetArgs().substr(9));
+			int keyFrame = -1;
+			int targetFrame = -1;
+			buf >> keyFrame >> targetFrame;
+			game->LoadDemoKeyFrame(keyFrame, targetFrame);
+		}
+		else if (action.GetArgs().find_first_of("start") == 0) {
 			std::istringstream buf(action.GetArgs().substr(6));
 			int targetFrame;
 			buf >> targetFrame;
@@ -26,6 +26,63 @@
 // Local/Helper functions
 //////////////////////////////////////////////////////////////////////
 
+template<typename T>
+struct TraceRayBatch: public CollisionTestBatch<16> {
+	void Add(T* o) {
+		objects[size] = o;
+		CollisionTestBatch<16>::Add(o, o->GetTransformMatrix(true));
+	}
+
+	std::array<T*, 16> objects;
+};
+
+/**
+ * helper for TraceRay
+ * hit-tests all objects in <batch> in order, exactly as calling DetectHit
+ * on each of them with the (shrinking) ray would, and clears the batch
+ * @return the closest object hit in <batch>, or nullptr
+ */
+template<typename T>
+static T* TraceRayBatchHelper(
+	TraceRayBatch<T>& batch,
+	const float3& pos,
+	const float3& dir,
+	float& traceLength,
+	CollisionQuery* hitColQuery
+) {
+	CollisionQuery cq;
+	T* hitObject = nullptr;
+
+	const float cullLength = traceLength;
+
+	batch.CullHitTests(pos, pos + dir * traceLength, true);
+
+	for (size_t i = 0; i < batch.size; i++) {
+		// culling used the ray as it was at the start of the batch, once a
+		// closer hit has shortened it the remaining objects are all tested
+		if (batch.flags[i] == 0 && traceLength == cullLength)
+			continue;
+
+		if (!CCollisionHandler::DetectHit(batch.objs[i], batch.mats[i], pos, pos + dir * traceLength, &cq, true))
+			continue;
+
+		const float len = cq.GetHitPosDist(pos, dir);
+
+		// we want the closest object (intersection point) on the ray
+		if (len >= traceLength)
+			continue;
+
+		traceLength = len;
+
+		hitObject = batch.objects[i];
+		*hitColQuery = cq;
+	}
+
+	batch.Clear();
+	return hitObject;
+}
+
+
 /**
  * helper for TestCone
  * @return true if object <o> is in the firing cone, false otherwise
@@ -207,11 +264,15 @@ float TraceRay(
 
 		// locally point somewhere non-NULL; we cannot pass hitColQuery
 		// to DetectHit directly because each call resets it internally
+		// (objects are hit-tested in batches, see TraceRayBatchHelper)
 		if (hitColQuery == nullptr)
 			hitColQuery = &cq;
 
 		// feature intersection
 		if (scanForFeatures) {
+			TraceRayBatch<CFeature> featureBatch;
+			CFeature* hitObject = nullptr;
+
 			for (const int quadIdx: *qfQuery.quads) {
 				const CQuadField::Quad& quad = quadField->GetQuad(quadIdx);
 
@@ -222,24 +283,27 @@ float TraceRay(
 					if (!f->HasCollidableStateBit(CSolidObject::CSTATE_BIT_QUADMAPRAYS))
 						continue;
 
-					if (CCollisionHandler::DetectHit(f, f->GetTransformMatrix(true), pos, pos + dir * traceLength, &cq, true)) {
-						const float len = cq.GetHitPosDist(pos, dir);
-
-						// we want the closest feature (intersection point) on the ray
-						if (len >= traceLength)
-							continue;
+					if (!featureBatch.Full()) {
+						featureBatch.Add(f);
+						continue;
+					}
 
-						traceLength = len;
+					if ((hitObject = TraceRayBatchHelper(featureBatch, pos, dir, traceLength, hitColQuery)) != nullptr)
+						hitFeature = hitObject;
 
-						hitFeature = f;
-						*hitColQuery = cq;
-					}
+					featureBatch.Add(f);
 				}
 			}
+
+			if ((hitObject = TraceRayBatchHelper(featureBatch, pos, dir, traceLength, hitColQuery)) != nullptr)
+				hitFeature = hitObject;
 		}
 
 		// unit intersection
 		if (scanForAnyUnits) {
+			TraceRayBatch<CUnit> unitBatch;
+			CUnit* hitObject = nullptr;
+
 			for (const int quadIdx: *qfQuery.quads) {
 				const CQuadField::Quad& quad = quadField->GetQuad(quadIdx);
 
@@ -260,21 +324,21 @@ float TraceRay(
 					if (!doHitTest)
 						continue;
 
-					if (CCollisionHandler::DetectHit(u, u->GetTransformMatrix(true), pos, pos + dir * traceLength, &cq, true)) {
-						const float len = cq.GetHitPosDist(pos, dir);
-
-						// we want the closest unit (intersection point) on the ray
-						if (len >= traceLength)
-							continue;
+					if (!unitBatch.Full()) {
+						unitBatch.Add(u);
+						continue;
+					}
 
-						traceLength = len;
+					if ((hitObject = TraceRayBatchHelper(unitBatch, pos, dir, traceLength, hitColQuery)) != nullptr)
+						hitUnit = hitObject;
 
-						hitUnit = u;
-						*hitColQuery = cq;
-					}
+					unitBatch.Add(u);
 				}
 			}
 
+			if ((hitObject = TraceRayBatchHelper(unitBatch, pos, dir, traceLength, hitColQuery)) != nullptr)
+				hitUnit = hitObject;
+
 			// units override features, so feature != null implies no unit was hit
 			if (hitUnit != nullptr)
 				hitFeature = nullptr;
@@ -55,6 +55,10 @@
 
 bool CLuaHandle::devMode = false;
 
+// sum of gcAllocRate over all live handles
+static float gcAllocRateSum = 0.0f;
+static unsigned int gcNumHandles = 0;
+
 
 /******************************************************************************/
 /******************************************************************************/
@@ -88,7 +92,11 @@ CLuaHandle::CLuaHandle(const string& _name, int _order, bool _userMode, bool _sy
 	// by *other* states end up not being recycled so we clear the
 	// shared pool on reload
 	, D(_name != "LuaIntro" && name != "LuaMenu", true)
+	, unitCallInFilterMask(0)
 	, callinErrors(0)
+	, gcStepSize(10)
+	, gcAllocRate(0.0f)
+	, gcNumLuaAllocs(0)
 {
 	D.owner = this;
 	D.synced = _synced;
@@ -102,6 +110,10 @@ CLuaHandle::CLuaHandle(const string& _name, int _order, bool _userMode, bool _sy
 
 	// prevent lua from calling c's exit()
 	lua_atpanic(L, handlepanic);
+
+	luaProfiler.Init(L);
+
+	gcNumHandles += 1;
 }
 
 
@@ -133,7 +145,12 @@ void CLuaHandle::KillLua(bool inFreeHandler)
 	// must be done here: if called from a ctor, we want the
 	// state to become non-valid so that LoadHandler returns
 	// false and FreeHandler runs next
+	luaProfiler.Kill(L, GetName());
 	LUA_CLOSE(&L);
+
+	gcAllocRateSum -= gcAllocRate;
+	gcAllocRate = 0.0f;
+	gcNumHandles -= 1;
 }
 
 
@@ -304,7 +321,11 @@ int CLuaHandle::RunCallInTraceback(
 			// note1: disable GC outside of this scope to prevent sync errors and similar
 			// note2: we collect garbage now in its own callin "CollectGarbage"
 			// lua_gc(L, LUA_GCRESTART, 0);
+			const spring_time startTime = handle->luaProfiler.EnterCallIn(luaFunc);
+
 			error = lua_pcall(state, nInArgs, nOutArgs, errFuncIdx);
+
+			handle->luaProfiler.LeaveCallIn(luaFunc, startTime);
 			// only run GC inside of "SetHandleRunning(L, true) ... SetHandleRunning(L, false)"!
 			lua_gc(state, LUA_GCSTOP, 0);
 
@@ -753,6 +774,19 @@ void CLuaHandle::PlayerRemoved(int playerID, int reason)
 
 /******************************************************************************/
 
+bool CLuaHandle::UnitCallInFilter::Pass(const CUnit* unit) const
+{
+	if (!unitDefs.empty() && (static_cast<size_t>(unit->unitDef->id) >= unitDefs.size() || !unitDefs[unit->unitDef->id]))
+		return false;
+	if (!teams.empty() && (static_cast<size_t>(unit->team) >= teams.size() || !teams[unit->team]))
+		return false;
+	if (!allyTeams.empty() && (static_cast<size_t>(unit->allyteam) >= allyTeams.size() || !allyTeams[unit->allyteam]))
+		return false;
+
+	return true;
+}
+
+
 inline void CLuaHandle::UnitCallIn(const LuaHashString& hs, const CUnit* unit)
 {
 	LUA_CALL_IN_CHECK(L);
@@ -773,6 +807,9 @@ inline void CLuaHandle::UnitCallIn(const LuaHashString& hs, const CUnit* unit)
 
 void CLuaHandle::UnitCreated(const CUnit* unit, const CUnit* builder)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_CREATED, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 7, __func__);
 
@@ -795,6 +832,9 @@ void CLuaHandle::UnitCreated(const CUnit* unit, const CUnit* builder)
 
 void CLuaHandle::UnitFinished(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_FINISHED, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -803,6 +843,9 @@ void CLuaHandle::UnitFinished(const CUnit* unit)
 void CLuaHandle::UnitFromFactory(const CUnit* unit,
                                  const CUnit* factory, bool userOrders)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_FROM_FACTORY, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 9, __func__);
 	const LuaUtils::ScopedDebugTraceBack traceBack(L);
@@ -825,6 +868,9 @@ void CLuaHandle::UnitFromFactory(const CUnit* unit,
 
 void CLuaHandle::UnitReverseBuilt(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_REVERSE_BUILT, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -832,6 +878,9 @@ void CLuaHandle::UnitReverseBuilt(const CUnit* unit)
 
 void CLuaHandle::UnitDestroyed(const CUnit* unit, const CUnit* attacker)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_DESTROYED, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 9, __func__);
 
@@ -865,6 +914,9 @@ void CLuaHandle::UnitDestroyed(const CUnit* unit, const CUnit* attacker)
 
 void CLuaHandle::UnitTaken(const CUnit* unit, int oldTeam, int newTeam)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_TAKEN, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 7, __func__);
 	const LuaUtils::ScopedDebugTraceBack traceBack(L);
@@ -885,6 +937,9 @@ void CLuaHandle::UnitTaken(const CUnit* unit, int oldTeam, int newTeam)
 
 void CLuaHandle::UnitGiven(const CUnit* unit, int oldTeam, int newTeam)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_GIVEN, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 7, __func__);
 	const LuaUtils::ScopedDebugTraceBack traceBack(L);
@@ -905,6 +960,9 @@ void CLuaHandle::UnitGiven(const CUnit* unit, int oldTeam, int newTeam)
 
 void CLuaHandle::UnitIdle(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_IDLE, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -912,6 +970,9 @@ void CLuaHandle::UnitIdle(const CUnit* unit)
 
 void CLuaHandle::UnitCommand(const CUnit* unit, const Command& command)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_COMMAND, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 11, __func__);
 
@@ -930,6 +991,9 @@ void CLuaHandle::UnitCommand(const CUnit* unit, const Command& command)
 
 void CLuaHandle::UnitCmdDone(const CUnit* unit, const Command& command)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_CMD_DONE, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 8, __func__);
 
@@ -954,6 +1018,9 @@ void CLuaHandle::UnitDamaged(
 	int projectileID,
 	bool paralyzer)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_DAMAGED, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 11, __func__);
 
@@ -989,6 +1056,9 @@ void CLuaHandle::UnitStunned(
 	const CUnit* unit,
 	bool stunned)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_STUNNED, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 5, __func__);
 
@@ -1009,6 +1079,9 @@ void CLuaHandle::UnitStunned(
 
 void CLuaHandle::UnitExperience(const CUnit* unit, float oldExperience)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_EXPERIENCE, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 8, __func__);
 
@@ -1031,6 +1104,9 @@ void CLuaHandle::UnitExperience(const CUnit* unit, float oldExperience)
 
 void CLuaHandle::UnitHarvestStorageFull(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_HARVEST_STORAGE_FULL, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -1091,6 +1167,9 @@ void CLuaHandle::LosCallIn(const LuaHashString& hs,
 
 void CLuaHandle::UnitEnteredRadar(const CUnit* unit, int allyTeam)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_ENTERED_RADAR, unit))
+		return;
+
 	static const LuaHashString hs("UnitEnteredRadar");
 	LosCallIn(hs, unit, allyTeam);
 }
@@ -1098,6 +1177,9 @@ void CLuaHandle::UnitEnteredRadar(const CUnit* unit, int allyTeam)
 
 void CLuaHandle::UnitEnteredLos(const CUnit* unit, int allyTeam)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_ENTERED_LOS, unit))
+		return;
+
 	static const LuaHashString hs("UnitEnteredLos");
 	LosCallIn(hs, unit, allyTeam);
 }
@@ -1105,6 +1187,9 @@ void CLuaHandle::UnitEnteredLos(const CUnit* unit, int allyTeam)
 
 void CLuaHandle::UnitLeftRadar(const CUnit* unit, int allyTeam)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_LEFT_RADAR, unit))
+		return;
+
 	static const LuaHashString hs("UnitLeftRadar");
 	LosCallIn(hs, unit, allyTeam);
 }
@@ -1112,6 +1197,9 @@ void CLuaHandle::UnitLeftRadar(const CUnit* unit, int allyTeam)
 
 void CLuaHandle::UnitLeftLos(const CUnit* unit, int allyTeam)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_LEFT_LOS, unit))
+		return;
+
 	static const LuaHashString hs("UnitLeftLos");
 	LosCallIn(hs, unit, allyTeam);
 }
@@ -1121,6 +1209,9 @@ void CLuaHandle::UnitLeftLos(const CUnit* unit, int allyTeam)
 
 void CLuaHandle::UnitLoaded(const CUnit* unit, const CUnit* transport)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_LOADED, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 8, __func__);
 
@@ -1143,6 +1234,9 @@ void CLuaHandle::UnitLoaded(const CUnit* unit, const CUnit* transport)
 
 void CLuaHandle::UnitUnloaded(const CUnit* unit, const CUnit* transport)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_UNLOADED, unit))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 8, __func__);
 
@@ -1167,6 +1261,9 @@ void CLuaHandle::UnitUnloaded(const CUnit* unit, const CUnit* transport)
 
 void CLuaHandle::UnitEnteredWater(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_ENTERED_WATER, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -1174,6 +1271,9 @@ void CLuaHandle::UnitEnteredWater(const CUnit* unit)
 
 void CLuaHandle::UnitEnteredAir(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_ENTERED_AIR, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -1181,6 +1281,9 @@ void CLuaHandle::UnitEnteredAir(const CUnit* unit)
 
 void CLuaHandle::UnitLeftWater(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_LEFT_WATER, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -1188,6 +1291,9 @@ void CLuaHandle::UnitLeftWater(const CUnit* unit)
 
 void CLuaHandle::UnitLeftAir(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_LEFT_AIR, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -1197,6 +1303,9 @@ void CLuaHandle::UnitLeftAir(const CUnit* unit)
 
 void CLuaHandle::UnitCloaked(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_CLOAKED, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -1204,6 +1313,9 @@ void CLuaHandle::UnitCloaked(const CUnit* unit)
 
 void CLuaHandle::UnitDecloaked(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_DECLOAKED, unit))
+		return;
+
 	static const LuaHashString cmdStr(__func__);
 	UnitCallIn(cmdStr, unit);
 }
@@ -1274,6 +1386,9 @@ bool CLuaHandle::UnitFeatureCollision(const CUnit* collider, const CFeature* col
 
 void CLuaHandle::UnitMoveFailed(const CUnit* unit)
 {
+	if (!PassUnitCallInFilter(UNIT_CALLIN_MOVE_FAILED, unit))
+		return;
+
 	// if empty, we are not a LuaHandleSynced (and must always return false)
 	if (watchUnitDefs.empty())
 		return;
@@ -2417,6 +2532,7 @@ void CLuaHandle::DownloadProgress(int ID, long downloaded, long total)
 /******************************************************************************/
 
 CONFIG(float, MaxLuaGarbageCollectionTime ).defaultValue(5.f).minimumValue(1.0f).description("in MilliSecs");
+CONFIG(float, LuaGarbageCollectionFrameBudget).defaultValue(4.0f).minimumValue(0.1f).description("Time in MilliSecs that all Lua states combined may spend collecting garbage per pass (30 passes per second); split between states by their allocation rates.");
 
 
 void CLuaHandle::CollectGarbage()
@@ -2428,11 +2544,27 @@ void CLuaHandle::CollectGarbage()
 	int luaMemFootPrintKB = lua_gc(L_GC, LUA_GCCOUNT, 0);
 	int numLuaGarbageCollectIters = 0;
 
-	static int gcsteps = 10;
 	// 30x per second !!!
 	static const float maxLuaGarbageCollectTime = configHandler->GetFloat("MaxLuaGarbageCollectionTime");
+	static const float luaGarbageCollectBudget = configHandler->GetFloat("LuaGarbageCollectionFrameBudget");
+
+	{
+		// number of allocations made by this state since the previous pass
+		const uint64_t numLuaAllocs = D.allocState.numLuaAllocs.load();
+		const float newAllocRate = mix(gcAllocRate, float(numLuaAllocs - gcNumLuaAllocs), 0.25f);
+
+		gcAllocRateSum += (newAllocRate - gcAllocRate);
+		gcAllocRate = newAllocRate;
+		gcNumLuaAllocs = numLuaAllocs;
+	}
+
+	// every state gets its share of the pass budget proportional to how fast
+	// it produces garbage, with a small floor so idle states still progress
+	const float minBudgetShare = 0.1f / std::max(gcNumHandles, 1u);
+	const float budgetShare = std::max(minBudgetShare, gcAllocRate / std::max(gcAllocRateSum, 1.0f));
 
 	float maxRunTime = smoothstep(10, 100, luaMemFootPrintKB / 1024) * maxLuaGarbageCollectTime;
+	maxRunTime = std::min(maxRunTime, luaGarbageCollectBudget * budgetShare);
 
 	const spring_time startTime = spring_gettime();
 	const spring_time endTime = startTime + spring_msecs(maxRunTime);
@@ -2442,7 +2574,7 @@ void CLuaHandle::CollectGarbage()
 	// collect garbage until time runs out
 	while (spring_gettime() < endTime) {
 		numLuaGarbageCollectIters++;
-		if (!lua_gc(L_GC, LUA_GCSTEP, gcsteps))
+		if (!lua_gc(L_GC, LUA_GCSTEP, gcStepSize))
 			continue;
 
 		// garbage-collection cycle finished
@@ -2461,12 +2593,14 @@ void CLuaHandle::CollectGarbage()
 
 	const spring_time finishTime = spring_gettime();
 
-	if (gcsteps > 1 && numLuaGarbageCollectIters > 0) {
-		// runtime optimize number of steps to process in a batch
+	if (numLuaGarbageCollectIters > 0) {
+		// runtime optimize number of steps to process in a batch; aim for
+		// several steps per slice so the deadline is not overshot by much
 		const float avgTimePerLoopIter = (finishTime - startTime).toMilliSecsf() / numLuaGarbageCollectIters;
+		const float maxTimePerLoopIter = std::max(maxRunTime, 0.1f);
 
-		if (avgTimePerLoopIter > (maxLuaGarbageCollectTime * 0.150f)) gcsteps--;
-		if (avgTimePerLoopIter < (maxLuaGarbageCollectTime * 0.075f)) gcsteps++;
+		if (avgTimePerLoopIter > (maxTimePerLoopIter * 0.150f)) gcStepSize = std::max(gcStepSize - 1, 1);
+		if (avgTimePerLoopIter < (maxTimePerLoopIter * 0.075f)) gcStepSize = std::min(gcStepSize + 1, 1000);
 	}
 
 	eventHandler.DbgTimingInfo(TIMING_GC, startTime, finishTime);
@@ -2481,6 +2615,7 @@ bool CLuaHandle::AddBasicCalls(lua_State* L)
 	lua_newtable(L); {
 		HSTR_PUSH_CFUNC(L, "Kill",            KillActiveHandle);
 		HSTR_PUSH_CFUNC(L, "UpdateCallIn",    CallOutUpdateCallIn);
+		HSTR_PUSH_CFUNC(L, "SetUnitCallInFilter", CallOutSetUnitCallInFilter);
 		HSTR_PUSH_CFUNC(L, "GetName",         CallOutGetName);
 		HSTR_PUSH_CFUNC(L, "GetSynced",       CallOutGetSynced);
 		HSTR_PUSH_CFUNC(L, "GetFullCtrl",     CallOutGetFullCtrl);
@@ -2644,6 +2779,129 @@ int CLuaHandle::CallOutUpdateCallIn(lua_State* L)
 }
 
 
+static void ParseUnitCallInFilterSet(lua_State* L, int tableIdx, const char* key, vector<bool>& set)
+{
+	set.clear();
+
+	lua_getfield(L, tableIdx, key);
+
+	if (lua_istable(L, -1)) {
+		for (lua_pushnil(L); lua_next(L, -2) != 0; lua_pop(L, 1)) {
+			if (!lua_israwnumber(L, -1))
+				continue;
+
+			const int id = lua_toint(L, -1);
+
+			if (id < 0)
+				continue;
+
+			set.resize(std::max(set.size(), size_t(id + 1)), false);
+			set[id] = true;
+		}
+
+		// an explicitly empty set filters out every unit
+		if (set.empty())
+			set.resize(1, false);
+	}
+
+	lua_pop(L, 1);
+}
+
+/*
+ * Script.SetUnitCallInFilter(callInName, filters) -> bool
+ *
+ * filters is either nil (remove all filters), a single filter or an
+ * array of filters; each filter is a table with optional {unitDefs =
+ * {...}, teams = {...}, allyTeams = {...}} ID lists and matches units
+ * that are in every list it gives. The call-in is run for units that
+ * match at least one filter. Each call replaces the previous filters,
+ * so handles with several clients (gadgets, widgets) must pass the
+ * union of all their clients' filters; the gadget and widget handlers
+ * do this through their own SetUnitCallInFilter.
+ */
+int CLuaHandle::CallOutSetUnitCallInFilter(lua_State* L)
+{
+	static const char* callInNames[UNIT_CALLIN_COUNT] = {
+		"UnitCreated",
+		"UnitFinished",
+		"UnitFromFactory",
+		"UnitReverseBuilt",
+		"UnitDestroyed",
+		"UnitTaken",
+		"UnitGiven",
+		"UnitIdle",
+		"UnitCommand",
+		"UnitCmdDone",
+		"UnitDamaged",
+		"UnitStunned",
+		"UnitExperience",
+		"UnitHarvestStorageFull",
+		"UnitEnteredRadar",
+		"UnitEnteredLos",
+		"UnitLeftRadar",
+		"UnitLeftLos",
+		"UnitEnteredWater",
+		"UnitEnteredAir",
+		"UnitLeftWater",
+		"UnitLeftAir",
+		"UnitLoaded",
+		"UnitUnloaded",
+		"UnitCloaked",
+		"UnitDecloaked",
+		"UnitMoveFailed",
+	};
+
+	const char* name = luaL_checkstring(L, 1);
+	const char** iter = std::find_if(std::begin(callInNames), std::end(callInNames), [&](const char* n) { return (strcmp(n, name) == 0); });
+
+	if (iter == std::end(callInNames)) {
+		lua_pushboolean(L, false);
+		return 1;
+	}
+
+	CLuaHandle* lh = GetHandle(L);
+
+	const unsigned int type = iter - std::begin(callInNames);
+
+	vector<UnitCallInFilter>& filters = lh->unitCallInFilters[type];
+
+	const auto ParseFilter = [&](int tableIdx) {
+		filters.emplace_back();
+		ParseUnitCallInFilterSet(L, tableIdx, "unitDefs", filters.back().unitDefs);
+		ParseUnitCallInFilterSet(L, tableIdx, "teams", filters.back().teams);
+		ParseUnitCallInFilterSet(L, tableIdx, "allyTeams", filters.back().allyTeams);
+	};
+
+	filters.clear();
+
+	if (lua_istable(L, 2)) {
+		const int numFilters = lua_objlen(L, 2);
+
+		if (numFilters == 0)
+			ParseFilter(2);
+
+		for (int i = 1; i <= numFilters; i++) {
+			lua_rawgeti(L, 2, i);
+
+			if (lua_istable(L, -1))
+				ParseFilter(lua_gettop(L));
+
+			lua_pop(L, 1);
+		}
+	}
+
+	// one filter that lets every unit through makes the others moot
+	if (std::find_if(filters.begin(), filters.end(), [](const UnitCallInFilter& f) { return f.PassAll(); }) != filters.end())
+		filters.clear();
+
+	lh->unitCallInFilterMask &= ~(1u << type);
+	lh->unitCallInFilterMask |= ((!filters.empty()) << type);
+
+	lua_pushboolean(L, true);
+	return 1;
+}
+
+
 /******************************************************************************/
 /******************************************************************************/
 
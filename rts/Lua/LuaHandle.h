@@ -8,6 +8,7 @@
 //FIXME#include "LuaArrays.h"
 #include "LuaContextData.h"
 #include "LuaHashString.h"
+#include "LuaProfiler.h"
 #include "lib/lua/include/LuaInclude.h" //FIXME needed for GetLuaContextData
 
 #include <string>
@@ -92,6 +93,8 @@ class CLuaHandle : public CEventClient
 		//FIXME needed by LuaSyncedTable (can be solved cleaner?)
 		lua_State* GetLuaState() const { return L; }
 
+		LuaProfiler& GetProfiler() { return luaProfiler; }
+
 #if (!defined(UNITSYNC) && !defined(DEDICATED))
 		LuaShaders& GetShaders(const lua_State* L = NULL) { return GetLuaContextData(L)->shaders; }
 		LuaTextures& GetTextures(const lua_State* L = NULL) { return GetLuaContextData(L)->textures; }
@@ -288,8 +291,63 @@ class CLuaHandle : public CEventClient
 		void LosCallIn(const LuaHashString& hs, const CUnit* unit, int allyTeam);
 		void UnitCallIn(const LuaHashString& hs, const CUnit* unit);
 
+		bool PassUnitCallInFilter(unsigned int type, const CUnit* unit) const {
+			if ((unitCallInFilterMask & (1u << type)) == 0)
+				return true;
+
+			for (const UnitCallInFilter& filter: unitCallInFilters[type]) {
+				if (filter.Pass(unit))
+					return true;
+			}
+
+			return false;
+		}
+
 		void RunDrawCallIn(const LuaHashString& hs);
 
+	protected:
+		// per-unit call-ins that can be filtered via Script.SetUnitCallInFilter
+		enum {
+			UNIT_CALLIN_CREATED,
+			UNIT_CALLIN_FINISHED,
+			UNIT_CALLIN_FROM_FACTORY,
+			UNIT_CALLIN_REVERSE_BUILT,
+			UNIT_CALLIN_DESTROYED,
+			UNIT_CALLIN_TAKEN,
+			UNIT_CALLIN_GIVEN,
+			UNIT_CALLIN_IDLE,
+			UNIT_CALLIN_COMMAND,
+			UNIT_CALLIN_CMD_DONE,
+			UNIT_CALLIN_DAMAGED,
+			UNIT_CALLIN_STUNNED,
+			UNIT_CALLIN_EXPERIENCE,
+			UNIT_CALLIN_HARVEST_STORAGE_FULL,
+			UNIT_CALLIN_ENTERED_RADAR,
+			UNIT_CALLIN_ENTERED_LOS,
+			UNIT_CALLIN_LEFT_RADAR,
+			UNIT_CALLIN_LEFT_LOS,
+			UNIT_CALLIN_ENTERED_WATER,
+			UNIT_CALLIN_ENTERED_AIR,
+			UNIT_CALLIN_LEFT_WATER,
+			UNIT_CALLIN_LEFT_AIR,
+			UNIT_CALLIN_LOADED,
+			UNIT_CALLIN_UNLOADED,
+			UNIT_CALLIN_CLOAKED,
+			UNIT_CALLIN_DECLOAKED,
+			UNIT_CALLIN_MOVE_FAILED,
+			UNIT_CALLIN_COUNT,
+		};
+
+		// an empty set does not restrict its key
+		struct UnitCallInFilter {
+			bool Pass(const CUnit* unit) const;
+			bool PassAll() const { return (unitDefs.empty() && teams.empty() && allyTeams.empty()); }
+
+			vector<bool> unitDefs;
+			vector<bool> teams;
+			vector<bool> allyTeams;
+		};
+
 	protected:
 		bool userMode;
 		bool killMe; // set for handles that fail to RunCallIn
@@ -304,8 +362,21 @@ class CLuaHandle : public CEventClient
 		vector<bool> watchFeatureDefs;
 		vector<bool> watchWeaponDefs; // for the Explosion call-in
 
+		// a unit passes if it matches any of the filters set for a call-in
+		vector<UnitCallInFilter> unitCallInFilters[UNIT_CALLIN_COUNT];
+		// bit N is set iff unitCallInFilters[N] restricts anything
+		unsigned int unitCallInFilterMask;
+
 		int callinErrors;
 
+		// number of KB processed per GC step, tuned at runtime
+		int gcStepSize;
+		// smoothed number of allocations between two GC passes
+		float gcAllocRate;
+		uint64_t gcNumLuaAllocs;
+
+		LuaProfiler luaProfiler;
+
 	private: // call-outs
 		static int KillActiveHandle(lua_State* L);
 		static int CallOutGetName(lua_State* L);
@@ -320,6 +391,7 @@ class CLuaHandle : public CEventClient
 		static int CallOutGetRegistry(lua_State* L);
 		static int CallOutGetCallInList(lua_State* L);
 		static int CallOutUpdateCallIn(lua_State* L);
+		static int CallOutSetUnitCallInFilter(lua_State* L);
 		static int CallOutIsEngineMinVersion(lua_State* L);
 
 	public: // static
@@ -0,0 +1,146 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+
+#include "LuaProfiler.h"
+#include "LuaHandle.h"
+#include "LuaInclude.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/Log/ILog.h"
+
+CONFIG(int, LuaProfilerSampleInterval)
+	.defaultValue(0)
+	.minimumValue(0)
+	.description("Number of Lua VM instructions between call-stack samples of the Lua profiler, 0 disables it. Collapsed stacks are written to profile/lua-<handle>-<synced|unsynced>.txt when a Lua handle is unloaded.");
+
+
+static void LuaProfilerHook(lua_State* L, lua_Debug* ar)
+{
+	CLuaHandle* lh = CLuaHandle::GetHandle(L);
+
+	if (lh == nullptr)
+		return;
+
+	lh->GetProfiler().Sample(L);
+}
+
+
+void LuaProfiler::Init(lua_State* L)
+{
+	sampleInterval = configHandler->GetInt("LuaProfilerSampleInterval");
+
+	if (!IsEnabled())
+		return;
+
+	// coroutines created after this point inherit the hook, threads
+	// created before it (CLuaHandle::L_GC) are not sampled
+	lua_sethook(L, LuaProfilerHook, LUA_MASKCOUNT, sampleInterval);
+}
+
+void LuaProfiler::Kill(lua_State* L, const std::string& handleName)
+{
+	if (!IsEnabled())
+		return;
+
+	lua_sethook(L, nullptr, 0, 0);
+
+	// synced and unsynced LuaRules / LuaGaia share a handle name
+	Dump(handleName + (CLuaHandle::GetHandleSynced(L)? "-synced": "-unsynced"));
+
+	callInStats.clear();
+	stackSamples.clear();
+	callInNames.clear();
+}
+
+
+void LuaProfiler::Sample(lua_State* L)
+{
+	lua_Debug ar;
+
+	int numLevels = 0;
+
+	while (lua_getstack(L, numLevels, &ar) != 0)
+		numLevels++;
+
+	// collapsed format: root frame first, frames separated by ';'
+	stackString.clear();
+	stackString.append(callInNames.empty()? "[none]": callInNames.back());
+
+	for (int level = numLevels - 1; level >= 0; level--) {
+		if (lua_getstack(L, level, &ar) == 0)
+			continue;
+		if (lua_getinfo(L, "Sn", &ar) == 0)
+			continue;
+
+		stackString.append(";");
+		stackString.append((ar.name != nullptr)? ar.name: "?");
+		stackString.append("@");
+		stackString.append(ar.short_src);
+		stackString.append(":");
+		stackString.append(std::to_string(ar.linedefined));
+	}
+
+	// ';' and ' ' are separators in the collapsed format
+	std::replace(stackString.begin(), stackString.end(), ' ', '_');
+
+	stackSamples[stackString] += 1;
+}
+
+
+void LuaProfiler::AddCallInTime(const char* name, spring_time dt)
+{
+	CallInStats& stats = callInStats[name];
+
+	stats.numCalls += 1;
+	stats.sumTime += dt;
+	stats.maxTime = std::max(stats.maxTime, dt);
+}
+
+
+void LuaProfiler::Dump(const std::string& handleName) const
+{
+	std::vector< std::pair<std::string, CallInStats> > sortedStats(callInStats.begin(), callInStats.end());
+
+	std::sort(sortedStats.begin(), sortedStats.end(), [](const std::pair<std::string, CallInStats>& a, const std::pair<std::string, CallInStats>& b) {
+		return (a.second.sumTime > b.second.sumTime);
+	});
+
+	for (const auto& p: sortedStats) {
+		const CallInStats& stats = p.second;
+
+		LOG("[LuaProfiler::%s][handle=%s] callin=%s calls=%u {sum,avg,max}Time={%.3f,%.3f,%.3f}ms",
+			__func__,
+			handleName.c_str(),
+			(p.first).c_str(),
+			stats.numCalls,
+			stats.sumTime.toMilliSecsf(),
+			stats.sumTime.toMilliSecsf() / std::max(stats.numCalls, 1u),
+			stats.maxTime.toMilliSecsf()
+		);
+	}
+
+	if (stackSamples.empty())
+		return;
+
+	std::string fileName = "profile/lua-" + handleName + ".txt";
+	std::replace(fileName.begin(), fileName.end(), ' ', '_');
+
+	const std::string filePath = dataDirsAccess.LocateFile(fileName, FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+
+	std::ofstream file(filePath.c_str(), std::ios::out | std::ios::trunc);
+
+	if (!file.good()) {
+		LOG_L(L_WARNING, "[LuaProfiler::%s][handle=%s] could not open \"%s\"", __func__, handleName.c_str(), filePath.c_str());
+		return;
+	}
+
+	for (const auto& p: stackSamples) {
+		file << p.first << " " << p.second << "\n";
+	}
+
+	LOG("[LuaProfiler::%s][handle=%s] wrote %u stacks to \"%s\"", __func__, handleName.c_str(), unsigned(stackSamples.size()), filePath.c_str());
+}
@@ -0,0 +1,67 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef LUA_PROFILER_H_
+#define LUA_PROFILER_H_
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "System/Misc/SpringTime.h"
+#include "System/UnorderedMap.hpp"
+
+struct lua_State;
+
+// optional sampling profiler for a single handle's Lua state; when
+// LuaProfilerSampleInterval is non-zero a count-hook samples the Lua
+// call-stack every N VM instructions and every call-in is timed, the
+// results are written as collapsed stacks (for flamegraph tools) when
+// the state is closed
+class LuaProfiler {
+public:
+	void Init(lua_State* L);
+	void Kill(lua_State* L, const std::string& handleName);
+
+	bool IsEnabled() const { return (sampleInterval != 0); }
+
+	spring_time EnterCallIn(const char* name) {
+		if (!IsEnabled())
+			return spring_notime;
+
+		callInNames.push_back(name);
+		return spring_gettime();
+	}
+	void LeaveCallIn(const char* name, spring_time startTime) {
+		if (!IsEnabled())
+			return;
+
+		assert(!callInNames.empty() && callInNames.back() == name);
+		callInNames.pop_back();
+		AddCallInTime(name, spring_gettime() - startTime);
+	}
+
+	void Sample(lua_State* L);
+
+private:
+	void AddCallInTime(const char* name, spring_time dt);
+	void Dump(const std::string& handleName) const;
+
+private:
+	struct CallInStats {
+		unsigned int numCalls = 0;
+
+		spring_time sumTime = spring_notime;
+		spring_time maxTime = spring_notime;
+	};
+
+	spring::unordered_map<std::string, CallInStats> callInStats;
+	// collapsed call-stack ==> number of samples taken in it
+	spring::unordered_map<std::string, unsigned int> stackSamples;
+
+	std::vector<const char*> callInNames;
+	std::string stackString;
+
+	unsigned int sampleInterval = 0;
+};
+
+#endif
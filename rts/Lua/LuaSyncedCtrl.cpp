@@ -3980,6 +3980,7 @@ int LuaSyncedCtrl::SetMapSquareTerrainType(lua_State* L)
 	const int ntt = luaL_checkint(L, 3);
 
 	readMap->GetTypeMapSynced()[tz * mapDims.hmapx + tx] = std::max(0, std::min(ntt, (CMapInfo::NUM_TERRAIN_TYPES - 1)));
+	readMap->IncSyncedUpdateCount();
 	pathManager->TerrainChange(hx, hz,  hx + 1, hz + 1,  TERRAINCHANGE_SQUARE_TYPEMAP_INDEX);
 
 	lua_pushnumber(L, ott);
@@ -4016,8 +4017,10 @@ int LuaSyncedCtrl::SetTerrainTypeData(lua_State* L)
 	// hardness changes do not require repathing
 	if (ttHardnessChanged)
 		mapDamage->TerrainTypeHardnessChanged(tti);
-	if (ttSpeedModChanged)
+	if (ttSpeedModChanged) {
 		mapDamage->TerrainTypeSpeedModChanged(tti);
+		readMap->IncSyncedUpdateCount();
+	}
 
 	lua_pushboolean(L, true);
 	return 1;
@@ -210,6 +210,7 @@ bool LuaSyncedRead::PushEntries(lua_State* L)
 	REGISTER_LUA_CFUNC(GetUnitDirection);
 	REGISTER_LUA_CFUNC(GetUnitHeading);
 	REGISTER_LUA_CFUNC(GetUnitVelocity);
+	REGISTER_LUA_CFUNC(GetUnitsData);
 	REGISTER_LUA_CFUNC(GetUnitBuildFacing);
 	REGISTER_LUA_CFUNC(GetUnitIsBuilding);
 	REGISTER_LUA_CFUNC(GetUnitCurrentBuildPower);
@@ -3001,6 +3002,258 @@ int LuaSyncedRead::GetUnitVelocity(lua_State* L)
 }
 
 
+namespace {
+	enum UnitDataAttrib {
+		UNIT_DATA_DEFID,
+		UNIT_DATA_TEAM,
+		UNIT_DATA_ALLYTEAM,
+		UNIT_DATA_ISDEAD,
+		UNIT_DATA_POSX,
+		UNIT_DATA_POSY,
+		UNIT_DATA_POSZ,
+		UNIT_DATA_MIDX,
+		UNIT_DATA_MIDY,
+		UNIT_DATA_MIDZ,
+		UNIT_DATA_VELX,
+		UNIT_DATA_VELY,
+		UNIT_DATA_VELZ,
+		UNIT_DATA_SPEED,
+		UNIT_DATA_HEADING,
+		UNIT_DATA_HEALTH,
+		UNIT_DATA_MAXHEALTH,
+		UNIT_DATA_PARALYZE,
+		UNIT_DATA_CAPTURE,
+		UNIT_DATA_BUILD,
+		UNIT_DATA_EXPERIENCE,
+		UNIT_DATA_RADIUS,
+		UNIT_DATA_HEIGHT,
+		UNIT_DATA_COUNT,
+	};
+
+	// indexed by UnitDataAttrib
+	const char* unitDataAttribNames[UNIT_DATA_COUNT] = {
+		"defID",
+		"team",
+		"allyTeam",
+		"isDead",
+		"x",
+		"y",
+		"z",
+		"midX",
+		"midY",
+		"midZ",
+		"vx",
+		"vy",
+		"vz",
+		"speed",
+		"heading",
+		"health",
+		"maxHealth",
+		"paralyzeDamage",
+		"captureProgress",
+		"buildProgress",
+		"experience",
+		"radius",
+		"height",
+	};
+}
+
+// pushes the value of attribute <attrib> for <unit> or nil
+// if the per-unit getter would not return it to the caller
+static void PushUnitDataAttrib(lua_State* L, const CUnit* unit, unsigned int attrib, const float3& errorVec)
+{
+	if (unit == nullptr || !IsUnitVisible(L, unit)) {
+		lua_pushnil(L);
+		return;
+	}
+
+	switch (attrib) {
+		case UNIT_DATA_DEFID: {
+			if (!IsUnitTyped(L, unit)) {
+				lua_pushnil(L);
+			} else {
+				lua_pushnumber(L, EffectiveUnitDef(L, unit)->id);
+			}
+		} break;
+
+		case UNIT_DATA_TEAM    : { lua_pushnumber(L, unit->team); } break;
+		case UNIT_DATA_ALLYTEAM: { lua_pushnumber(L, unit->allyteam); } break;
+		case UNIT_DATA_ISDEAD  : { lua_pushboolean(L, unit->isDead); } break;
+
+		case UNIT_DATA_POSX: { lua_pushnumber(L, unit->pos.x + errorVec.x); } break;
+		case UNIT_DATA_POSY: { lua_pushnumber(L, unit->pos.y + errorVec.y); } break;
+		case UNIT_DATA_POSZ: { lua_pushnumber(L, unit->pos.z + errorVec.z); } break;
+		case UNIT_DATA_MIDX: { lua_pushnumber(L, unit->midPos.x + errorVec.x); } break;
+		case UNIT_DATA_MIDY: { lua_pushnumber(L, unit->midPos.y + errorVec.y); } break;
+		case UNIT_DATA_MIDZ: { lua_pushnumber(L, unit->midPos.z + errorVec.z); } break;
+
+		case UNIT_DATA_VELX:
+		case UNIT_DATA_VELY:
+		case UNIT_DATA_VELZ:
+		case UNIT_DATA_SPEED:
+		case UNIT_DATA_HEADING: {
+			if (!IsUnitInLos(L, unit)) {
+				lua_pushnil(L);
+			} else if (attrib == UNIT_DATA_HEADING) {
+				lua_pushnumber(L, unit->heading);
+			} else {
+				lua_pushnumber(L, unit->speed[attrib - UNIT_DATA_VELX]);
+			}
+		} break;
+
+		case UNIT_DATA_HEALTH:
+		case UNIT_DATA_MAXHEALTH:
+		case UNIT_DATA_PARALYZE: {
+			if (!IsUnitInLos(L, unit)) {
+				lua_pushnil(L);
+				break;
+			}
+
+			const UnitDef* ud = unit->unitDef;
+			const bool enemyUnit = IsEnemyUnit(L, unit);
+
+			if (ud->hideDamage && enemyUnit) {
+				lua_pushnil(L);
+				break;
+			}
+
+			const float scale = (!enemyUnit || (ud->decoyDef == nullptr))? 1.0f: (ud->decoyDef->health / ud->health);
+			const float values[] = {unit->health, unit->maxHealth, unit->paralyzeDamage};
+
+			lua_pushnumber(L, scale * values[attrib - UNIT_DATA_HEALTH]);
+		} break;
+
+		case UNIT_DATA_CAPTURE:
+		case UNIT_DATA_BUILD: {
+			if (!IsUnitInLos(L, unit)) {
+				lua_pushnil(L);
+			} else {
+				lua_pushnumber(L, (attrib == UNIT_DATA_CAPTURE)? unit->captureProgress: unit->buildProgress);
+			}
+		} break;
+
+		case UNIT_DATA_EXPERIENCE: {
+			if (!IsAllyUnit(L, unit)) {
+				lua_pushnil(L);
+			} else {
+				lua_pushnumber(L, unit->experience);
+			}
+		} break;
+
+		case UNIT_DATA_RADIUS:
+		case UNIT_DATA_HEIGHT: {
+			if (!IsUnitTyped(L, unit)) {
+				lua_pushnil(L);
+			} else {
+				lua_pushnumber(L, (attrib == UNIT_DATA_RADIUS)? unit->radius: unit->height);
+			}
+		} break;
+
+		default: {
+			assert(false);
+			lua_pushnil(L);
+		} break;
+	}
+}
+
+/*
+ * Spring.GetUnitsData(unitIDs, attribs[, data]) -> data, numAttribs, numValues
+ *
+ * Reads <attribs> (e.g. {"x", "z", "health"}) for every unit in
+ * <unitIDs> with a single call and stores them in the flat array
+ * <data>, which is reused if given: the value of attribute #j for
+ * unit #i is at data[(i - 1) * numAttribs + j]. Every value obeys
+ * the same visibility rules as its per-unit getter and is nil if
+ * that getter would not return it, so #data is not meaningful and
+ * numValues (= #unitIDs * numAttribs) should be used instead; any
+ * entries of a reused <data> past numValues are cleared.
+ */
+int LuaSyncedRead::GetUnitsData(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+	luaL_checktype(L, 2, LUA_TTABLE);
+
+	const int numUnits = lua_objlen(L, 1);
+	const int numAttribs = lua_objlen(L, 2);
+
+	unsigned int attribs[UNIT_DATA_COUNT];
+	bool needErrorVec = false;
+
+	if (numAttribs > UNIT_DATA_COUNT)
+		luaL_error(L, "[%s] too many attributes (%d, max %d)", __func__, numAttribs, UNIT_DATA_COUNT);
+
+	for (int j = 0; j < numAttribs; j++) {
+		lua_rawgeti(L, 2, j + 1);
+
+		const char* name = luaL_checkstring(L, -1);
+		const char** iter = std::find_if(std::begin(unitDataAttribNames), std::end(unitDataAttribNames), [&](const char* n) { return (strcmp(n, name) == 0); });
+
+		if (iter == std::end(unitDataAttribNames))
+			luaL_error(L, "[%s] unknown attribute \"%s\"", __func__, name);
+
+		attribs[j] = iter - std::begin(unitDataAttribNames);
+		needErrorVec |= (attribs[j] >= UNIT_DATA_POSX && attribs[j] <= UNIT_DATA_MIDZ);
+
+		lua_pop(L, 1);
+	}
+
+	const int numValues = numUnits * numAttribs;
+	const bool reuseData = lua_istable(L, 3);
+
+	if (reuseData) {
+		lua_pushvalue(L, 3);
+	} else {
+		lua_createtable(L, numValues, 0);
+	}
+
+	const int dataIdx = lua_gettop(L);
+
+	for (int i = 0; i < numUnits; i++) {
+		lua_rawgeti(L, 1, i + 1);
+
+		if (!lua_isnumber(L, -1))
+			luaL_error(L, "[%s] unitID #%d not a number", __func__, i + 1);
+
+		const CUnit* unit = unitHandler->GetUnit(lua_toint(L, -1));
+
+		float3 errorVec;
+
+		lua_pop(L, 1);
+
+		if (needErrorVec && unit != nullptr && !IsAllyUnit(L, unit))
+			errorVec = unit->GetLuaErrorVector(CLuaHandle::GetHandleReadAllyTeam(L), CLuaHandle::GetHandleFullRead(L));
+
+		for (int j = 0; j < numAttribs; j++) {
+			PushUnitDataAttrib(L, unit, attribs[j], errorVec);
+			lua_rawseti(L, dataIdx, i * numAttribs + j + 1);
+		}
+	}
+
+	if (reuseData) {
+		// drop the tail left over from a previous (larger) query; the
+		// array may contain nil holes so its length can not be trusted
+		// and all keys have to be visited (clearing fields is allowed
+		// during traversal)
+		lua_pushnil(L);
+
+		while (lua_next(L, dataIdx) != 0) {
+			lua_pop(L, 1);
+
+			if (lua_type(L, -1) != LUA_TNUMBER || lua_tonumber(L, -1) <= numValues)
+				continue;
+
+			lua_pushvalue(L, -1);
+			lua_pushnil(L);
+			lua_rawset(L, dataIdx);
+		}
+	}
+
+	lua_pushnumber(L, numAttribs);
+	lua_pushnumber(L, numValues);
+	return 3;
+}
+
+
 int LuaSyncedRead::GetUnitBuildFacing(lua_State* L)
 {
 	CUnit* unit = ParseInLosUnit(L, __func__, 1);
@@ -61,6 +61,7 @@ CR_REG_METADATA(CReadMap, (
 	CR_IGNORED(currHeightBounds),
 	CR_IGNORED(boundingRadius),
 	CR_IGNORED(mapChecksum),
+	CR_IGNORED(syncedUpdateCount),
 
 	CR_IGNORED(heightMapSyncedPtr),
 	CR_IGNORED(heightMapUnsyncedPtr),
@@ -268,6 +269,7 @@ CReadMap::CReadMap()
 	, heightMapSyncedPtr(nullptr)
 	, heightMapUnsyncedPtr(nullptr)
 	, mapChecksum(0)
+	, syncedUpdateCount(0)
 	, boundingRadius(0.0f)
 {
 }
@@ -491,6 +493,7 @@ void CReadMap::UpdateHeightMapSynced(SRectangle hmRect, bool initialize)
 	UpdateMipHeightmaps(hmRect, initialize);
 	UpdateFaceNormals(hmRect, initialize);
 	UpdateSlopemap(hmRect, initialize); // must happen after UpdateFaceNormals()!
+	IncSyncedUpdateCount();
 
 	assert(initialize == (losHandler == nullptr));
 
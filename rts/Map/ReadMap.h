@@ -204,6 +204,9 @@ public:
 	bool HasOnlyVoidWater() const;
 
 	unsigned int GetMapChecksum() const { return mapChecksum; }
+	/// bumped on every synced height- or type-map change, lets callers cache derived terrain data
+	unsigned int GetSyncedUpdateCount() const { return syncedUpdateCount; }
+	void IncSyncedUpdateCount() { syncedUpdateCount += 1; }
 	unsigned int CalcHeightmapChecksum();
 	unsigned int CalcTypemapChecksum();
 
@@ -276,6 +279,7 @@ private:
 #endif
 
 	unsigned int mapChecksum;
+	unsigned int syncedUpdateCount;
 
 	float2 initHeightBounds; //< initial minimum- and maximum-height (before any deformations)
 	float2 currHeightBounds; //< current minimum- and maximum-height
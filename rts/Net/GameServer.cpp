@@ -67,11 +67,13 @@ using netcode::RawPacket;
 
 CONFIG(int, AutohostPort).defaultValue(0);
 CONFIG(int, ServerSleepTime).defaultValue(5).description("number of milliseconds to sleep per tick");
+CONFIG(bool, HeadlessFastSim).defaultValue(false).description("Headless only: simulate frames as fast as the local client can process them, ignoring game speed, and skip most unsynced updates. Throughput statistics are logged at game end.");
 CONFIG(int, SpeedControl).defaultValue(1).minimumValue(1).maximumValue(2)
 	.description("Sets how server adjusts speed according to player's load (CPU), 1: use average, 2: use highest");
 CONFIG(bool, AllowSpectatorJoin).defaultValue(true).description("allow any unauthenticated clients to join as spectator with any name, name will be prefixed with ~");
 CONFIG(bool, WhiteListAdditionalPlayers).defaultValue(true);
 CONFIG(bool, ServerRecordDemos).defaultValue(false).dedicatedValue(true);
+CONFIG(int, DemoKeyFrameInterval).defaultValue(0).minimumValue(0).description("When watching a demo, save a game-state snapshot every N frames (0 = disabled) which /skip can later restore to seek backward or far forward. Snapshots do not include Lua state, so no keyframes are saved or restored for games with synced Lua gadgets (LuaRules or LuaGaia).");
 CONFIG(bool, ServerLogInfoMessages).defaultValue(false);
 CONFIG(bool, ServerLogDebugMessages).defaultValue(false);
 CONFIG(std::string, AutohostIP).defaultValue("127.0.0.1");
@@ -152,6 +154,7 @@ CGameServer::CGameServer(
 
 , userSpeedFactor(1.0f)
 , internalSpeed(1.0f)
+, fastSim(false)
 
 , medianCpu(0.0f)
 , medianPing(0)
@@ -166,6 +169,10 @@ CGameServer::CGameServer(
 
 , localClientNumber(-1u)
 
+, demoKeyFrameInterval(0)
+, demoKeyFrameSeek(-1)
+, demoSkipFrame(-1)
+
 , gameHasStarted(false)
 , generatedGameID(false)
 , reloadingServer(false)
@@ -219,6 +226,13 @@ void CGameServer::Initialize()
 	if (myGameSetup->hostDemo) {
 		Message(spring::format(PlayingDemo, myGameSetup->demoName.c_str()));
 		demoReader.reset(new CDemoReader(myGameSetup->demoName, modGameTime + 0.1f));
+		demoKeyFrameIndex.Load(myGameSetup->demoName);
+		demoKeyFrameInterval = configHandler->GetInt("DemoKeyFrameInterval");
+
+		if (!myClientSetup->saveFile.empty()) {
+			demoKeyFrameSeek = myClientSetup->demoKeyFrame;
+			demoSkipFrame = myClientSetup->demoSkipFrame;
+		}
 	}
 
 	// initialize players, teams & ais
@@ -280,6 +294,9 @@ void CGameServer::Initialize()
 	}
 
 	loopSleepTime = configHandler->GetInt("ServerSleepTime");
+	#if (defined(HEADLESS) && !defined(DEDICATED))
+	fastSim = configHandler->GetBool("HeadlessFastSim");
+	#endif
 	lastNewFrameTick = spring_gettime();
 	linkMinPacketSize = globalConfig->linkIncomingMaxPacketRate > 0 ? (globalConfig->linkIncomingSustainedBandwidth / globalConfig->linkIncomingMaxPacketRate) : 1;
 	lastBandwidthUpdate = spring_gettime();
@@ -309,6 +326,86 @@ void CGameServer::PostLoad(int newServerFrameNum)
 	for (GameParticipant& p: players) {
 		p.lastFrameResponse = newServerFrameNum;
 	}
+
+	if (demoReader == nullptr || demoKeyFrameSeek < 0)
+		return;
+
+	// resuming a demo from a keyframe; skip the stream up to the snapshot
+	const CDemoKeyFrameIndex::KeyFrame* kf = demoKeyFrameIndex.GetKeyFrame(demoKeyFrameSeek);
+
+	if (kf == nullptr || kf->frameNum != newServerFrameNum || !demoReader->SeekToStreamPos(kf->streamPos, modGameTime)) {
+		Message(spring::format("Failed to resume demo from keyframe %d", demoKeyFrameSeek));
+		quitServer = true;
+	}
+
+	demoKeyFrameSeek = -1;
+}
+
+
+std::string CGameServer::GetDemoKeyFrameSaveName(int frameNum) const
+{
+	// interval only changes on the calling thread (DisableDemoKeyFrames),
+	// check it before contending for the lock
+	if (demoKeyFrameInterval <= 0 || (frameNum % demoKeyFrameInterval) != 0)
+		return "";
+
+	std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
+
+	if (demoKeyFramePositions.find(frameNum) == demoKeyFramePositions.end())
+		return "";
+
+	return (demoKeyFrameIndex.GetSaveFileName(frameNum));
+}
+
+void CGameServer::AddDemoKeyFrame(int frameNum)
+{
+	std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
+
+	const auto it = demoKeyFramePositions.find(frameNum);
+
+	if (it == demoKeyFramePositions.end())
+		return;
+
+	demoKeyFrameIndex.AddKeyFrame(frameNum, it->second);
+	// positions of earlier frames were not needed
+	demoKeyFramePositions.erase(demoKeyFramePositions.begin(), ++demoKeyFramePositions.find(frameNum));
+}
+
+void CGameServer::DisableDemoKeyFrames(const std::string& reason)
+{
+	std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
+
+	if (demoKeyFrameInterval <= 0 && demoKeyFrameIndex.Empty())
+		return;
+
+	Message(spring::format("Warning: demo keyframes disabled, %s; /skip can only fast-forward", reason.c_str()));
+
+	demoKeyFrameInterval = 0;
+	demoKeyFramePositions.clear();
+	demoKeyFrameIndex.Clear();
+}
+
+std::string CGameServer::GetDemoKeyFrameScript(int frameNum, int skipFrameNum) const
+{
+	std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
+
+	// LoadDemoFile appends this again
+	std::string playerName = myClientSetup->myPlayerName;
+	const std::string::size_type specPos = playerName.rfind(" (spec)");
+
+	if (specPos != std::string::npos && (specPos + 7) == playerName.size())
+		playerName.erase(specPos);
+
+	std::ostringstream buf;
+	buf << "[GAME]\n{\n";
+	buf << "\tDemoFile=" << myGameSetup->demoName << ";\n";
+	buf << "\tSaveFile=" << demoKeyFrameIndex.GetSaveFileName(frameNum) << ";\n";
+	buf << "\tDemoKeyFrame=" << frameNum << ";\n";
+	buf << "\tDemoSkipFrame=" << skipFrameNum << ";\n";
+	buf << "\tMyPlayerName=" << playerName << ";\n";
+	buf << "\tIsHost=1;\n";
+	buf << "}\n";
+	return (buf.str());
 }
 
 
@@ -424,6 +521,8 @@ void CGameServer::SkipTo(int targetFrameNum)
 	const bool wasPaused = isPaused;
 
 	if (!gameHasStarted) { return; }
+	if (!myGameSetup->hostDemo) { return; }
+	if (SkipToDemoKeyFrame(targetFrameNum)) { return; }
 	if (serverFrameNum >= targetFrameNum) { return; }
 	if (demoReader == NULL) { return; }
 
@@ -456,6 +555,37 @@ void CGameServer::SkipTo(int targetFrameNum)
 	isPaused = wasPaused;
 }
 
+bool CGameServer::SkipToDemoKeyFrame(int targetFrameNum)
+{
+	const CDemoKeyFrameIndex::KeyFrame* kf = demoKeyFrameIndex.FindKeyFrame(targetFrameNum);
+
+	if (kf == nullptr)
+		return false;
+
+	// short forward skips are cheaper to simulate than a reload
+	if (targetFrameNum > serverFrameNum && kf->frameNum < (serverFrameNum + GAME_SPEED * 60))
+		return false;
+
+	// the savegame might have been overwritten or damaged since
+	if (!demoKeyFrameIndex.CheckKeyFrame(*kf)) {
+		Message(spring::format("Warning: savegame of demo keyframe %d does not match the index, not seeking", kf->frameNum));
+		return false;
+	}
+
+	// remote spectators can not follow
+	for (const GameParticipant& p: players) {
+		if (!p.isLocal && p.link != nullptr)
+			return false;
+	}
+
+	CommandMessage msg(spring::format("skip keyframe %d %d", kf->frameNum, targetFrameNum), SERVER_PLAYER);
+	Broadcast(std::shared_ptr<const netcode::RawPacket>(msg.Pack()));
+
+	// keep the stream where it is until the client reloads
+	isPaused = true;
+	return true;
+}
+
 std::string CGameServer::GetPlayerNames(const std::vector<int>& indices) const
 {
 	std::string playerstring;
@@ -495,6 +625,11 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 				lastNewFrameTick = spring_gettime();
 				serverFrameNum++;
 
+				// remember where this frame ends in case the client snapshots it
+				// (it does not while skipping)
+				if (targetFrameNum == -1 && demoKeyFrameInterval > 0 && (serverFrameNum % demoKeyFrameInterval) == 0 && HasLocalClient() && !demoKeyFrameIndex.HasKeyFrame(serverFrameNum))
+					demoKeyFramePositions[serverFrameNum] = demoReader->GetStreamPos();
+
 #ifdef SYNCCHECK
 				if (targetFrameNum == -1) {
 					// not skipping
@@ -817,8 +952,10 @@ void CGameServer::Update()
 		// if we are not playing a demo, or have no local client, or the
 		// local client is less than <GAME_SPEED> frames behind, advance
 		// <modGameTime>
+		//
+		// fast headless sims release a full second of demo data per update
 		if (demoReader == NULL || !HasLocalClient() || (serverFrameNum - players[localClientNumber].lastFrameResponse) < GAME_SPEED)
-			modGameTime += (tdif * internalSpeed);
+			modGameTime += ((fastSim && demoReader != NULL)? 1.0f: (tdif * internalSpeed));
 	}
 
 	if (lastPlayerInfo < (spring_gettime() - playerInfoTime)) {
@@ -853,6 +990,14 @@ void CGameServer::Update()
 	else if (!PreSimFrame() || demoReader != NULL)
 		CreateNewFrame(true, false);
 
+	// finish a skip that was interrupted by resuming from a keyframe
+	if (gameHasStarted && demoSkipFrame > serverFrameNum) {
+		const int skipFrame = demoSkipFrame;
+
+		demoSkipFrame = -1;
+		SkipTo(skipFrame);
+	}
+
 	if (hostif) {
 		std::string msg = hostif->GetChatMessage();
 
@@ -2272,7 +2417,7 @@ void CGameServer::PushAction(const Action& action, bool fromAutoHost)
 			CheckForGameStart(true);
 	}
 	else if (action.command == "skip") {
-		if (demoReader) {
+		if (myGameSetup->hostDemo) {
 			std::string timeStr = action.extra;
 
 			// parse the skip time
@@ -2471,7 +2616,8 @@ void CGameServer::CreateNewFrame(bool fromServerThread, bool fixedFrameTime)
 			const unsigned int curSimRate   = std::max(gu->simFPS, GAME_SPEED * 1.0f); // advance at most 1s into the future
 			const unsigned int maxNewFrames = mix(curSimRate * 1.0f, 0.0f, simFrameMixRatio); // (fps + (0 - fps) * a)
 
-			numNewFrames = std::min(numNewFrames, maxNewFrames);
+			// fast headless sims always create as many as the local client can take
+			numNewFrames = (fastSim)? maxNewFrames: std::min(numNewFrames, maxNewFrames);
 
 			if (logDebugMessages) {
 				LOG_L(
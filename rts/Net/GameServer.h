@@ -18,6 +18,7 @@
 #include "Sim/Misc/TeamBase.h"
 #include "System/float3.h"
 #include "System/GlobalRNG.h"
+#include "System/LoadSave/DemoKeyFrameIndex.h"
 #include "System/Misc/SpringTime.h"
 #include "System/Threading/SpringThreading.h"
 
@@ -86,6 +87,19 @@ public:
 	 */
 	void PostLoad(int serverFrameNum);
 
+	/**
+	 * @brief Savegame path for a demo keyframe at the given frame
+	 * Empty unless keyframes are enabled, this frame should be one and
+	 * it is not already indexed. Called by the local client at the end
+	 * of the sim-frame, AddDemoKeyFrame once the snapshot is written.
+	 */
+	std::string GetDemoKeyFrameSaveName(int frameNum) const;
+	void AddDemoKeyFrame(int frameNum);
+	/// stops saving keyframes and refuses to seek to existing ones
+	void DisableDemoKeyFrames(const std::string& reason);
+	/// start-script for reloading the demo from the given keyframe
+	std::string GetDemoKeyFrameScript(int frameNum, int skipFrameNum) const;
+
 	void CreateNewFrame(bool fromServerThread, bool fixedFrameTime);
 
 	void SetGamePausable(const bool arg);
@@ -167,6 +181,11 @@ private:
 	 * targetFrame to all clients
 	 */
 	void SkipTo(int targetFrameNum);
+	/**
+	 * @brief make the local client reload from the closest demo keyframe
+	 * @return true if a keyframe was found that saves simulating frames
+	 */
+	bool SkipToDemoKeyFrame(int targetFrameNum);
 
 	void Message(const std::string& message, bool broadcast = true, bool internal = false);
 	void PrivateMessage(int playerNum, const std::string& message);
@@ -206,6 +225,9 @@ private:
 	float userSpeedFactor;
 	float internalSpeed;
 
+	/// headless-only, create frames as fast as the local client consumes them
+	bool fastSim;
+
 	std::map<unsigned char, GameSkirmishAI> ais;
 	std::array<bool, MAX_AIS> usedSkirmishAIIds;
 
@@ -267,6 +289,16 @@ private:
 	std::unique_ptr<CDemoRecorder> demoRecorder;
 	std::unique_ptr<AutohostInterface> hostif;
 
+	CDemoKeyFrameIndex demoKeyFrameIndex;
+	/// demo-stream positions of frames that are to become keyframes
+	std::map<int, int> demoKeyFramePositions;
+
+	int demoKeyFrameInterval;
+	/// keyframe to seek to once its snapshot is loaded
+	int demoKeyFrameSeek;
+	/// frame to skip to after seeking
+	int demoSkipFrame;
+
 	CGlobalUnsyncedRNG rng;
 	spring::thread* thread;
 
@@ -35,6 +35,7 @@
 #include "System/TimeProfiler.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/Net/UnpackPacket.h"
+#include "System/Sync/HsiehHash.h"
 #include "System/Sound/ISound.h"
 
 CONFIG(bool, LogClientData).defaultValue(false);
@@ -513,6 +514,11 @@ void CGame::ClientReadNet()
 				ASSERT_SYNCED(CSyncChecker::GetChecksum());
 				clientNet->Send(CBaseNetProtocol::Get().SendSyncResponse(gu->myPlayerNum, gs->frameNum, CSyncChecker::GetChecksum()));
 
+				{
+					const unsigned int frameChecksum = CSyncChecker::GetChecksum();
+					runningSyncChecksum = HsiehHash(&frameChecksum, sizeof(frameChecksum), runningSyncChecksum);
+				}
+
 				if (gameServer != NULL && gameServer->GetDemoReader() != NULL) {
 					// buffer all checksums, so we can check sync later between demo & local
 					localSyncChecksums[gs->frameNum] = CSyncChecker::GetChecksum();
@@ -438,6 +438,12 @@ struct LocalModel
 		luaMaterialData.SetLODCount(lodCount);
 	}
 	void UpdateBoundingVolume();
+	// resolves all lazily dirty piece matrices at once, afterwards
+	// GetModelSpaceMatrix can be read concurrently without writes
+	void UpdatePieceMatrices() const {
+		if (Initialized())
+			pieces[0].UpdateChildMatricesRec(false);
+	}
 
 	void GetBoundingBoxVerts(std::vector<float3>& verts) const {
 		verts.resize(8 + 2); GetBoundingBoxVerts(&verts[0]);
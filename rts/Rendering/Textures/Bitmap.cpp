@@ -272,14 +272,26 @@ bool CBitmap::Load(std::string const& filename, unsigned char defaultAlpha)
 
 	std::vector<uint8_t> buffer;
 
+	const uint8_t* bufferData = nullptr;
+	size_t bufferSize = 0;
+
 	if (!file.IsBuffered()) {
 		buffer.resize(file.FileSize() + 2, 0);
 		file.Read(buffer.data(), file.FileSize());
+	} else if (!file.GetFileView().Empty()) {
+		// read straight from the archive's mapping or cache
+		bufferData = file.GetFileView().GetData();
+		bufferSize = file.GetFileView().GetSize();
 	} else {
 		// steal if file was loaded from VFS
 		buffer = std::move(file.GetBuffer());
 	}
 
+	if (bufferData == nullptr) {
+		bufferData = buffer.data();
+		bufferSize = buffer.size();
+	}
+
 
 	{
 		std::lock_guard<spring::mutex> lck(bmpMutex);
@@ -295,7 +307,7 @@ bool CBitmap::Load(std::string const& filename, unsigned char defaultAlpha)
 			// do not signal floating point exceptions in devil library
 			ScopedDisableFpuExceptions fe;
 
-			const bool success = !!ilLoadL(IL_TYPE_UNKNOWN, buffer.data(), buffer.size());
+			const bool success = !!ilLoadL(IL_TYPE_UNKNOWN, const_cast<uint8_t*>(bufferData), bufferSize);
 
 			// FPU control word has to be restored as well
 			streflop::streflop_init<streflop::Simple>();
@@ -353,14 +365,26 @@ bool CBitmap::LoadGrayscale(const std::string& filename)
 
 	std::vector<uint8_t> buffer;
 
+	const uint8_t* bufferData = nullptr;
+	size_t bufferSize = 0;
+
 	if (!file.IsBuffered()) {
 		buffer.resize(file.FileSize() + 1, 0);
 		file.Read(buffer.data(), file.FileSize());
+	} else if (!file.GetFileView().Empty()) {
+		// read straight from the archive's mapping or cache
+		bufferData = file.GetFileView().GetData();
+		bufferSize = file.GetFileView().GetSize();
 	} else {
 		// steal if file was loaded from VFS
 		buffer = std::move(file.GetBuffer());
 	}
 
+	if (bufferData == nullptr) {
+		bufferData = buffer.data();
+		bufferSize = buffer.size();
+	}
+
 	{
 		std::lock_guard<spring::mutex> lck(bmpMutex);
 
@@ -371,7 +395,7 @@ bool CBitmap::LoadGrayscale(const std::string& filename)
 		ilGenImages(1, &imageID);
 		ilBindImage(imageID);
 
-		const bool success = !!ilLoadL(IL_TYPE_UNKNOWN, buffer.data(), buffer.size());
+		const bool success = !!ilLoadL(IL_TYPE_UNKNOWN, const_cast<uint8_t*>(bufferData), bufferSize);
 		ilDisable(IL_ORIGIN_SET);
 
 		if (!success)
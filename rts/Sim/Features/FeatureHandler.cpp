@@ -16,6 +16,12 @@
 
 /******************************************************************************/
 
+CR_BIND_TEMPLATE(SimObjectHandleTable<CFeature>, )
+CR_REG_METADATA_TEMPLATE(SimObjectHandleTable<CFeature>, (
+	CR_MEMBER(objects),
+	CR_MEMBER(generations)
+))
+
 CR_BIND(CFeatureHandler, )
 CR_REG_METADATA(CFeatureHandler, (
 	CR_MEMBER(idPool),
@@ -33,16 +39,17 @@ CFeatureHandler* featureHandler = nullptr;
 
 
 CFeatureHandler::CFeatureHandler() {
-	features.resize(MAX_FEATURES, nullptr);
+	features.Resize(MAX_FEATURES);
 	activeFeatureIDs.reserve(MAX_FEATURES);
 
 	featureMemPool.reserve(128);
-	idPool.Expand(0, features.size());
+	idPool.Expand(0, features.Size());
 }
 
 CFeatureHandler::~CFeatureHandler() {
 	for (const int featureID: activeFeatureIDs) {
-		featureMemPool.free(features[featureID]);
+		CFeature* feature = features.GetUnsafe(featureID);
+		featureMemPool.free(feature);
 	}
 
 	// do not clear in ctor because creg-loaded objects would be wiped out
@@ -108,11 +115,10 @@ void CFeatureHandler::InsertActiveFeature(CFeature* feature)
 {
 	idPool.AssignID(feature);
 
-	assert(feature->id < features.size());
-	assert(features[feature->id] == nullptr);
+	assert(features.IsFree(feature->id));
 
 	activeFeatureIDs.insert(feature->id);
-	features[feature->id] = feature;
+	features.Insert(feature->id, feature);
 }
 
 
@@ -196,7 +202,7 @@ bool CFeatureHandler::TryFreeFeatureID(int id)
 		return false;
 	}
 
-	assert(features[id] == nullptr);
+	assert(features.IsFree(id));
 	idPool.FreeID(id, true);
 
 	return true;
@@ -214,7 +220,7 @@ bool CFeatureHandler::UpdateFeature(CFeature* feature)
 		deletedFeatureIDs.push_back(feature->id);
 		activeFeatureIDs.erase(feature->id);
 
-		features[feature->id] = nullptr;
+		features.Erase(feature->id);
 
 		// ID must match parameter for object commands, just use this
 		CSolidObject::SetDeletingRefID(feature->GetBlockingMapID());
@@ -11,6 +11,7 @@
 #include "System/creg/creg_cond.h"
 #include "System/UnorderedSet.hpp"
 #include "Sim/Features/Feature.h"
+#include "Sim/Misc/SimObjectHandleTable.h"
 #include "Sim/Misc/SimObjectIDPool.h"
 
 class CFeature;
@@ -47,7 +48,7 @@ public:
 
 	CFeature* LoadFeature(const FeatureLoadParams& params);
 	CFeature* CreateWreckage(const FeatureLoadParams& params);
-	CFeature* GetFeature(unsigned int id) { return ((id < features.size())? features[id]: nullptr); }
+	CFeature* GetFeature(unsigned int id) { return (features.Get(id)); }
 
 	void Update();
 
@@ -69,8 +70,8 @@ private:
 		if (id < 0)
 			return true;
 		// is this ID not already in use?
-		if (id < features.size())
-			return (features[id] == nullptr);
+		if (id < features.Size())
+			return (features.IsFree(id));
 		// AddFeature will not make new room for us
 		return false;
 	}
@@ -82,7 +83,7 @@ private:
 
 	spring::unordered_set<int> activeFeatureIDs;
 	std::vector<int> deletedFeatureIDs;
-	std::vector<CFeature*> features;
+	SimObjectHandleTable<CFeature> features;
 	std::vector<CFeature*> updateFeatures;
 };
 
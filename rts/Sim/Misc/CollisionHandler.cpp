@@ -7,18 +7,30 @@
 #include "Rendering/Models/3DModel.h"
 #include "Sim/Misc/GroundBlockingObjectMap.h"
 #include "Sim/Misc/GlobalConstants.h"
+#include "Sim/Objects/SolidObject.h"
 #include "System/FastMath.h"
 #include "System/Matrix44f.h"
 #include "System/Log/ILog.h"
+#include "System/Threading/ThreadPool.h"
 
-unsigned int CCollisionHandler::numDiscTests = 0;
-unsigned int CCollisionHandler::numContTests = 0;
+#include <numeric>
+
+#if (__is_x86_arch__ == 1) && !defined(DEDICATED_NOSSE)
+	#include <xmmintrin.h>
+	#define COLVOL_SIMD_SSE 1
+#endif
+
+std::array<unsigned int, ThreadPool::MAX_THREADS> CCollisionHandler::numDiscTests = {{0}};
+std::array<unsigned int, ThreadPool::MAX_THREADS> CCollisionHandler::numContTests = {{0}};
 
 
 
 void CCollisionHandler::PrintStats()
 {
-	LOG("[CCollisionHandler] dis-/continuous tests: %i/%i", numDiscTests, numContTests);
+	const unsigned int sumDiscTests = std::accumulate(numDiscTests.begin(), numDiscTests.end(), 0u);
+	const unsigned int sumContTests = std::accumulate(numContTests.begin(), numContTests.end(), 0u);
+
+	LOG("[CCollisionHandler] dis-/continuous tests: %u/%u", sumDiscTests, sumContTests);
 }
 
 
@@ -73,6 +85,169 @@ bool CCollisionHandler::DetectHit(
 
 
 
+#ifdef COLVOL_SIMD_SSE
+// volume-space bounding-box rejection for four (matrix, volume) lanes; this
+// mirrors Intersect: InvertAffine followed by Mul with w=1 for both ray ends
+// (the per-component operation order is identical, so are the results) and
+// std::min(a, b) / std::max(a, b) as _mm_min_ps(b, a) / _mm_max_ps(b, a) so
+// NaN's propagate the same way
+__FORCE_ALIGN_STACK__
+static int CullBoundingBoxesSSE(const CMatrix44f* mats, const float3* hscales, const float3 p0, const float3 p1)
+{
+	#define LANES(k) _mm_setr_ps(mats[0].m[k], mats[1].m[k], mats[2].m[k], mats[3].m[k])
+	const __m128 m0 = LANES(0), m1 = LANES(1), m2  = LANES( 2);
+	const __m128 m4 = LANES(4), m5 = LANES(5), m6  = LANES( 6);
+	const __m128 m8 = LANES(8), m9 = LANES(9), m10 = LANES(10);
+	#undef LANES
+
+	// flip sign-bits, exactly like unary minus (0-x would turn -0 into +0)
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 tx = _mm_xor_ps(sign, _mm_setr_ps(mats[0].m[12], mats[1].m[12], mats[2].m[12], mats[3].m[12]));
+	const __m128 ty = _mm_xor_ps(sign, _mm_setr_ps(mats[0].m[13], mats[1].m[13], mats[2].m[13], mats[3].m[13]));
+	const __m128 tz = _mm_xor_ps(sign, _mm_setr_ps(mats[0].m[14], mats[1].m[14], mats[2].m[14], mats[3].m[14]));
+
+	// inverse translation (InvertAffineInPlace, rotation is transposed)
+	const __m128 i12 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, m0), _mm_mul_ps(ty, m1)), _mm_mul_ps(tz, m2 ));
+	const __m128 i13 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, m4), _mm_mul_ps(ty, m5)), _mm_mul_ps(tz, m6 ));
+	const __m128 i14 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, m8), _mm_mul_ps(ty, m9)), _mm_mul_ps(tz, m10));
+
+	const auto mul = [&](const float3 p, __m128& x, __m128& y, __m128& z) {
+		const __m128 px = _mm_set1_ps(p.x);
+		const __m128 py = _mm_set1_ps(p.y);
+		const __m128 pz = _mm_set1_ps(p.z);
+
+		x = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, px), _mm_mul_ps(m1, py)), _mm_mul_ps(m2 , pz)), i12);
+		y = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m4, px), _mm_mul_ps(m5, py)), _mm_mul_ps(m6 , pz)), i13);
+		z = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m8, px), _mm_mul_ps(m9, py)), _mm_mul_ps(m10, pz)), i14);
+	};
+
+	__m128 x0, y0, z0; mul(p0, x0, y0, z0);
+	__m128 x1, y1, z1; mul(p1, x1, y1, z1);
+
+	const __m128 hx = _mm_setr_ps(hscales[0].x, hscales[1].x, hscales[2].x, hscales[3].x);
+	const __m128 hy = _mm_setr_ps(hscales[0].y, hscales[1].y, hscales[2].y, hscales[3].y);
+	const __m128 hz = _mm_setr_ps(hscales[0].z, hscales[1].z, hscales[2].z, hscales[3].z);
+
+	__m128 miss = _mm_setzero_ps();
+	miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(_mm_max_ps(x1, x0), _mm_xor_ps(sign, hx)), _mm_cmpgt_ps(_mm_min_ps(x1, x0), hx)));
+	miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(_mm_max_ps(y1, y0), _mm_xor_ps(sign, hy)), _mm_cmpgt_ps(_mm_min_ps(y1, y0), hy)));
+	miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(_mm_max_ps(z1, z0), _mm_xor_ps(sign, hz)), _mm_cmpgt_ps(_mm_min_ps(z1, z0), hz)));
+
+	return (_mm_movemask_ps(miss));
+}
+#endif
+
+void CCollisionHandler::CullHitTests(
+	const CSolidObject* const* objs,
+	const CMatrix44f* mats,
+	const size_t numObjs,
+	const float3 p0,
+	const float3 p1,
+	bool forceTrace,
+	uint8_t* testMask
+) {
+	// continuous tests waiting for a free SIMD lane
+	CMatrix44f laneMats[4];
+	float3 laneScales[4];
+	size_t laneIndices[4];
+	size_t numLanes = 0;
+
+	const auto CullLanes = [&]() {
+		#ifdef COLVOL_SIMD_SSE
+		// pad unused lanes with copies of the first, their results are ignored
+		for (size_t k = numLanes; k < 4; k++) {
+			laneMats[k] = laneMats[0];
+			laneScales[k] = laneScales[0];
+		}
+
+		const int missMask = CullBoundingBoxesSSE(laneMats, laneScales, p0, p1);
+
+		for (size_t k = 0; k < numLanes; k++) {
+			testMask[laneIndices[k]] = ((missMask & (1 << k)) == 0);
+			// culled tests still count as executed
+			numContTests[ThreadPool::GetThreadNum()] += (testMask[laneIndices[k]] == 0);
+		}
+		#endif
+
+		numLanes = 0;
+	};
+
+	for (size_t i = 0; i < numObjs; i++) {
+		const CSolidObject* o = objs[i];
+		const CollisionVolume* v = &o->collisionVolume;
+
+		testMask[i] = 0;
+
+		if (o->IsInVoid())
+			continue;
+
+		// same dispatch as DetectHit; matrices as in Intersect(o, v, m, ...)
+		if (v->DefaultToPieceTree()) {
+			// IntersectPieceTree first tests the model's bounding volume (s=0)
+			v = o->localModel.GetBoundingVolume();
+
+			laneMats[numLanes] = mats[i];
+			laneMats[numLanes].Translate(o->relMidPos * 0.0f);
+			laneMats[numLanes].Translate(v->GetOffsets());
+		} else {
+			if (v->IgnoreHits())
+				continue;
+
+			if (!forceTrace && !v->UseContHitTest()) {
+				testMask[i] = 1;
+				continue;
+			}
+
+			laneMats[numLanes] = mats[i];
+			laneMats[numLanes].Translate(o->relMidPos);
+			laneMats[numLanes].Translate(v->GetOffsets());
+		}
+
+		// without SIMD every continuous test is left to the scalar path
+		testMask[i] = 1;
+
+		laneScales[numLanes] = v->GetHScales();
+		laneIndices[numLanes] = i;
+
+		if ((numLanes += 1) == 4)
+			CullLanes();
+	}
+
+	if (numLanes > 0)
+		CullLanes();
+}
+
+size_t CCollisionHandler::DetectHits(
+	const CSolidObject* const* objs,
+	const CMatrix44f* mats,
+	const size_t numObjs,
+	const float3 p0,
+	const float3 p1,
+	uint8_t* hits,
+	CollisionQuery* cqs,
+	bool forceTrace
+) {
+	size_t numHits = 0;
+
+	CullHitTests(objs, mats, numObjs, p0, p1, forceTrace, hits);
+
+	for (size_t i = 0; i < numObjs; i++) {
+		CollisionQuery* cq = (cqs != nullptr)? &cqs[i]: nullptr;
+
+		if (hits[i] == 0) {
+			if (cq != nullptr)
+				cq->Reset();
+
+			continue;
+		}
+
+		numHits += (hits[i] = DetectHit(objs[i], mats[i], p0, p1, cq, forceTrace));
+	}
+
+	return numHits;
+}
+
+
 bool CCollisionHandler::Collision(
 	const CSolidObject* o,
 	const CollisionVolume* v,
@@ -137,7 +312,7 @@ bool CCollisionHandler::CollisionFootPrint(const CSolidObject* o, const float3&
 
 bool CCollisionHandler::Collision(const CollisionVolume* v, const CMatrix44f& m, const float3& p)
 {
-	numDiscTests += 1;
+	numDiscTests[ThreadPool::GetThreadNum()] += 1;
 
 	// get the inverse volume transformation matrix and
 	// apply it to the projectile's position, then test
@@ -346,7 +521,7 @@ inline bool CCollisionHandler::Intersect(
 
 bool CCollisionHandler::Intersect(const CollisionVolume* v, const CMatrix44f& m, const float3& p0, const float3& p1, CollisionQuery* q)
 {
-	numContTests += 1;
+	numContTests[ThreadPool::GetThreadNum()] += 1;
 
 	const CMatrix44f mInv = m.InvertAffine();
 	const float3 pi0 = mInv.Mul(p0);
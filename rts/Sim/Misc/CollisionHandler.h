@@ -5,13 +5,15 @@
 
 #include "System/creg/creg_cond.h"
 #include "System/float3.h"
+#include "System/Matrix44f.h"
+#include "System/Threading/ThreadPool.h"
 
 #include <algorithm>
+#include <array>
 
 class CSolidObject;
 struct LocalModelPiece;
 struct CollisionVolume;
-class CMatrix44f;
 
 enum {
 	CQ_POINT_NO_INT = 0,
@@ -96,6 +98,40 @@ class CCollisionHandler {
 			CollisionQuery* cq = nullptr,
 			bool forceTrace = false
 		);
+
+		/**
+		 * Batched pre-pass for DetectHit(objs[i], mats[i], p0, p1, *, forceTrace);
+		 * sets testMask[i] to 0 iff that call is certain to return false,
+		 * otherwise to 1 (caller has to run the scalar test). Continuous
+		 * tests are culled four volumes at a time with SSE, using the same
+		 * float-ops as the bounding-box early-out in Intersect, so culled
+		 * and scalar results are bit-identical (safe for synced code).
+		 */
+		static void CullHitTests(
+			const CSolidObject* const* objs,
+			const CMatrix44f* mats,
+			const size_t numObjs,
+			const float3 p0,
+			const float3 p1,
+			bool forceTrace,
+			uint8_t* testMask
+		);
+		/**
+		 * Batched DetectHit for one segment against many objects; sets
+		 * hits[i] (and cqs[i] if non-null) exactly as DetectHit would.
+		 * @return number of objects hit
+		 */
+		static size_t DetectHits(
+			const CSolidObject* const* objs,
+			const CMatrix44f* mats,
+			const size_t numObjs,
+			const float3 p0,
+			const float3 p1,
+			uint8_t* hits,
+			CollisionQuery* cqs = nullptr,
+			bool forceTrace = false
+		);
+
 		static bool MouseHit(
 			const CSolidObject* o,
 			const CMatrix44f& m,
@@ -152,8 +188,43 @@ class CCollisionHandler {
 		static bool IntersectBox(const CollisionVolume* v, const float3& pi0, const float3& pi1, CollisionQuery* cq);
 
 	private:
-		static unsigned int numDiscTests; // number of discrete hit-tests executed
-		static unsigned int numContTests; // number of continuous hit-tests executed (inc. unsynced)
+		// per ThreadPool thread, DetectHit may be called from workers
+		static std::array<unsigned int, ThreadPool::MAX_THREADS> numDiscTests; // number of discrete hit-tests executed
+		static std::array<unsigned int, ThreadPool::MAX_THREADS> numContTests; // number of continuous hit-tests executed (inc. unsynced)
+};
+
+
+/**
+ * Fixed-capacity staging area for CCollisionHandler::CullHitTests
+ * and DetectHits, callers fill it while walking their candidates
+ */
+template<size_t N> struct CollisionTestBatch {
+public:
+	bool Empty() const { return (size == 0); }
+	bool Full() const { return (size == N); }
+
+	void Clear() { size = 0; }
+	void Add(const CSolidObject* o, const CMatrix44f& m) {
+		assert(!Full());
+		objs[size] = o;
+		mats[size] = m;
+		size += 1;
+	}
+
+	size_t DetectHits(const float3 p0, const float3 p1, bool forceTrace = false) {
+		return (CCollisionHandler::DetectHits(objs.data(), mats.data(), size, p0, p1, flags.data(), nullptr, forceTrace));
+	}
+	void CullHitTests(const float3 p0, const float3 p1, bool forceTrace = false) {
+		CCollisionHandler::CullHitTests(objs.data(), mats.data(), size, p0, p1, forceTrace, flags.data());
+	}
+
+public:
+	std::array<const CSolidObject*, N> objs;
+	std::array<CMatrix44f, N> mats;
+	// hit- or test-mask, depending on the last call
+	std::array<uint8_t, N> flags;
+
+	size_t size = 0;
 };
 
 #endif // COLLISION_HANDLER_H
@@ -505,14 +505,40 @@ void ILosType::Update()
 		}
 	}
 
-	// remove sight
-	//FIXME multithread?
+	// every allyteam has its own map, so the refcount changes can be
+	// applied to all of them concurrently; within one map the order of
+	// removes and adds is the same as in losRemove and losAdd
+	allyTeamRemoves.resize(losMaps.size());
+	allyTeamAdds.resize(losMaps.size());
+
+	for (size_t n = 0; n < losMaps.size(); n++) {
+		allyTeamRemoves[n].clear();
+		allyTeamAdds[n].clear();
+	}
+
 	for (SLosInstance* li: losRemove) {
-		LosRemove(li);
+		allyTeamRemoves[li->allyteam].push_back(li);
 	}
+	for (SLosInstance* li: losAdd) {
+		allyTeamAdds[li->allyteam].push_back(li);
+	}
+
+	// remove sight
+	for_mt(0, losMaps.size(), [&](const int allyTeam) {
+		for (SLosInstance* li: allyTeamRemoves[allyTeam]) {
+			LosRemove(li);
+		}
+	});
 
 	// raycast terrain
 	if (algoType == LOS_ALGO_RAYCAST)  {
+		// largest instances first, s.t. no worker gets stuck with a
+		// long-range radar at the end of the range (results are per
+		// instance so their order does not matter)
+		std::stable_sort(losRecalc.begin(), losRecalc.end(), [](const SLosInstance* a, const SLosInstance* b) {
+			return (a->radius > b->radius);
+		});
+
 		for_mt(0, losRecalc.size(), [&](const int idx) {
 			auto li = losRecalc[idx];
 			assert(li->refCount > 0);
@@ -522,9 +548,16 @@ void ILosType::Update()
 	}
 
 	// add sight
-	for (SLosInstance* li: losAdd) {
-		assert(li->refCount > 0);
-		LosAdd(li);
+	for_mt(0, losMaps.size(), [&](const int allyTeam) {
+		for (SLosInstance* li: allyTeamAdds[allyTeam]) {
+			assert(li->refCount > 0);
+			LosAdd(li);
+		}
+	});
+
+	// unsynced readmap notifications are not thread-safe
+	for (CLosMap& losMap: losMaps) {
+		losMap.FlushReadmapEvents();
 	}
 
 	// delete / move to cache unused instances
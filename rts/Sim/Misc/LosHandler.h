@@ -189,6 +189,10 @@ private:
 	std::vector<SLosInstance*> losDeleted;
 	std::vector<SLosInstance*> losRecalc;
 
+	// per-allyteam slices of losRemove and losAdd (same relative order)
+	std::vector< std::vector<SLosInstance*> > allyTeamRemoves;
+	std::vector< std::vector<SLosInstance*> > allyTeamAdds;
+
 	static constexpr int CACHE_SIZE = 4096;
 };
 
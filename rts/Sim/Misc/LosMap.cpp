@@ -2,6 +2,7 @@
 
 #include "LosMap.h"
 #include "LosHandler.h"
+#include "LosRayCast.h"
 #include "Map/ReadMap.h"
 #include "System/myMath.h"
 #include "System/float3.h"
@@ -14,8 +15,6 @@
 #include <algorithm>
 #include <array>
 
-constexpr float LOS_BONUS_HEIGHT = 5.0f;
-
 
 
 static std::array<std::vector<float>, ThreadPool::MAX_THREADS> isqrtTables;
@@ -112,6 +111,10 @@ public:
 		return losTables[losSize][rayIndex][squareIdx];
 	}
 
+	const int2* GetLosTableRay(size_t losSize, size_t rayIndex) {
+		return &losTables[losSize][rayIndex][0];
+	}
+
 	size_t GetLosTableRaySize(size_t losSize, size_t rayIndex) {
 		return losTables[losSize][rayIndex].size();
 	}
@@ -426,12 +429,7 @@ void CLosMap::AddRaycast(SLosInstance* instance, int amount)
 				if (losmap[idx] != amount)
 					continue;
 
-				const int2 lm = IdxToCoord(idx, size.x);
-				const int2 p1 = (lm             ) * LOS2HEIGHT;
-				const int2 p2 = (lm + int2(1, 1)) * LOS2HEIGHT;
-				const int2 p3 = {std::min(p2.x, mapDims.mapxm1), std::min(p2.y, mapDims.mapym1)};
-
-				readMap->UpdateLOS(SRectangle(p1.x, p1.y,  p3.x, p3.y));
+				enteredSquares.push_back(idx);
 			}
 		}
 
@@ -449,6 +447,23 @@ void CLosMap::AddRaycast(SLosInstance* instance, int amount)
 }
 
 
+void CLosMap::FlushReadmapEvents()
+{
+#ifdef USE_UNSYNCED_HEIGHTMAP
+	for (const int idx: enteredSquares) {
+		const int2 lm = IdxToCoord(idx, size.x);
+		const int2 p1 = (lm             ) * LOS2HEIGHT;
+		const int2 p2 = (lm + int2(1, 1)) * LOS2HEIGHT;
+		const int2 p3 = {std::min(p2.x, mapDims.mapxm1), std::min(p2.y, mapDims.mapym1)};
+
+		readMap->UpdateLOS(SRectangle(p1.x, p1.y,  p3.x, p3.y));
+	}
+#endif
+
+	enteredSquares.clear();
+}
+
+
 void CLosMap::PrepareRaycast(SLosInstance* instance) const
 {
 	if (!instance->squares.empty())
@@ -491,31 +506,43 @@ void CLosMap::LosAdd(SLosInstance* li) const
 }
 
 
-inline static constexpr size_t ToAngleMapIdx(const int2 p, const int radius)
+using LosRayCast::ToAngleMapIdx;
+
+inline void CastLos(float* prevAng, float* maxAng, const int2& off, std::vector<char>& squaresMap, std::vector<float>& anglesMap, int radius, int threadNum)
 {
-	// [-radius, +radius]^2 -> [0, +2*radius]^2 -> idx
-	return (p.y + radius) * (2*radius + 1) + (p.x + radius);
+	LosRayCast::CastLos(prevAng, maxAng, off, squaresMap.data(), anglesMap.data(), isqrtTables[threadNum].data(), radius);
 }
 
 
-inline void CastLos(float* prevAng, float* maxAng, const int2& off, std::vector<char>& squaresMap, std::vector<float>& anglesMap, int radius, int threadNum)
+static void CastLosRays(CLosTableHelper& helper, std::vector<char>& squaresMap, std::vector<float>& anglesMap, int radius, int threadNum)
 {
-	// check if we got a new maxAngle
-	const size_t oidx = ToAngleMapIdx(off, radius);
-	if (anglesMap[oidx] < *maxAng) {
-		squaresMap[oidx] = false;
-		return;
+	static const bool useAVX = LosRayCast::HaveAVX();
+	static const bool useSSE = LosRayCast::HaveSSE();
+
+	const size_t numRays = helper.GetLosTableSize(radius);
+	const float* isqrtTable = isqrtTables[threadNum].data();
+
+	size_t i = 0;
+
+	if (useAVX) {
+		for (; (i + 1) < numRays; i += 2) {
+			const int2* rays[2] = {helper.GetLosTableRay(radius, i), helper.GetLosTableRay(radius, i + 1)};
+			const size_t numSquares[2] = {helper.GetLosTableRaySize(radius, i), helper.GetLosTableRaySize(radius, i + 1)};
+
+			LosRayCast::CastLosRayPairAVX(rays, numSquares, squaresMap.data(), anglesMap.data(), isqrtTable, radius);
+		}
 	}
 
-	if (anglesMap[oidx] < *prevAng) {
-		const float invR = isqrtTableLookup(off.x*off.x + off.y*off.y, threadNum);
-		*maxAng = *prevAng - LOS_BONUS_HEIGHT * invR;
-		if (anglesMap[oidx] < *maxAng) {
-			squaresMap[oidx] = false;
-			return;
+	for (; i < numRays; ++i) {
+		const int2* ray = helper.GetLosTableRay(radius, i);
+		const size_t numSquares = helper.GetLosTableRaySize(radius, i);
+
+		if (useSSE) {
+			LosRayCast::CastLosRaySSE(ray, numSquares, squaresMap.data(), anglesMap.data(), isqrtTable, radius);
+		} else {
+			LosRayCast::CastLosRay(ray, numSquares, squaresMap.data(), anglesMap.data(), isqrtTable, radius);
 		}
 	}
-	*prevAng = anglesMap[oidx];
 }
 
 
@@ -603,22 +630,7 @@ void CLosMap::UnsafeLosAdd(SLosInstance* li) const
 
 	// Cast the Rays
 	squaresMap[ToAngleMapIdx(int2(0,0), radius)] = true;
-	const size_t numRays = helper.GetLosTableSize(radius);
-	for (size_t i = 0; i < numRays; ++i) {
-		float maxAng[4] = {-1e7, -1e7, -1e7, -1e7};
-		float prevAng[4] = {-1e7, -1e7, -1e7, -1e7};
-
-		const size_t numSquares = helper.GetLosTableRaySize(radius, i);
-
-		for (size_t n = 0; n < numSquares; n++) {
-			const int2 square = helper.GetLosTableRaySquare(radius, i, n);
-
-			CastLos(&prevAng[0], &maxAng[0], square,                    squaresMap, anglesMap, radius, threadNum);
-			CastLos(&prevAng[1], &maxAng[1], -square,                   squaresMap, anglesMap, radius, threadNum);
-			CastLos(&prevAng[2], &maxAng[2], int2(square.y, -square.x), squaresMap, anglesMap, radius, threadNum);
-			CastLos(&prevAng[3], &maxAng[3], int2(-square.y, square.x), squaresMap, anglesMap, radius, threadNum);
-		}
-	}
+	CastLosRays(helper, squaresMap, anglesMap, radius, threadNum);
 
 	// translate visible square indices to map square idx + RLE
 	AddSquaresToInstance(li, squaresMap);
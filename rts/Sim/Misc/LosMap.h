@@ -35,6 +35,10 @@ public:
 	/// arbitrary area, for losMap, non-circular radar maps, ...
 	void PrepareRaycast(SLosInstance* instance) const;
 
+	/// passes squares that entered LOS during AddRaycast on to the ReadMap
+	/// (deferred so multiple maps can be updated from different threads)
+	void FlushReadmapEvents();
+
 public:
 	int At(int2 p) const {
 		p.x = Clamp(p.x, 0, size.x - 1);
@@ -56,6 +60,7 @@ protected:
 	const int2 size;
 	const int2 LOS2HEIGHT;
 	std::vector<unsigned short> losmap;
+	std::vector<int> enteredSquares;
 	bool sendReadmapEvents;
 	const float* const heightmap;
 };
@@ -0,0 +1,173 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "LosRayCast.h"
+#include "System/MainDefines.h"
+
+#include <algorithm>
+
+// the engine is built with -msse -mno-sse2 (see TestCXXFlags.cmake), so the
+// baseline kernel only uses SSE1 float ops; the AVX one is selected at runtime
+#if (__is_x86_arch__ == 1) && !defined(DEDICATED_NOSSE)
+	#include <xmmintrin.h>
+	#define LOS_SIMD_SSE 1
+	#if defined(__GNUC__)
+		#include <immintrin.h>
+		#define LOS_SIMD_AVX 1
+	#endif
+#endif
+
+
+// Every ray is cast in its four mirrored directions (square, -square and
+// both 90-degree rotations), which are independent of each other and map
+// directly onto SIMD lanes. Rays only ever clear entries of squaresMap and
+// only read anglesMap, so the final square set does not depend on the order
+// in which rays (or lanes) are processed.
+
+static inline void GetMirroredAngleMapIndices(const int2 square, const int radius, size_t* indices)
+{
+	indices[0] = LosRayCast::ToAngleMapIdx(square,                    radius);
+	indices[1] = LosRayCast::ToAngleMapIdx(-square,                   radius);
+	indices[2] = LosRayCast::ToAngleMapIdx(int2(square.y, -square.x), radius);
+	indices[3] = LosRayCast::ToAngleMapIdx(int2(-square.y, square.x), radius);
+}
+
+
+void LosRayCast::CastLosRay(const int2* ray, size_t numSquares, char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius)
+{
+	float maxAng[4] = {-1e7, -1e7, -1e7, -1e7};
+	float prevAng[4] = {-1e7, -1e7, -1e7, -1e7};
+
+	for (size_t n = 0; n < numSquares; n++) {
+		const int2 square = ray[n];
+
+		CastLos(&prevAng[0], &maxAng[0], square,                    squaresMap, anglesMap, isqrtTable, radius);
+		CastLos(&prevAng[1], &maxAng[1], -square,                   squaresMap, anglesMap, isqrtTable, radius);
+		CastLos(&prevAng[2], &maxAng[2], int2(square.y, -square.x), squaresMap, anglesMap, isqrtTable, radius);
+		CastLos(&prevAng[3], &maxAng[3], int2(-square.y, square.x), squaresMap, anglesMap, isqrtTable, radius);
+	}
+}
+
+
+#ifdef LOS_SIMD_SSE
+bool LosRayCast::HaveSSE() { return true; }
+
+__FORCE_ALIGN_STACK__
+void LosRayCast::CastLosRaySSE(const int2* ray, size_t numSquares, char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius)
+{
+	const __m128 bonusHeight = _mm_set1_ps(LOS_BONUS_HEIGHT);
+
+	__m128 maxAng = _mm_set1_ps(-1e7f);
+	__m128 prevAng = _mm_set1_ps(-1e7f);
+
+	size_t indices[4];
+
+	for (size_t n = 0; n < numSquares; n++) {
+		const int2 square = ray[n];
+
+		GetMirroredAngleMapIndices(square, radius, indices);
+
+		const __m128 curAng = _mm_setr_ps(anglesMap[indices[0]], anglesMap[indices[1]], anglesMap[indices[2]], anglesMap[indices[3]]);
+		const __m128 invRad = _mm_set1_ps(isqrtTable[square.x * square.x + square.y * square.y]);
+
+		// lanes below the current hilltop are hidden
+		const __m128 belowMax = _mm_cmplt_ps(curAng, maxAng);
+		// lanes that just passed a hilltop record it as the new maximum
+		const __m128 newMax = _mm_andnot_ps(belowMax, _mm_cmplt_ps(curAng, prevAng));
+
+		maxAng = _mm_or_ps(_mm_and_ps(newMax, _mm_sub_ps(prevAng, _mm_mul_ps(bonusHeight, invRad))), _mm_andnot_ps(newMax, maxAng));
+
+		const __m128 hidden = _mm_or_ps(belowMax, _mm_and_ps(newMax, _mm_cmplt_ps(curAng, maxAng)));
+		const int hiddenMask = _mm_movemask_ps(hidden);
+
+		prevAng = _mm_or_ps(_mm_and_ps(hidden, prevAng), _mm_andnot_ps(hidden, curAng));
+
+		for (int k = 0; k < 4; k++) {
+			if ((hiddenMask & (1 << k)) != 0)
+				squaresMap[indices[k]] = false;
+		}
+	}
+}
+
+#else
+
+bool LosRayCast::HaveSSE() { return false; }
+
+void LosRayCast::CastLosRaySSE(const int2* ray, size_t numSquares, char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius)
+{
+	CastLosRay(ray, numSquares, squaresMap, anglesMap, isqrtTable, radius);
+}
+#endif
+
+
+#ifdef LOS_SIMD_AVX
+bool LosRayCast::HaveAVX()
+{
+	#if defined(__clang__) || (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8)
+	__builtin_cpu_init();
+	return (__builtin_cpu_supports("avx"));
+	#else
+	return false;
+	#endif
+}
+
+__attribute__((target("avx"))) __FORCE_ALIGN_STACK__
+void LosRayCast::CastLosRayPairAVX(const int2* const rays[2], const size_t numSquares[2], char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius)
+{
+	const size_t maxSquares = std::max(numSquares[0], numSquares[1]);
+
+	const __m256 bonusHeight = _mm256_set1_ps(LOS_BONUS_HEIGHT);
+
+	__m256 maxAng = _mm256_set1_ps(-1e7f);
+	__m256 prevAng = _mm256_set1_ps(-1e7f);
+
+	size_t indices[8];
+	float invRads[2];
+
+	for (size_t n = 0; n < maxSquares; n++) {
+		// the shorter ray keeps casting the center square with all its lanes masked out
+		int activeMask = 0;
+
+		for (int r = 0; r < 2; r++) {
+			const bool active = (n < numSquares[r]);
+			const int2 square = active? rays[r][n]: int2(0, 0);
+
+			GetMirroredAngleMapIndices(square, radius, &indices[r * 4]);
+
+			invRads[r] = active? isqrtTable[square.x * square.x + square.y * square.y]: 0.0f;
+			activeMask |= (0xF * active) << (r * 4);
+		}
+
+		const __m256 curAng = _mm256_setr_ps(
+			anglesMap[indices[0]], anglesMap[indices[1]], anglesMap[indices[2]], anglesMap[indices[3]],
+			anglesMap[indices[4]], anglesMap[indices[5]], anglesMap[indices[6]], anglesMap[indices[7]]
+		);
+		const __m256 invRad = _mm256_setr_ps(invRads[0], invRads[0], invRads[0], invRads[0], invRads[1], invRads[1], invRads[1], invRads[1]);
+
+		// same logic as CastLosRaySSE
+		const __m256 belowMax = _mm256_cmp_ps(curAng, maxAng, _CMP_LT_OQ);
+		const __m256 newMax = _mm256_andnot_ps(belowMax, _mm256_cmp_ps(curAng, prevAng, _CMP_LT_OQ));
+
+		maxAng = _mm256_blendv_ps(maxAng, _mm256_sub_ps(prevAng, _mm256_mul_ps(bonusHeight, invRad)), newMax);
+
+		const __m256 hidden = _mm256_or_ps(belowMax, _mm256_and_ps(newMax, _mm256_cmp_ps(curAng, maxAng, _CMP_LT_OQ)));
+		const int hiddenMask = _mm256_movemask_ps(hidden) & activeMask;
+
+		prevAng = _mm256_blendv_ps(curAng, prevAng, hidden);
+
+		for (int k = 0; k < 8; k++) {
+			if ((hiddenMask & (1 << k)) != 0)
+				squaresMap[indices[k]] = false;
+		}
+	}
+}
+
+#else
+
+bool LosRayCast::HaveAVX() { return false; }
+
+void LosRayCast::CastLosRayPairAVX(const int2* const rays[2], const size_t numSquares[2], char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius)
+{
+	CastLosRaySSE(rays[0], numSquares[0], squaresMap, anglesMap, isqrtTable, radius);
+	CastLosRaySSE(rays[1], numSquares[1], squaresMap, anglesMap, isqrtTable, radius);
+}
+#endif
@@ -0,0 +1,63 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef LOS_RAYCAST_H
+#define LOS_RAYCAST_H
+
+#include <cstddef>
+
+#include "System/type2.h"
+
+constexpr float LOS_BONUS_HEIGHT = 5.0f;
+
+
+/**
+ * Raycasting kernels used by CLosMap::UnsafeLosAdd.
+ *
+ * A ray is a list of squares in the upper right sector relative to the LOS
+ * center (see CLosTableHelper) and every ray is cast in its four mirrored
+ * directions. squaresMap and anglesMap are (2*radius+1)^2 arrays indexed by
+ * ToAngleMapIdx, isqrtTable holds 1/sqrt(r) for r <= (radius+1)^2. Squares
+ * hidden by the heightmap are cleared in squaresMap, all kernels produce
+ * the exact same result as CastLosRay.
+ */
+namespace LosRayCast {
+	inline constexpr size_t ToAngleMapIdx(const int2 p, const int radius)
+	{
+		// [-radius, +radius]^2 -> [0, +2*radius]^2 -> idx
+		return (p.y + radius) * (2*radius + 1) + (p.x + radius);
+	}
+
+	inline void CastLos(float* prevAng, float* maxAng, const int2& off, char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius)
+	{
+		// check if we got a new maxAngle
+		const size_t oidx = ToAngleMapIdx(off, radius);
+		if (anglesMap[oidx] < *maxAng) {
+			squaresMap[oidx] = false;
+			return;
+		}
+
+		if (anglesMap[oidx] < *prevAng) {
+			const float invR = isqrtTable[off.x*off.x + off.y*off.y];
+			*maxAng = *prevAng - LOS_BONUS_HEIGHT * invR;
+			if (anglesMap[oidx] < *maxAng) {
+				squaresMap[oidx] = false;
+				return;
+			}
+		}
+		*prevAng = anglesMap[oidx];
+	}
+
+	/// scalar reference implementation
+	void CastLosRay(const int2* ray, size_t numSquares, char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius);
+
+	/// true if CastLosRaySSE is compiled in
+	bool HaveSSE();
+	/// true if CastLosRayPairAVX is compiled in and supported by this CPU
+	bool HaveAVX();
+
+	void CastLosRaySSE(const int2* ray, size_t numSquares, char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius);
+	/// casts two rays together, eight lanes; they may differ in length
+	void CastLosRayPairAVX(const int2* const rays[2], const size_t numSquares[2], char* squaresMap, const float* anglesMap, const float* isqrtTable, int radius);
+}
+
+#endif
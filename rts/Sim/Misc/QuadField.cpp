@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <algorithm>
+#include <limits>
 
 #include "QuadField.h"
 #include "Map/ReadMap.h"
@@ -9,6 +10,7 @@
 #include "Sim/Misc/GlobalConstants.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "System/ContainerUtil.h"
+#include "System/Threading/ThreadPool.h"
 
 #ifndef UNIT_TEST
 	#include "Sim/Features/Feature.h"
@@ -25,11 +27,8 @@ CR_REG_METADATA(CQuadField, (
 	CR_MEMBER(quadSizeX),
 	CR_MEMBER(quadSizeZ),
 
-	CR_IGNORED(tempUnits),
-	CR_IGNORED(tempFeatures),
-	CR_IGNORED(tempProjectiles),
-	CR_IGNORED(tempSolids),
-	CR_IGNORED(tempQuads)
+	CR_IGNORED(threadBuffers),
+	CR_IGNORED(updateCount)
 ))
 
 CR_BIND(CQuadField::Quad, )
@@ -126,6 +125,9 @@ CQuadField::CQuadField(int2 mapDims, int quad_size)
 	assert((mapDims.y * SQUARE_SIZE) % quad_size == 0);
 
 	baseQuads.resize(numQuadsX * numQuadsZ);
+	threadBuffers.resize(ThreadPool::MAX_THREADS * 2);
+
+	updateCount = 0;
 }
 
 
@@ -134,6 +136,15 @@ CQuadField::~CQuadField()
 }
 
 
+CQuadField::ThreadBuffers& CQuadField::GetThreadBuffers()
+{
+	const int threadIdx = ThreadPool::GetThreadNum() + ThreadPool::IsAsyncThread() * ThreadPool::MAX_THREADS;
+
+	assert(threadIdx < threadBuffers.size());
+	return threadBuffers[threadIdx];
+}
+
+
 int2 CQuadField::WorldPosToQuadField(const float3 p) const
 {
 	return int2(
@@ -154,7 +165,7 @@ void CQuadField::GetQuads(QuadFieldQuery& qfq, float3 pos, float radius)
 {
 	pos.AssertNaNs();
 	pos.ClampInBounds();
-	qfq.quads = tempQuads.GetVector();
+	qfq.quads = GetThreadBuffers().tempQuads.GetVector();
 
 	const int2 min = WorldPosToQuadField(pos - radius);
 	const int2 max = WorldPosToQuadField(pos + radius);
@@ -184,7 +195,7 @@ void CQuadField::GetQuadsRectangle(QuadFieldQuery& qfq, const float3& mins, cons
 {
 	mins.AssertNaNs();
 	maxs.AssertNaNs();
-	qfq.quads = tempQuads.GetVector();
+	qfq.quads = GetThreadBuffers().tempQuads.GetVector();
 
 	const int2 min = WorldPosToQuadField(mins);
 	const int2 max = WorldPosToQuadField(maxs);
@@ -210,7 +221,7 @@ void CQuadField::GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const f
 {
 	dir.AssertNaNs();
 	start.AssertNaNs();
-	qfq.quads = tempQuads.GetVector();
+	qfq.quads = GetThreadBuffers().tempQuads.GetVector();
 
 	const float3 to = start + (dir * length);
 	const float3 invQuadSize = float3(1.0f / quadSizeX, 1.0f, 1.0f / quadSizeZ);
@@ -305,6 +316,7 @@ void CQuadField::MovedUnit(CUnit* unit)
 	}
 
 	unit->quads = std::move(*qfQuery.quads);
+	updateCount += 1;
 }
 
 void CQuadField::RemoveUnit(CUnit* unit)
@@ -315,6 +327,7 @@ void CQuadField::RemoveUnit(CUnit* unit)
 	}
 
 	unit->quads.clear();
+	updateCount += 1;
 
 	#ifdef DEBUG_QUADFIELD
 	for (const Quad& q: baseQuads) {
@@ -377,6 +390,8 @@ void CQuadField::AddFeature(CFeature* feature)
 	for (const int qi: *qfQuery.quads) {
 		spring::VectorInsertUnique(baseQuads[qi].features, feature, false);
 	}
+
+	updateCount += 1;
 }
 
 void CQuadField::RemoveFeature(CFeature* feature)
@@ -388,6 +403,8 @@ void CQuadField::RemoveFeature(CFeature* feature)
 		spring::VectorErase(baseQuads[qi].features, feature);
 	}
 
+	updateCount += 1;
+
 	#ifdef DEBUG_QUADFIELD
 	for (const Quad& q: baseQuads) {
 		for (CFeature* f: q.features) {
@@ -455,7 +472,7 @@ void CQuadField::GetUnits(QuadFieldQuery& qfq, const float3& pos, float radius)
 	QuadFieldQuery qfQuery;
 	GetQuads(qfQuery, pos, radius);
 	const int tempNum = gs->GetTempNum();
-	qfq.units = tempUnits.GetVector();
+	qfq.units = GetThreadBuffers().tempUnits.GetVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CUnit* u: baseQuads[qi].units) {
@@ -475,7 +492,7 @@ void CQuadField::GetUnitsExact(QuadFieldQuery& qfq, const float3& pos, float rad
 	QuadFieldQuery qfQuery;
 	GetQuads(qfQuery, pos, radius);
 	const int tempNum = gs->GetTempNum();
-	qfq.units = tempUnits.GetVector();
+	qfq.units = GetThreadBuffers().tempUnits.GetVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CUnit* u: baseQuads[qi].units) {
@@ -500,12 +517,37 @@ void CQuadField::GetUnitsExact(QuadFieldQuery& qfq, const float3& pos, float rad
 	return;
 }
 
+void CQuadField::GetUnitsExactBatch(
+	QuadFieldBatchQuery& qfbq,
+	const float4* spheres,
+	const size_t numSpheres,
+	bool spherical
+) {
+	ThreadBuffers& tb = GetThreadBuffers();
+
+	qfbq.Clear();
+	qfbq.offsets.reserve(numSpheres + 1);
+
+	const auto quadUnits = [&](int qi) -> const std::vector<CUnit*>& { return baseQuads[qi].units; };
+
+	for (size_t n = 0; n < numSpheres; n++) {
+		const float3 pos = spheres[n];
+		const float radius = spheres[n].w;
+
+		QuadFieldQuery qfQuery;
+		GetQuads(qfQuery, pos, radius);
+		GetObjectsExact(qfbq.units, tb.unitStamps, *qfQuery.quads, quadUnits, pos, radius, spherical);
+
+		qfbq.offsets.push_back(qfbq.units.size());
+	}
+}
+
 void CQuadField::GetUnitsExact(QuadFieldQuery& qfq, const float3& mins, const float3& maxs)
 {
 	QuadFieldQuery qfQuery;
 	GetQuadsRectangle(qfQuery, mins, maxs);
 	const int tempNum = gs->GetTempNum();
-	qfq.units = tempUnits.GetVector();
+	qfq.units = GetThreadBuffers().tempUnits.GetVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CUnit* unit: baseQuads[qi].units) {
@@ -534,7 +576,7 @@ void CQuadField::GetFeaturesExact(QuadFieldQuery& qfq, const float3& pos, float
 	QuadFieldQuery qfQuery;
 	GetQuads(qfQuery, pos, radius);
 	const int tempNum = gs->GetTempNum();
-	qfq.features = tempFeatures.GetVector();
+	qfq.features = GetThreadBuffers().tempFeatures.GetVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CFeature* f: baseQuads[qi].features) {
@@ -564,7 +606,7 @@ void CQuadField::GetFeaturesExact(QuadFieldQuery& qfq, const float3& mins, const
 	QuadFieldQuery qfQuery;
 	GetQuadsRectangle(qfQuery, mins, maxs);
 	const int tempNum = gs->GetTempNum();
-	qfq.features = tempFeatures.GetVector();
+	qfq.features = GetThreadBuffers().tempFeatures.GetVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CFeature* feature: baseQuads[qi].features) {
@@ -593,7 +635,7 @@ void CQuadField::GetProjectilesExact(QuadFieldQuery& qfq, const float3& pos, flo
 	QuadFieldQuery qfQuery;
 	GetQuads(qfQuery, pos, radius);
 	const int tempNum = gs->GetTempNum();
-	qfq.projectiles = tempProjectiles.GetVector();
+	qfq.projectiles = GetThreadBuffers().tempProjectiles.GetVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CProjectile* p: baseQuads[qi].projectiles) {
@@ -617,7 +659,7 @@ void CQuadField::GetProjectilesExact(QuadFieldQuery& qfq, const float3& mins, co
 	QuadFieldQuery qfQuery;
 	GetQuadsRectangle(qfQuery, mins, maxs);
 	const int tempNum = gs->GetTempNum();
-	qfq.projectiles = tempProjectiles.GetVector();
+	qfq.projectiles = GetThreadBuffers().tempProjectiles.GetVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CProjectile* p: baseQuads[qi].projectiles) {
@@ -651,7 +693,7 @@ void CQuadField::GetSolidsExact(
 	QuadFieldQuery qfQuery;
 	GetQuads(qfQuery, pos, radius);
 	const int tempNum = gs->GetTempNum();
-	qfq.solids = tempSolids.GetVector();
+	qfq.solids = GetThreadBuffers().tempSolids.GetVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CUnit* u: baseQuads[qi].units) {
@@ -806,4 +848,79 @@ void CQuadField::GetUnitsAndFeaturesColVol(
 		}
 	}
 }
+
+void CQuadField::GetUnitsAndFeaturesColVolBatch(
+	QuadFieldColVolBatchQuery& qfbq,
+	const float4* spheres,
+	const size_t numSpheres
+) {
+	ThreadBuffers& tb = GetThreadBuffers();
+
+	qfbq.Clear();
+	qfbq.unitOffsets.reserve(numSpheres + 1);
+	qfbq.featureOffsets.reserve(numSpheres + 1);
+	qfbq.repulserOffsets.reserve(numSpheres + 1);
+
+	for (size_t n = 0; n < numSpheres; n++) {
+		const float3 pos = spheres[n];
+		const float radius = spheres[n].w;
+
+		tb.unitStamps.Next();
+		tb.featureStamps.Next();
+
+		QuadFieldQuery qfQuery;
+		GetQuads(qfQuery, pos, radius);
+
+		// same traversal order and filters as GetUnitsAndFeaturesColVol
+		for (const int qi: *qfQuery.quads) {
+			const Quad& quad = baseQuads[qi];
+
+			for (CUnit* u: quad.units) {
+				if (!tb.unitStamps.Mark(u->id))
+					continue;
+
+				const auto* colvol = &u->collisionVolume;
+				const float totRad = radius + colvol->GetBoundingRadius();
+
+				if (pos.SqDistance(colvol->GetWorldSpacePos(u)) >= (totRad * totRad))
+					continue;
+
+				qfbq.units.push_back(u);
+			}
+
+			for (CFeature* f: quad.features) {
+				if (!tb.featureStamps.Mark(f->id))
+					continue;
+
+				const auto* colvol = &f->collisionVolume;
+				const float totRad = radius + colvol->GetBoundingRadius();
+
+				if (pos.SqDistance(colvol->GetWorldSpacePos(f)) >= (totRad * totRad))
+					continue;
+
+				qfbq.features.push_back(f);
+			}
+
+			for (CPlasmaRepulser* r: quad.repulsers) {
+				// repulsers have no id, but there are only ever a handful per query
+				const auto beg = qfbq.repulsers.begin() + qfbq.repulserOffsets.back();
+
+				if (std::find(beg, qfbq.repulsers.end(), r) != qfbq.repulsers.end())
+					continue;
+
+				const auto* colvol = &r->collisionVolume;
+				const float totRad = radius + colvol->GetBoundingRadius();
+
+				if (pos.SqDistance(r->weaponMuzzlePos) >= (totRad * totRad))
+					continue;
+
+				qfbq.repulsers.push_back(r);
+			}
+		}
+
+		qfbq.unitOffsets.push_back(qfbq.units.size());
+		qfbq.featureOffsets.push_back(qfbq.features.size());
+		qfbq.repulserOffsets.push_back(qfbq.repulsers.size());
+	}
+}
 #endif // UNIT_TEST
@@ -3,12 +3,14 @@
 #ifndef QUAD_FIELD_H
 #define QUAD_FIELD_H
 
+#include <algorithm>
 #include <array>
+#include <limits>
 #include <vector>
 #include "System/Misc/NonCopyable.h"
 
 #include "System/creg/creg_cond.h"
-#include "System/float3.h"
+#include "System/float4.h"
 #include "System/type2.h"
 
 class CUnit;
@@ -17,6 +19,38 @@ class CProjectile;
 class CSolidObject;
 class CPlasmaRepulser;
 struct QuadFieldQuery;
+struct QuadFieldBatchQuery;
+struct QuadFieldColVolBatchQuery;
+
+/**
+ * Per-object dedup marks for the *Batch queries, indexed by object id; a
+ * replacement for the objects' tempNum that can be kept per thread.
+ */
+struct QuadFieldStamps {
+	// starts a new query, ids marked by earlier queries count as unmarked
+	void Next() {
+		// restart the sequence on wrap-around, a stale stamp could match again
+		if ((stamp += 1) == std::numeric_limits<int>::max()) {
+			std::fill(stamps.begin(), stamps.end(), 0);
+			stamp = 1;
+		}
+	}
+
+	// returns false if <id> was already marked during the current query
+	bool Mark(int id) {
+		if (static_cast<size_t>(id) >= stamps.size())
+			stamps.resize(id + 1, 0);
+
+		if (stamps[id] == stamp)
+			return false;
+
+		stamps[id] = stamp;
+		return true;
+	}
+
+	std::vector<int> stamps;
+	int stamp = 0;
+};
 
 template<typename T>
 class ExclusiveVectors {
@@ -80,6 +114,14 @@ needed to support dynamic resizing (not used yet)
 	CQuadField(int2 mapDims, int quad_size);
 	~CQuadField();
 
+	/**
+	 * Thread-safety: the GetQuads* functions and the *Batch queries only
+	 * use per-thread scratch buffers and can be called from ThreadPool
+	 * workers while the field is not being modified. All other Get*Exact,
+	 * GetUnits, NoSolidsExact and GetUnitsAndFeaturesColVol deduplicate
+	 * through gs->GetTempNum() and the objects' tempNum members and must
+	 * only be called from the sim thread.
+	 */
 	void GetQuads(QuadFieldQuery& qfq, float3 pos, float radius);
 	void GetQuadsRectangle(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
 	void GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const float3& dir, float length);
@@ -91,6 +133,17 @@ needed to support dynamic resizing (not used yet)
 		std::vector<CFeature*>& features,
 		std::vector<CPlasmaRepulser*>* repulsers = nullptr
 	);
+	/**
+	 * Batched variant of GetUnitsAndFeaturesColVol; candidates of each
+	 * (pos, radius) sphere are returned in the same order as the single
+	 * query would produce them. Uses per-thread dedup stamps instead of
+	 * tempNum, see GetUnitsExactBatch.
+	 */
+	void GetUnitsAndFeaturesColVolBatch(
+		QuadFieldColVolBatchQuery& qfbq,
+		const float4* spheres,
+		const size_t numSpheres
+	);
 
 	/**
 	 * Returns all units within @c radius of @c pos,
@@ -123,6 +176,58 @@ needed to support dynamic resizing (not used yet)
 	void GetProjectilesExact(QuadFieldQuery& qfq, const float3& pos, float radius);
 	void GetProjectilesExact(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
 
+	/**
+	 * Batched variant of GetUnitsExact; queries <numSpheres> (pos, radius)
+	 * spheres in one call and stores the results back-to-back in qfbq.
+	 * Does not touch CUnit::tempNum (uses per-thread dedup stamps) and
+	 * is therefore safe to call concurrently from ThreadPool workers as
+	 * long as no objects are added, moved or removed in the meantime.
+	 */
+	void GetUnitsExactBatch(
+		QuadFieldBatchQuery& qfbq,
+		const float4* spheres,
+		const size_t numSpheres,
+		bool spherical = true
+	);
+
+	/**
+	 * Appends the objects registered in <quads> that are within <radius>
+	 * of <pos> (taking their own radius into account) to <objects>, in
+	 * the same order as GetUnitsExact and without duplicates; the step
+	 * GetUnitsExactBatch performs for each sphere.
+	 * @param quadObjects maps a quad index to the objects in that quad
+	 */
+	template<typename T, typename QuadObjectsFunc>
+	static void GetObjectsExact(
+		std::vector<T*>& objects,
+		QuadFieldStamps& stamps,
+		const std::vector<int>& quads,
+		const QuadObjectsFunc& quadObjects,
+		const float3& pos,
+		const float radius,
+		const bool spherical
+	) {
+		stamps.Next();
+
+		for (const int qi: quads) {
+			for (T* o: quadObjects(qi)) {
+				if (!stamps.Mark(o->id))
+					continue;
+
+				const float totRad      = radius + o->radius;
+				const float totRadSq    = totRad * totRad;
+				const float posObjDstSq = spherical?
+					pos.SqDistance(o->pos):
+					pos.SqDistance2D(o->pos);
+
+				if (posObjDstSq >= totRadSq)
+					continue;
+
+				objects.push_back(o);
+			}
+		}
+	}
+
 	void GetSolidsExact(
 		QuadFieldQuery& qfq,
 		const float3& pos,
@@ -151,11 +256,12 @@ needed to support dynamic resizing (not used yet)
 	void MovedRepulser(CPlasmaRepulser* repulser);
 	void RemoveRepulser(CPlasmaRepulser* repulser);
 
-	void ReleaseVector(std::vector<CUnit*>* v       ) { tempUnits.ReleaseVector(v); }
-	void ReleaseVector(std::vector<CFeature*>* v    ) { tempFeatures.ReleaseVector(v); }
-	void ReleaseVector(std::vector<CProjectile*>* v ) { tempProjectiles.ReleaseVector(v); }
-	void ReleaseVector(std::vector<CSolidObject*>* v) { tempSolids.ReleaseVector(v); }
-	void ReleaseVector(std::vector<int>* v          ) { tempQuads.ReleaseVector(v); }
+	// must be called from the same thread that obtained the vector
+	void ReleaseVector(std::vector<CUnit*>* v       ) { GetThreadBuffers().tempUnits.ReleaseVector(v); }
+	void ReleaseVector(std::vector<CFeature*>* v    ) { GetThreadBuffers().tempFeatures.ReleaseVector(v); }
+	void ReleaseVector(std::vector<CProjectile*>* v ) { GetThreadBuffers().tempProjectiles.ReleaseVector(v); }
+	void ReleaseVector(std::vector<CSolidObject*>* v) { GetThreadBuffers().tempSolids.ReleaseVector(v); }
+	void ReleaseVector(std::vector<int>* v          ) { GetThreadBuffers().tempQuads.ReleaseVector(v); }
 
 	struct Quad {
 		CR_DECLARE_STRUCT(Quad)
@@ -179,6 +285,10 @@ needed to support dynamic resizing (not used yet)
 	}
 
 
+	// bumped whenever the set of units or features registered in any
+	// quad changes (units changing quads, additions and removals)
+	unsigned int GetUpdateCount() const { return updateCount; }
+
 	int GetNumQuadsX() const { return numQuadsX; }
 	int GetNumQuadsZ() const { return numQuadsZ; }
 
@@ -199,21 +309,36 @@ private:
 	int2 WorldPosToQuadField(const float3 p) const;
 	int WorldPosToQuadFieldIdx(const float3 p) const;
 
+	struct ThreadBuffers {
+		// preallocated vectors for Get*Exact functions
+		ExclusiveVectors<CUnit*> tempUnits;
+		ExclusiveVectors<CFeature*> tempFeatures;
+		ExclusiveVectors<CProjectile*> tempProjectiles;
+		ExclusiveVectors<CSolidObject*> tempSolids;
+		ExclusiveVectors<int> tempQuads;
+
+		// per-object dedup stamps for the *Batch functions
+		QuadFieldStamps unitStamps;
+		QuadFieldStamps featureStamps;
+	};
+
+	ThreadBuffers& GetThreadBuffers();
+
 private:
 	std::vector<Quad> baseQuads;
 
-	// preallocated vectors for Get*Exact functions
-	ExclusiveVectors<CUnit*> tempUnits;
-	ExclusiveVectors<CFeature*> tempFeatures;
-	ExclusiveVectors<CProjectile*> tempProjectiles;
-	ExclusiveVectors<CSolidObject*> tempSolids;
-	ExclusiveVectors<int> tempQuads;
+	// one set per ThreadPool thread (sync and async workers separately, as
+	// they share thread numbers), so GetQuads* and the *Batch queries can
+	// be made from workers (the tempNum-based queries can not)
+	std::vector<ThreadBuffers> threadBuffers;
 
 	int numQuadsX;
 	int numQuadsZ;
 
 	int quadSizeX;
 	int quadSizeZ;
+
+	unsigned int updateCount;
 };
 
 extern CQuadField* quadField;
@@ -233,4 +358,57 @@ struct QuadFieldQuery {
 	std::vector<int>* quads = nullptr;
 };
 
+struct QuadFieldBatchQuery {
+	void Clear() {
+		units.clear();
+		offsets.clear();
+		offsets.push_back(0);
+	}
+
+	size_t NumQueries() const { return (offsets.empty()? 0: offsets.size() - 1); }
+	size_t NumResults(size_t i) const { return (offsets[i + 1] - offsets[i]); }
+
+	CUnit* const* GetResults(size_t i) const { return (units.data() + offsets[i]); }
+
+	// results of the i-th query are units[offsets[i], offsets[i + 1])
+	// both vectors keep their capacity, so reusing a query avoids any
+	// allocations once it has been warmed up
+	std::vector<CUnit*> units;
+	std::vector<unsigned int> offsets;
+};
+
+struct QuadFieldColVolBatchQuery {
+	void Clear() {
+		units.clear();
+		features.clear();
+		repulsers.clear();
+
+		unitOffsets.clear();
+		featureOffsets.clear();
+		repulserOffsets.clear();
+
+		unitOffsets.push_back(0);
+		featureOffsets.push_back(0);
+		repulserOffsets.push_back(0);
+	}
+
+	size_t NumQueries() const { return (unitOffsets.empty()? 0: unitOffsets.size() - 1); }
+
+	size_t NumUnits(size_t i) const { return (unitOffsets[i + 1] - unitOffsets[i]); }
+	size_t NumFeatures(size_t i) const { return (featureOffsets[i + 1] - featureOffsets[i]); }
+	size_t NumRepulsers(size_t i) const { return (repulserOffsets[i + 1] - repulserOffsets[i]); }
+
+	CUnit* const* GetUnits(size_t i) const { return (units.data() + unitOffsets[i]); }
+	CFeature* const* GetFeatures(size_t i) const { return (features.data() + featureOffsets[i]); }
+	CPlasmaRepulser* const* GetRepulsers(size_t i) const { return (repulsers.data() + repulserOffsets[i]); }
+
+	std::vector<CUnit*> units;
+	std::vector<CFeature*> features;
+	std::vector<CPlasmaRepulser*> repulsers;
+
+	std::vector<unsigned int> unitOffsets;
+	std::vector<unsigned int> featureOffsets;
+	std::vector<unsigned int> repulserOffsets;
+};
+
 #endif /* QUAD_FIELD_H */
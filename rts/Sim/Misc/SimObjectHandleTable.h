@@ -0,0 +1,83 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SIMOBJECT_HANDLETABLE_H
+#define SIMOBJECT_HANDLETABLE_H
+
+#include <cassert>
+#include <vector>
+
+#include "System/creg/creg_cond.h"
+
+// weak reference to a table slot; becomes stale once the
+// object it was taken from is erased, even if the slot's
+// ID is reused by a new object afterwards
+struct SimObjectHandle {
+	bool operator == (const SimObjectHandle& h) const { return (id == h.id && gen == h.gen); }
+	bool operator != (const SimObjectHandle& h) const { return (!((*this) == h)); }
+
+	int id = -1;
+	unsigned int gen = 0;
+};
+
+
+// ID ==> object* map with a generation counter per slot; the
+// ID-allocation policy (pools, free-lists) is left to owners
+template<typename T> class SimObjectHandleTable {
+	CR_DECLARE_STRUCT(SimObjectHandleTable)
+
+public:
+	void Resize(unsigned int size) {
+		objects.resize(size, nullptr);
+		generations.resize(size, 0);
+	}
+	void Clear() {
+		objects.clear();
+		generations.clear();
+	}
+
+	bool IsFree(unsigned int id) const { return (id < objects.size() && objects[id] == nullptr); }
+	bool IsValid(const SimObjectHandle& h) const { return (Get(h) != nullptr); }
+
+	unsigned int Size() const { return (objects.size()); }
+
+	// note: negative ID's are implicitly converted
+	T* GetUnsafe(unsigned int id) const { return objects[id]; }
+	T* Get(unsigned int id) const { return ((id < objects.size())? objects[id]: nullptr); }
+	T* Get(const SimObjectHandle& h) const {
+		if (static_cast<unsigned int>(h.id) >= objects.size())
+			return nullptr;
+		if (generations[h.id] != h.gen)
+			return nullptr;
+
+		return objects[h.id];
+	}
+
+	SimObjectHandle GetHandle(unsigned int id) const {
+		SimObjectHandle h;
+
+		if (id < objects.size()) {
+			h.id = id;
+			h.gen = generations[id];
+		}
+
+		return h;
+	}
+
+	void Insert(unsigned int id, T* object) {
+		assert(id < objects.size());
+		assert(objects[id] == nullptr);
+		objects[id] = object;
+	}
+	void Erase(unsigned int id) {
+		assert(id < objects.size());
+		// invalidate all outstanding handles to this slot
+		objects[id] = nullptr;
+		generations[id] += 1;
+	}
+
+private:
+	std::vector<T*> objects;
+	std::vector<unsigned int> generations;
+};
+
+#endif
@@ -5,36 +5,43 @@
 
 #include <cassert>
 #include <cstring> // memset
+#include <algorithm>
 #include <array>
-#include <deque>
+#include <functional>
+#include <memory>
 #include <vector>
 
-#include "System/UnorderedMap.hpp"
 #include "System/ContainerUtil.h"
 #include "System/SafeUtil.h"
 
+// growable version; pages are carved out of contiguous slabs and every
+// page is preceded by an intrusive header, so freeing needs no lookups
 template<size_t S> struct DynMemPool {
 public:
+	struct alignas(16) PageHeader {
+		size_t index; // global page index, constant over the page's lifetime
+		size_t bytes; // size of the object living in this page, 0 if free
+	};
 
 	void* allocMem(size_t size) {
 		assert(size <= page_size());
-		uint8_t* m = nullptr;
+		assert(size != 0);
 
 		size_t i = 0;
 
 		if (indcs.empty()) {
-			pages.emplace_back();
-
-			i = pages.size() - 1;
+			if ((i = num_pages++) == (slabs.size() * slab_pages()))
+				add_slab();
 		} else {
 			// must pop before ctor runs; objects can be created recursively
 			i = spring::VectorBackPop(indcs);
 		}
 
-		m = pages[curr_page_index = i].data();
+		PageHeader* h = page_header(curr_page_index = i);
 
-		table.emplace(m, i);
-		return m;
+		h->index = i;
+		h->bytes = size;
+		return (h + 1);
 	}
 
 
@@ -50,13 +57,13 @@ public:
 	void freeMem(void* m) {
 		assert(mapped(m));
 
-		const auto iter = table.find(m);
-		const auto pair = std::pair<void*, size_t>{iter->first, iter->second};
+		PageHeader* h = reinterpret_cast<PageHeader*>(m) - 1;
 
-		std::memset(pages[pair.second].data(), 0, page_size());
+		// only clear what the object actually touched, not the whole page
+		std::memset(m, 0, h->bytes);
 
-		indcs.push_back(pair.second);
-		table.erase(pair.first);
+		h->bytes = 0;
+		indcs.push_back(h->index);
 	}
 
 
@@ -73,32 +80,70 @@ public:
 	}
 
 	static constexpr size_t page_size() { return S; }
+	static constexpr size_t page_stride() { return (sizeof(PageHeader) + ((S + alignof(PageHeader) - 1) & ~(alignof(PageHeader) - 1))); }
+	static constexpr size_t slab_pages() { return ((page_stride() < (SLAB_SIZE >> 1))? (SLAB_SIZE / page_stride()): 2); }
+	static constexpr size_t slab_size() { return (slab_pages() * page_stride()); }
 
-	size_t alloc_size() const { return (pages.size() * page_size()); } // size of total number of pages added over the pool's lifetime
+	size_t alloc_size() const { return (num_pages * page_size()); } // size of total number of pages added over the pool's lifetime
 	size_t freed_size() const { return (indcs.size() * page_size()); } // size of number of pages that were freed and are awaiting reuse
 
-	bool mapped(void* p) const { return (table.find(p) != table.end()); }
-	bool alloced(void* p) const { return ((curr_page_index < pages.size()) && (&pages[curr_page_index][0] == p)); }
+	bool mapped(const void* p) const {
+		const uint8_t* m = reinterpret_cast<const uint8_t*>(p);
+
+		// binary search for the last slab starting at or before m
+		const auto iter = std::upper_bound(slab_addrs.begin(), slab_addrs.end(), m, std::less<const uint8_t*>());
+
+		if (iter == slab_addrs.begin())
+			return false;
+
+		const uint8_t* slab = *(iter - 1);
+
+		if (m >= (slab + slab_size()))
+			return false;
+		if (((m - slab) % page_stride()) != sizeof(PageHeader))
+			return false;
+
+		return ((reinterpret_cast<const PageHeader*>(m) - 1)->bytes != 0);
+	}
+	bool alloced(const void* p) const { return ((curr_page_index < num_pages) && ((page_header(curr_page_index) + 1) == p)); }
 
 	void clear() {
-		pages.clear();
+		slabs.clear();
+		slab_addrs.clear();
 		indcs.clear();
-		table.clear();
 
+		num_pages = 0;
 		curr_page_index = 0;
 	}
 	void reserve(size_t n) {
+		slabs.reserve((n + slab_pages() - 1) / slab_pages());
+		slab_addrs.reserve(slabs.capacity());
 		indcs.reserve(n);
-		table.reserve(n);
 	}
 
 private:
-	std::deque<std::array<uint8_t,S>> pages;
-	std::vector<size_t> indcs;
+	void add_slab() {
+		// slabs are value-initialized, fresh pages are always zeroed
+		slabs.emplace_back(new uint8_t[slab_size()]());
 
-	// <pointer, page index> (non-intrusive)
-	spring::unsynced_map<void*, size_t> table;
+		const uint8_t* addr = slabs.back().get();
+
+		slab_addrs.insert(std::upper_bound(slab_addrs.begin(), slab_addrs.end(), addr, std::less<const uint8_t*>()), addr);
+	}
+
+	PageHeader* page_header(size_t i) const {
+		return (reinterpret_cast<PageHeader*>(slabs[i / slab_pages()].get() + (i % slab_pages()) * page_stride()));
+	}
+
+private:
+	static constexpr size_t SLAB_SIZE = 256 * 1024;
+
+	std::vector< std::unique_ptr<uint8_t[]> > slabs;
+	// start addresses of <slabs> in ascending order, for mapped()
+	std::vector<const uint8_t*> slab_addrs;
+	std::vector<size_t> indcs;
 
+	size_t num_pages = 0;
 	size_t curr_page_index = 0;
 };
 
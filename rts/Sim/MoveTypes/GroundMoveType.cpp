@@ -36,6 +36,8 @@
 #include "System/Sync/HsiehHash.h"
 #include "System/Sync/SyncTracer.h"
 
+#include <cstring>
+
 #if 1
 #include "Rendering/IPathDrawer.h"
 #define DEBUG_DRAWING_ENABLED ((gs->cheatEnabled || gu->spectatingFullView) && pathDrawer->IsEnabled())
@@ -82,6 +84,7 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_GMT)
 CR_BIND_DERIVED(CGroundMoveType, AMoveType, (nullptr))
 CR_REG_METADATA(CGroundMoveType, (
 	CR_IGNORED(pathController),
+	CR_IGNORED(moveIntent),
 
 	CR_MEMBER(currWayPoint),
 	CR_MEMBER(nextWayPoint),
@@ -307,6 +310,61 @@ bool CGroundMoveType::OwnerMoved(const short oldHeading, const float3& posDif, c
 	return true;
 }
 
+void CGroundMoveType::UpdateMoveIntent()
+{
+	// NOTE: runs on worker threads, only reads shared state
+	if (owner->GetTransporter() != nullptr)
+		return;
+
+	const MoveDef* md = owner->moveDef;
+	const float3& pos = owner->pos;
+
+	moveIntent.pos = pos;
+	moveIntent.dir = flatFrontDir;
+	moveIntent.moveDef = md;
+	moveIntent.unitDef = owner->unitDef;
+	moveIntent.pathType = md->pathType;
+	moveIntent.physicalState = owner->physicalState;
+	moveIntent.mapUpdateCount = readMap->GetSyncedUpdateCount();
+	moveIntent.onSlope = OnSlope(1.0f);
+
+	// same two lookups as ChangeSpeed performs for a unit that does not turn this frame
+	moveIntent.speedMods[0] = CMoveMath::GetPosSpeedMod(*md, pos                            , flatFrontDir);
+	moveIntent.speedMods[1] = CMoveMath::GetPosSpeedMod(*md, pos + flatFrontDir * SQUARE_SIZE, flatFrontDir);
+}
+
+bool CGroundMoveType::HasMoveIntent(const float3& moveDir) const
+{
+	// bitwise comparisons; float3::operator== has a tolerance
+	if (moveIntent.mapUpdateCount != readMap->GetSyncedUpdateCount())
+		return false;
+	if (moveIntent.physicalState != owner->physicalState)
+		return false;
+	if (moveIntent.moveDef != owner->moveDef || moveIntent.pathType != owner->moveDef->pathType)
+		return false;
+	if (moveIntent.unitDef != owner->unitDef)
+		return false;
+
+	return ((std::memcmp(&moveIntent.pos, &owner->pos, sizeof(float3)) == 0) && (std::memcmp(&moveIntent.dir, &moveDir, sizeof(float3)) == 0));
+}
+
+bool CGroundMoveType::IntentOnSlope()
+{
+	if (HasMoveIntent(flatFrontDir))
+		return moveIntent.onSlope;
+
+	return (OnSlope(1.0f));
+}
+
+float CGroundMoveType::IntentSpeedMod(const MoveDef& md, const float3& pos, const float3& moveDir, unsigned int i)
+{
+	if (HasMoveIntent(moveDir))
+		return moveIntent.speedMods[i];
+
+	return (CMoveMath::GetPosSpeedMod(md, pos, moveDir));
+}
+
+
 bool CGroundMoveType::Update()
 {
 	ASSERT_SYNCED(owner->pos);
@@ -315,7 +373,7 @@ bool CGroundMoveType::Update()
 	if (owner->GetTransporter() != nullptr)
 		return false;
 
-	owner->UpdatePhysicalStateBit(CSolidObject::PSTATE_BIT_SKIDDING, owner->IsSkidding() || OnSlope(1.0f));
+	owner->UpdatePhysicalStateBit(CSolidObject::PSTATE_BIT_SKIDDING, owner->IsSkidding() || IntentOnSlope());
 
 	if (owner->IsSkidding()) {
 		UpdateSkid();
@@ -604,13 +662,13 @@ void CGroundMoveType::ChangeSpeed(float newWantedSpeed, bool wantReverse, bool f
 			// the pathfinders do NOT check the entire footprint to determine
 			// passability wrt. terrain (only wrt. structures), so we look at
 			// the center square ONLY for our current speedmod
-			float groundSpeedMod = CMoveMath::GetPosSpeedMod(*md, owner->pos, flatFrontDir);
+			float groundSpeedMod = IntentSpeedMod(*md, owner->pos, flatFrontDir, 0);
 
 			// the pathfinders don't check the speedmod of the square our unit is currently on
 			// so if we got stuck on a nonpassable square and can't move try to see if we're
 			// trying to release ourselves towards a passable square
 			if (groundSpeedMod == 0.0f)
-				groundSpeedMod = CMoveMath::GetPosSpeedMod(*md, owner->pos + flatFrontDir * SQUARE_SIZE, flatFrontDir);
+				groundSpeedMod = IntentSpeedMod(*md, owner->pos + flatFrontDir * SQUARE_SIZE, flatFrontDir, 1);
 
 			const float curGoalDistSq = (owner->pos - goalPos).SqLength2D();
 			const float minGoalDistSq = Square(BrakingDistance(currentSpeed, decRate));
@@ -29,6 +29,7 @@ public:
 
 	void PostLoad();
 
+	void UpdateMoveIntent() override;
 	bool Update() override;
 	void SlowUpdate() override;
 
@@ -148,7 +149,33 @@ private:
 	bool FollowPath();
 	bool WantReverse(const float3& wpDir, const float3& ffDir) const;
 
+	bool HasMoveIntent(const float3& moveDir) const;
+	bool IntentOnSlope();
+	float IntentSpeedMod(const MoveDef& md, const float3& pos, const float3& moveDir, unsigned int i);
+
 private:
+	/// terrain lookups precomputed by UpdateMoveIntent, only
+	/// used if owner state still matches the key they were
+	/// computed for (otherwise recalculated in Update)
+	struct MoveIntent {
+		float3 pos;
+		float3 dir;
+
+		// OnSlope and GetPosSpeedMod also depend on these, Lua can
+		// change the MoveDef (SetUnitMoveDef) between both phases
+		const MoveDef* moveDef = nullptr;
+		const UnitDef* unitDef = nullptr;
+
+		unsigned int pathType = -1u;
+		unsigned int physicalState = 0;
+		unsigned int mapUpdateCount = -1u;
+
+		float speedMods[2] = {0.0f, 0.0f};
+		bool onSlope = false;
+	};
+
+	MoveIntent moveIntent;
+
 	GMTDefaultPathController pathController;
 
 	SyncedFloat3 currWayPoint;
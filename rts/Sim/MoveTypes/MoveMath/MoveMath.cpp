@@ -12,6 +12,11 @@
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/CommandAI/CommandAI.h"
 #include "System/Platform/Threading.h"
+#include "System/Threading/ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
 
 bool CMoveMath::noHoverWaterMove = false;
 float CMoveMath::waterDamageCost = 0.0f;
@@ -19,6 +24,10 @@ float CMoveMath::waterDamageCost = 0.0f;
 static constexpr int FOOTPRINT_XSTEP = 2;
 static constexpr int FOOTPRINT_ZSTEP = 2;
 
+// objects already visited by RangeIsBlocked, one list per ThreadPool worker
+// (workers can not share the global tempNum stamps with the main thread)
+static std::array<std::vector<const CSolidObject*>, ThreadPool::MAX_THREADS> workerCollidees;
+
 
 float CMoveMath::yLevel(const MoveDef& moveDef, int xSqr, int zSqr)
 {
@@ -273,6 +282,35 @@ CMoveMath::BlockType CMoveMath::RangeIsBlocked(const MoveDef& moveDef, int xmin,
 
 	BlockType ret = BLOCK_NONE;
 
+	// calls from the PE update workers; duplicates are filtered via a local
+	// list so neither gs->tempNum nor CSolidObject::tempNum gets modified
+	if (ThreadPool::GetThreadNum() != 0) {
+		std::vector<const CSolidObject*>& visited = workerCollidees[ThreadPool::GetThreadNum()];
+
+		visited.clear();
+
+		for (int z = zmin; z <= zmax; z += FOOTPRINT_ZSTEP) {
+			const int zOffset = z * mapDims.mapx;
+
+			for (int x = xmin; x <= xmax; x += FOOTPRINT_XSTEP) {
+				const BlockingMapCell& cell = groundBlockingObjectMap->GetCellUnsafeConst(zOffset + x);
+
+				for (const CSolidObject* collidee: cell) {
+					if (std::find(visited.begin(), visited.end(), collidee) != visited.end())
+						continue;
+
+					visited.push_back(collidee);
+					ret |= ObjectBlockType(moveDef, collidee, collider);
+
+					if (ret & BLOCK_STRUCTURE)
+						return ret;
+				}
+			}
+		}
+
+		return ret;
+	}
+
 	const int tempNum = gs->GetTempNum();
 
 	// (footprints are point-symmetric around <xSquare, zSquare>)
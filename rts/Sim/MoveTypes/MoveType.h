@@ -46,6 +46,11 @@ public:
 	virtual void SetManeuverLeash(float leashLength) { maneuverLeash = leashLength; }
 	virtual void SetWaterline(float depth) { waterline = depth; }
 
+	// read-only half of Update, may be called concurrently for different
+	// owners (see CUnitHandler::Update) so it must not touch synced state
+	// outside of this instance; whatever it caches has to be revalidated
+	// by Update to keep the simulation independent of the thread count
+	virtual void UpdateMoveIntent() {}
 	virtual bool Update() = 0;
 	virtual void SlowUpdate();
 
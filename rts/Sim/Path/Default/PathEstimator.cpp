@@ -2,9 +2,8 @@
 
 #include "System/Platform/Win/win32.h"
 
-#include "minizip/zip.h"
-
 #include "PathEstimator.h"
+#include "PathEstimatorCache.h"
 #include "PathFinder.h"
 #include "PathFinderDef.h"
 // #include "PathFlowMap.hpp"
@@ -20,11 +19,10 @@
 #include "System/Threading/ThreadPool.h" // for_mt
 #include "System/TimeProfiler.h"
 #include "System/Config/ConfigHandler.h"
-#include "System/FileSystem/Archives/IArchive.h"
-#include "System/FileSystem/ArchiveLoader.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/MemoryMappedFile.h"
 #include "System/Platform/Threading.h"
 #include "System/SafeUtil.h"
 #include "System/StringUtil.h"
@@ -63,6 +61,7 @@ CPathEstimator::CPathEstimator(IPathFinder* pf, unsigned int BLOCK_SIZE, const s
 	, costBlockNum(nbrOfBlocks.x * nbrOfBlocks.y)
 	, parentPathFinder(pf)
 	, nextPathEstimator(nullptr)
+	, numUpdateHelpers(0)
 	, blockUpdatePenalty(0)
 {
 	vertexCosts.resize(moveDefHandler->GetNumMoveDefs() * blockStates.GetSize() * PATH_DIRECTION_VERTICES, PATHCOST_INFINITY);
@@ -119,6 +118,10 @@ CPathEstimator::CPathEstimator(IPathFinder* pf, unsigned int BLOCK_SIZE, const s
 
 CPathEstimator::~CPathEstimator()
 {
+	for (unsigned int i = 1; i <= numUpdateHelpers; i++) {
+		pfMemPool.free(pathFinders[i]);
+	}
+
 	pcMemPool.free(pathCache[0]);
 	pcMemPool.free(pathCache[1]);
 }
@@ -194,6 +197,22 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 	pfMemPool.free(pathFinders[0]);
 	pathFinders[0] = parentPathFinder;
 
+	// keep private PF instances around for Update() if the parent is a PF; a
+	// PE parent (low-res case) shares its node-state buffer and cache, which
+	// can not be used concurrently so those updates stay on the main thread
+	if (dynamic_cast<CPathEstimator*>(parentPathFinder) == nullptr) {
+		const unsigned int minMemFootPrint = sizeof(CPathFinder) + parentPathFinder->GetMemFootPrint();
+		const unsigned int maxMemFootPrint = configHandler->GetInt("MaxPathCostsMemoryFootPrint") * 1024 * 1024;
+		const unsigned int maxNumHelpers = std::min(numThreads - 1, unsigned(ThreadPool::GetNumThreads()));
+
+		numUpdateHelpers = Clamp(int(maxMemFootPrint / minMemFootPrint) - 1, 0, int(maxNumHelpers));
+		numUpdateHelpers *= (numUpdateHelpers > 1);
+
+		for (unsigned int i = 1; i <= numUpdateHelpers; i++) {
+			pathFinders[i] = pfMemPool.alloc<CPathFinder>();
+		}
+	}
+
 	pathCache[0] = pcMemPool.alloc<CPathCache>(nbrOfBlocks.x, nbrOfBlocks.y);
 	pathCache[1] = pcMemPool.alloc<CPathCache>(nbrOfBlocks.x, nbrOfBlocks.y);
 }
@@ -535,11 +554,27 @@ void CPathEstimator::Update()
 		});
 	}
 
-	// CalcVertexPathCosts (not threadsafe)
+	// CalcVertexPathCosts (threadsafe given a private PF per chunk; blocking
+	// tests on workers use CMoveMath's per-thread dedup instead of tempNum)
 	{
 		SCOPED_TIMER("Sim::Path::Estimator::CalcVertexPathCosts");
-		for (unsigned int n = 0; n < consumedBlocks.size(); ++n) {
-			CalcVertexPathCosts(*consumedBlocks[n].moveDef, consumedBlocks[n].blockPos);
+
+		if (numUpdateHelpers == 0) {
+			for (unsigned int n = 0; n < consumedBlocks.size(); ++n) {
+				CalcVertexPathCosts(*consumedBlocks[n].moveDef, consumedBlocks[n].blockPos);
+			}
+		} else {
+			// every (block, movedef) pair writes a disjoint set of vertexCosts
+			// and the map is not modified while we run, so the results do not
+			// depend on how chunks are scheduled; the number of blocks handled
+			// per frame stays independent of the thread count (for sync)
+			const unsigned int numChunks = std::min(size_t(numUpdateHelpers), consumedBlocks.size());
+
+			for_mt(0, numChunks, [&](const int chunk) {
+				for (unsigned int n = chunk; n < consumedBlocks.size(); n += numChunks) {
+					CalcVertexPathCosts(*consumedBlocks[n].moveDef, consumedBlocks[n].blockPos, chunk + 1);
+				}
+			});
 		}
 	}
 }
@@ -904,74 +939,62 @@ void CPathEstimator::FinishSearch(const MoveDef& moveDef, const CPathFinderDef&
 }
 
 
+static const std::string GetPathCacheFileName(const std::string& baseFileName, const std::string& mapName, std::uint32_t fileHashCode, const char* ext = ".pecache") {
+	return (GetPathCacheDir() + mapName + "." + baseFileName + "-" + IntToString(fileHashCode, "%x") + ext);
+}
+
+
+// atomically replaces <dstPath> (if it exists) by <srcPath>, so there is
+// never a moment without a valid cache file even if the process crashes
+static bool ReplacePathCacheFile(const std::string& srcPath, const std::string& dstPath) {
+	#ifdef _WIN32
+	// plain rename fails on win32 if the target exists
+	return (MoveFileExA(srcPath.c_str(), dstPath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0);
+	#else
+	return (std::rename(srcPath.c_str(), dstPath.c_str()) == 0);
+	#endif
+}
+
+
 /**
  * Try to read offset and vertices data from file, return false on failure
  */
 bool CPathEstimator::ReadFile(const std::string& baseFileName, const std::string& mapName)
 {
 	const std::string hashHexString = IntToString(fileHashCode, "%x");
-	const std::string cacheFileName = GetPathCacheDir() + mapName + "." + baseFileName + "-" + hashHexString + ".zip";
+	const std::string cacheFileName = GetPathCacheFileName(baseFileName, mapName, fileHashCode);
+	const std::string zipCacheFileName = GetPathCacheFileName(baseFileName, mapName, fileHashCode, ".zip");
 
 	LOG("[PathEstimator::%s] hash=%s file=\"%s\" (exists=%d)", __func__, hashHexString.c_str(), cacheFileName.c_str(), FileSystem::FileExists(cacheFileName));
 
-	if (!FileSystem::FileExists(cacheFileName))
-		return false;
-
-	std::unique_ptr<IArchive> upfile(archiveLoader.OpenArchive(dataDirsAccess.LocateFile(cacheFileName), "sdz"));
+	// caches written in the old (zipped) format are never read again
+	if (FileSystem::FileExists(zipCacheFileName))
+		FileSystem::Remove(zipCacheFileName);
 
-	if (upfile == nullptr || !upfile->IsOpen()) {
-		FileSystem::Remove(cacheFileName);
+	if (!FileSystem::FileExists(cacheFileName))
 		return false;
-	}
 
 	char calcMsg[512];
 	sprintf(calcMsg, "Reading Estimate PathCosts [%d]", BLOCK_SIZE);
 	loadscreen->SetLoadMessage(calcMsg);
 
-	const unsigned fid = upfile->FindFile("pathinfo");
-	if (fid >= upfile->NumFiles()) {
-		FileSystem::Remove(cacheFileName);
-		return false;
-	}
-
-	// pointless; gets reassigned the output of CalcChecksum and CRC is not otherwise used
-	// pathChecksum = upfile->GetCrc32(fid);
-
-	std::vector<std::uint8_t> buffer;
-
-	if (!upfile->GetFile(fid, buffer) || buffer.size() < 4) {
-		FileSystem::Remove(cacheFileName);
-		return false;
-	}
+	const CPathEstimatorCache cache(fileHashCode, BLOCK_SIZE, blockStates.GetSize(), moveDefHandler->GetNumMoveDefs(), PATH_DIRECTION_VERTICES);
 
-	const unsigned int filehash = *(reinterpret_cast<unsigned int*>(&buffer[0]));
-	const unsigned int blockSize = blockStates.GetSize() * sizeof(short2);
-	unsigned int pos = sizeof(unsigned);
+	bool valid = false;
 
-	if (filehash != fileHashCode) {
-		FileSystem::Remove(cacheFileName);
-		return false;
-	}
-
-	if (buffer.size() < (pos + blockSize * moveDefHandler->GetNumMoveDefs())) {
-		FileSystem::Remove(cacheFileName);
-		return false;
-	}
+	{
+		// the mapping has to be closed before the file can be removed (win32)
+		const CMemoryMappedFile file(dataDirsAccess.LocateFile(cacheFileName));
 
-	// read center-offset data
-	for (int pathType = 0; pathType < moveDefHandler->GetNumMoveDefs(); ++pathType) {
-		std::memcpy(&blockStates.peNodeOffsets[pathType][0], &buffer[pos], blockSize);
-		pos += blockSize;
+		valid = cache.Read(file.GetData(), file.GetSize(), blockStates.peNodeOffsets, vertexCosts);
 	}
 
-	// read vertex-cost data
-	if (buffer.size() < (pos + vertexCosts.size() * sizeof(float))) {
+	if (!valid) {
+		LOG_L(L_WARNING, "[PathEstimator::%s] discarding invalid file \"%s\"", __func__, cacheFileName.c_str());
 		FileSystem::Remove(cacheFileName);
-		return false;
 	}
 
-	std::memcpy(&vertexCosts[0], &buffer[pos], vertexCosts.size() * sizeof(float));
-	return true;
+	return valid;
 }
 
 
@@ -985,44 +1008,34 @@ void CPathEstimator::WriteFile(const std::string& baseFileName, const std::strin
 		return;
 
 	const std::string hashHexString = IntToString(fileHashCode, "%x");
-	const std::string cacheFileName = GetPathCacheDir() + mapName + "." + baseFileName + "-" + hashHexString + ".zip";
+	const std::string cacheFileName = GetPathCacheFileName(baseFileName, mapName, fileHashCode);
 
 	LOG("[PathEstimator::%s] hash=%s file=\"%s\" (exists=%d)", __func__, hashHexString.c_str(), cacheFileName.c_str(), FileSystem::FileExists(cacheFileName));
 
-	// open file for writing in a suitable location
-	zipFile file = zipOpen(dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE).c_str(), APPEND_STATUS_CREATE);
-
-	if (file == nullptr)
-		return;
-
-	zipOpenNewFileInZip(file, "pathinfo", nullptr, nullptr, 0, nullptr, 0, nullptr, Z_DEFLATED, Z_BEST_COMPRESSION);
-
-	// write hash-code (NOTE: this also affects the CRC!)
-	zipWriteInFileInZip(file, (const void*) &fileHashCode, 4);
+	const CPathEstimatorCache cache(fileHashCode, BLOCK_SIZE, blockStates.GetSize(), moveDefHandler->GetNumMoveDefs(), PATH_DIRECTION_VERTICES);
 
-	// write center-offsets
-	for (int pathType = 0; pathType < moveDefHandler->GetNumMoveDefs(); ++pathType) {
-		zipWriteInFileInZip(file, (const void*) &blockStates.peNodeOffsets[pathType][0], blockStates.peNodeOffsets[pathType].size() * sizeof(short2));
-	}
+	std::vector<std::uint8_t> buffer;
+	cache.Write(buffer, blockStates.peNodeOffsets, vertexCosts);
 
-	// write vertex-costs
-	zipWriteInFileInZip(file, vertexCosts.data(), vertexCosts.size() * sizeof(float));
+	// write to a temporary file first and rename it afterwards, so that
+	// concurrent processes on the same map never map a partial cache
+	const std::string filePath = dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE);
+	const std::string tempPath = filePath + IntToString(spring_gettime().toNanoSecsi() & 0x7FFFFFFF, ".%x.tmp");
 
-	zipCloseFileInZip(file);
-	zipClose(file, nullptr);
+	FILE* file = fopen(tempPath.c_str(), "wb");
 
+	if (file == nullptr)
+		return;
 
-	// get the CRC over the written path data
-	std::unique_ptr<IArchive> upfile(archiveLoader.OpenArchive(dataDirsAccess.LocateFile(cacheFileName), "sdz"));
+	const bool written = (fwrite(buffer.data(), buffer.size(), 1, file) == 1);
 
-	if (upfile == nullptr || !upfile->IsOpen()) {
-		FileSystem::Remove(cacheFileName);
+	if ((fclose(file) != 0) || !written) {
+		FileSystem::Remove(tempPath);
 		return;
 	}
 
-	assert(upfile->FindFile("pathinfo") < upfile->NumFiles());
-	// pointless; gets reassigned the output of CalcChecksum and CRC is not otherwise used
-	// pathChecksum = upfile->GetCrc32(upfile->FindFile("pathinfo"));
+	if (!ReplacePathCacheFile(tempPath, filePath))
+		FileSystem::Remove(tempPath);
 }
 
 
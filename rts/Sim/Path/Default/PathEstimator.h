@@ -137,7 +137,7 @@ private:
 	CPathEstimator* nextPathEstimator; // next lower-resolution estimator
 	CPathCache* pathCache[2]; // [0] = !synced, [1] = synced
 
-	std::vector<IPathFinder*> pathFinders; // InitEstimator helpers
+	std::vector<IPathFinder*> pathFinders; // InitEstimator and Update helpers
 	std::vector<spring::thread> threads;
 
 	std::vector<float> maxSpeedMods;
@@ -145,6 +145,8 @@ private:
 	/// blocks that may need an update due to map changes
 	std::deque<int2> updatedBlocks;
 
+	/// number of private CPathFinder's (pathFinders[1...]) used by Update
+	unsigned int numUpdateHelpers;
 	int blockUpdatePenalty;
 
 	struct SOffsetBlock {
@@ -0,0 +1,143 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "PathEstimatorCache.h"
+#include "System/Sync/HsiehHash.h"
+
+#include <cassert>
+#include <cstring>
+
+
+struct PathEstimatorCacheHeader {
+	char magic[8];
+
+	std::uint32_t version;
+	std::uint32_t byteOrder;
+	std::uint32_t fileHashCode;
+	std::uint32_t blockSize;
+	std::uint32_t numBlocks;
+	std::uint32_t numPathTypes;
+	std::uint32_t numVertices;
+	std::uint32_t offsetsSize;
+	std::uint32_t sectionSize;
+	std::uint32_t dataChecksum;
+
+	std::uint32_t padding[4];
+};
+
+static constexpr char PECACHE_MAGIC[8] = {'S', 'P', 'R', 'I', 'N', 'G', 'P', 'E'};
+static constexpr std::uint32_t PECACHE_BYTE_ORDER = 0x01020304;
+
+static_assert((sizeof(PathEstimatorCacheHeader) % CPathEstimatorCache::ALIGNMENT) == 0, "");
+
+static constexpr std::uint32_t AlignCacheSize(std::uint32_t n) {
+	return ((n + CPathEstimatorCache::ALIGNMENT - 1) & ~(CPathEstimatorCache::ALIGNMENT - 1));
+}
+
+
+CPathEstimatorCache::CPathEstimatorCache(
+	std::uint32_t _fileHashCode,
+	std::uint32_t _blockSize,
+	std::uint32_t _numBlocks,
+	std::uint32_t _numPathTypes,
+	std::uint32_t _numVertices
+)
+	: fileHashCode(_fileHashCode)
+	, blockSize(_blockSize)
+	, numBlocks(_numBlocks)
+	, numPathTypes(_numPathTypes)
+	, numVertices(_numVertices)
+{
+	offsetsSize = AlignCacheSize(numBlocks * sizeof(short2));
+	sectionSize = offsetsSize + AlignCacheSize(numBlocks * numVertices * sizeof(float));
+}
+
+size_t CPathEstimatorCache::GetSize() const
+{
+	return (sizeof(PathEstimatorCacheHeader) + size_t(sectionSize) * numPathTypes);
+}
+
+
+void CPathEstimatorCache::Write(
+	std::vector<std::uint8_t>& buffer,
+	const std::vector< std::vector<short2> >& nodeOffsets,
+	const std::vector<float>& vertexCosts
+) const {
+	assert(nodeOffsets.size() >= numPathTypes);
+	assert(vertexCosts.size() >= size_t(numPathTypes) * numBlocks * numVertices);
+
+	buffer.clear();
+	buffer.resize(GetSize(), 0);
+
+	std::uint8_t* sections = &buffer[sizeof(PathEstimatorCacheHeader)];
+
+	for (std::uint32_t pathType = 0; pathType < numPathTypes; ++pathType) {
+		std::uint8_t* section = sections + size_t(sectionSize) * pathType;
+
+		std::memcpy(section, &nodeOffsets[pathType][0], numBlocks * sizeof(short2));
+		std::memcpy(section + offsetsSize, &vertexCosts[pathType * numBlocks * numVertices], numBlocks * numVertices * sizeof(float));
+	}
+
+	PathEstimatorCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, PECACHE_MAGIC, sizeof(PECACHE_MAGIC));
+
+	header.version = VERSION;
+	header.byteOrder = PECACHE_BYTE_ORDER;
+	header.fileHashCode = fileHashCode;
+	header.blockSize = blockSize;
+	header.numBlocks = numBlocks;
+	header.numPathTypes = numPathTypes;
+	header.numVertices = numVertices;
+	header.offsetsSize = offsetsSize;
+	header.sectionSize = sectionSize;
+	header.dataChecksum = HsiehHash(sections, sectionSize * numPathTypes, 0);
+
+	std::memcpy(&buffer[0], &header, sizeof(header));
+}
+
+bool CPathEstimatorCache::Read(
+	const std::uint8_t* data,
+	size_t size,
+	std::vector< std::vector<short2> >& nodeOffsets,
+	std::vector<float>& vertexCosts
+) const {
+	if (data == nullptr || size != GetSize())
+		return false;
+
+	PathEstimatorCacheHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	bool valid = true;
+
+	valid &= (std::memcmp(header.magic, PECACHE_MAGIC, sizeof(PECACHE_MAGIC)) == 0);
+	valid &= (header.version == VERSION);
+	valid &= (header.byteOrder == PECACHE_BYTE_ORDER);
+	valid &= (header.fileHashCode == fileHashCode);
+	valid &= (header.blockSize == blockSize);
+	valid &= (header.numBlocks == numBlocks);
+	valid &= (header.numPathTypes == numPathTypes);
+	valid &= (header.numVertices == numVertices);
+	valid &= (header.offsetsSize == offsetsSize);
+	valid &= (header.sectionSize == sectionSize);
+
+	if (!valid)
+		return false;
+
+	const std::uint8_t* sections = data + sizeof(header);
+
+	if (HsiehHash(sections, sectionSize * numPathTypes, 0) != header.dataChecksum)
+		return false;
+
+	assert(nodeOffsets.size() >= numPathTypes);
+	assert(vertexCosts.size() >= size_t(numPathTypes) * numBlocks * numVertices);
+
+	for (std::uint32_t pathType = 0; pathType < numPathTypes; ++pathType) {
+		const std::uint8_t* section = sections + size_t(sectionSize) * pathType;
+
+		// read center-offset and vertex-cost data
+		std::memcpy(&nodeOffsets[pathType][0], section, numBlocks * sizeof(short2));
+		std::memcpy(&vertexCosts[pathType * numBlocks * numVertices], section + offsetsSize, numBlocks * numVertices * sizeof(float));
+	}
+
+	return true;
+}
@@ -0,0 +1,71 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef PATHESTIMATOR_CACHE_H
+#define PATHESTIMATOR_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "System/type2.h"
+
+/**
+ * Encodes and decodes the on-disk (.pecache) representation of a path
+ * estimator's precalculated data; a header followed by one section per
+ * MoveDef holding its block offsets and vertex costs (each aligned to
+ * ALIGNMENT) so a mapped file can be validated and read in place without
+ * any decompression. Values are stored in host order, files written by a
+ * host with different endianness are rejected.
+ */
+class CPathEstimatorCache
+{
+public:
+	CPathEstimatorCache(
+		std::uint32_t fileHashCode,
+		std::uint32_t blockSize,
+		std::uint32_t numBlocks,
+		std::uint32_t numPathTypes,
+		std::uint32_t numVertices
+	);
+
+	/// size of the encoded data, in bytes
+	size_t GetSize() const;
+
+	/**
+	 * @param nodeOffsets center-offsets, indexed by [pathType][block]
+	 * @param vertexCosts indexed by [(pathType * numBlocks + block) * numVertices + vertex]
+	 */
+	void Write(
+		std::vector<std::uint8_t>& buffer,
+		const std::vector< std::vector<short2> >& nodeOffsets,
+		const std::vector<float>& vertexCosts
+	) const;
+	/**
+	 * Copies the sections of <data> into nodeOffsets and vertexCosts (both
+	 * already sized as for Write), if its header matches the parameters this
+	 * instance was constructed with and its checksum is correct.
+	 * @return false if <data> was rejected, the outputs are then unchanged
+	 */
+	bool Read(
+		const std::uint8_t* data,
+		size_t size,
+		std::vector< std::vector<short2> >& nodeOffsets,
+		std::vector<float>& vertexCosts
+	) const;
+
+public:
+	static constexpr std::uint32_t VERSION = 1;
+	static constexpr std::uint32_t ALIGNMENT = 64;
+
+private:
+	std::uint32_t fileHashCode;
+	std::uint32_t blockSize;
+	std::uint32_t numBlocks;
+	std::uint32_t numPathTypes;
+	std::uint32_t numVertices;
+
+	std::uint32_t offsetsSize;
+	std::uint32_t sectionSize;
+};
+
+#endif
@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <algorithm>
+#include <cstring>
 
 #include "Projectile.h"
 #include "ProjectileHandler.h"
@@ -27,7 +28,9 @@
 #include "System/Config/ConfigHandler.h"
 #include "System/EventHandler.h"
 #include "System/Log/ILog.h"
+#include "System/myMath.h"
 #include "System/TimeProfiler.h"
+#include "System/Threading/ThreadPool.h"
 #include "System/creg/STL_Deque.h"
 
 
@@ -42,6 +45,12 @@ CONFIG(int, MaxParticles).defaultValue(10000).headlessValue(1).minimumValue(1);
 CONFIG(int, MaxNanoParticles).defaultValue(2000).headlessValue(1).minimumValue(1);
 
 
+CR_BIND_TEMPLATE(SimObjectHandleTable<CProjectile>, )
+CR_REG_METADATA_TEMPLATE(SimObjectHandleTable<CProjectile>, (
+	CR_MEMBER(objects),
+	CR_MEMBER(generations)
+))
+
 CR_BIND(CProjectileHandler, )
 CR_REG_METADATA(CProjectileHandler, (
 	CR_MEMBER(syncedProjectiles),
@@ -78,13 +87,12 @@ CProjectileHandler::CProjectileHandler()
 , lastSyncedProjectilesCount(0)
 , lastUnsyncedProjectilesCount(0)
 , resortFlyingPieces({false})
-, syncedProjectileIDs(1024, nullptr)
-#if UNSYNCED_PROJ_NOEVENT
-, unsyncedProjectileIDs(0, nullptr)
-#else
-, unsyncedProjectileIDs(8192, nullptr)
-#endif
 {
+	syncedProjectileIDs.Resize(1024);
+#if !UNSYNCED_PROJ_NOEVENT
+	unsyncedProjectileIDs.Resize(8192);
+#endif
+
 	maxParticles     = configHandler->GetInt("MaxParticles");
 	maxNanoParticles = configHandler->GetInt("MaxNanoParticles");
 
@@ -92,12 +100,12 @@ CProjectileHandler::CProjectileHandler()
 	projMemPool.reserve(1024);
 
 	// preload some IDs
-	for (int i = 0; i < syncedProjectileIDs.size(); i++) {
+	for (int i = 0; i < syncedProjectileIDs.Size(); i++) {
 		freeSyncedIDs.push_back(i);
 	}
 	std::random_shuffle(freeSyncedIDs.begin(), freeSyncedIDs.end(), gsRNG);
 
-	for (int i = 0; i < unsyncedProjectileIDs.size(); i++) {
+	for (int i = 0; i < unsyncedProjectileIDs.Size(); i++) {
 		freeUnsyncedIDs.push_back(i);
 	}
 	std::random_shuffle(freeUnsyncedIDs.begin(), freeUnsyncedIDs.end(), guRNG);
@@ -145,8 +153,8 @@ CProjectileHandler::~CProjectileHandler()
 	freeSyncedIDs.clear();
 	freeUnsyncedIDs.clear();
 
-	syncedProjectileIDs.clear();
-	unsyncedProjectileIDs.clear();
+	syncedProjectileIDs.Clear();
+	unsyncedProjectileIDs.Clear();
 
 	CCollisionHandler::PrintStats();
 }
@@ -204,7 +212,7 @@ void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool
 
 			if (synced) {
 				eventHandler.ProjectileDestroyed(p, p->GetAllyteamID());
-				syncedProjectileIDs[p->id] = nullptr;
+				syncedProjectileIDs.Erase(p->id);
 				freeSyncedIDs.push_back(p->id);
 
 				ASSERT_SYNCED(p->pos);
@@ -212,7 +220,7 @@ void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool
 			} else {
 			#if !UNSYNCED_PROJ_NOEVENT
 				eventHandler.ProjectileDestroyed(p, p->GetAllyteamID());
-				unsyncedProjectileIDs[p->id] = nullptr;
+				unsyncedProjectileIDs.Erase(p->id);
 				freeUnsyncedIDs.push_back(p->id);
 			#endif
 			}
@@ -366,7 +374,7 @@ void CProjectileHandler::AddProjectile(CProjectile* p)
 	}
 
 	if (freeIDs->empty()) {
-		const size_t oldSize = proIDs->size();
+		const size_t oldSize = proIDs->Size();
 		const size_t newSize = oldSize + 256;
 		for (int i = oldSize; i < newSize; i++) {
 			freeIDs->push_back(i);
@@ -376,12 +384,12 @@ void CProjectileHandler::AddProjectile(CProjectile* p)
 		} else{
 			std::random_shuffle(freeIDs->begin(), freeIDs->end(), guRNG);
 		}
-		proIDs->resize(newSize, nullptr);
+		proIDs->Resize(newSize);
 	}
 
 	p->id = freeIDs->front();
 	freeIDs->pop_front();
-	(*proIDs)[p->id] = p;
+	proIDs->Insert(p->id, p);
 
 	if ((p->id) > (1 << 24)) {
 		LOG_L(L_WARNING, "Lua %s projectile IDs are now out of range", (p->synced? "synced": "unsynced"));
@@ -550,26 +558,306 @@ void CProjectileHandler::CheckShieldCollisions(
 	}
 }
 
+// everything the narrowphase result for one broadphase candidate depends on,
+// compared bytewise to find out whether a result is still valid after one of
+// the serial collisions (which may run arbitrary Lua code) changed the world
+struct CollisionCandidateState {
+	void Set(const CSolidObject* o, bool test) {
+		tested = test;
+
+		if (!tested)
+			return;
+
+		transform = o->GetTransformMatrix(true);
+		relMidPos = o->relMidPos;
+		physicalState = o->physicalState;
+		pieceTree = o->collisionVolume.DefaultToPieceTree();
+
+		std::memcpy(colVol, &o->collisionVolume, sizeof(colVol));
+	}
+
+	// piece volumes and matrices are not part of the state, hits
+	// on the piece tree are therefore always tested again
+	bool Reusable(const CollisionCandidateState& s) const {
+		if (tested != s.tested)
+			return false;
+		if (!tested)
+			return true;
+		if (pieceTree || s.pieceTree)
+			return false;
+
+		bool same = true;
+
+		same &= (std::memcmp(&transform, &s.transform, sizeof(transform)) == 0);
+		same &= (std::memcmp(&relMidPos, &s.relMidPos, sizeof(relMidPos)) == 0);
+		same &= (physicalState == s.physicalState);
+		same &= (std::memcmp(colVol, s.colVol, sizeof(colVol)) == 0);
+		return same;
+	}
+
+	CMatrix44f transform;
+	float3 relMidPos;
+
+	unsigned int physicalState = 0;
+
+	bool tested = false;
+	bool pieceTree = false;
+
+	std::uint8_t colVol[sizeof(CollisionVolume)];
+};
+
+// broadphase results for QUERY_CHUNK_SIZE projectiles and the states
+// of their candidates, indexed like the query's units and features
+struct CollisionBatchChunk {
+	QuadFieldColVolBatchQuery query;
+
+	std::vector<CollisionCandidateState> unitStates;
+	std::vector<CollisionCandidateState> featureStates;
+};
+
+
+// same filters as CheckUnitCollisions and CheckFeatureCollisions, but without side-effects
+static bool TestUnitCandidate(const CProjectile* p, const CUnit* unit)
+{
+	if (unit == p->owner())
+		return false;
+	if (!unit->HasCollidableStateBit(CSolidObject::CSTATE_BIT_PROJECTILES))
+		return false;
+
+	return (CheckProjectileCollisionFlags(p, unit));
+}
+
+static bool TestFeatureCandidate(const CProjectile* p, const CFeature* feature)
+{
+	if ((p->GetCollisionFlags() & Collision::NOFEATURES) != 0)
+		return false;
+
+	return (feature->HasCollidableStateBit(CSolidObject::CSTATE_BIT_PROJECTILES));
+}
+
+template<typename T>
+static bool HaveCollision(
+	T* const* objects,
+	const CollisionCandidateState* states,
+	const size_t numObjects,
+	const float3 ppos0,
+	const float3 ppos1
+) {
+	CollisionTestBatch<16> batch;
+
+	for (size_t n = 0; n < numObjects; n++) {
+		if (!states[n].tested)
+			continue;
+
+		batch.Add(objects[n], states[n].transform);
+
+		if (batch.Full()) {
+			if (batch.DetectHits(ppos0, ppos1) != 0)
+				return true;
+
+			batch.Clear();
+		}
+	}
+
+	return (batch.DetectHits(ppos0, ppos1) != 0);
+}
+
+template<typename T>
+static bool SameCandidates(T* const* a, size_t numA, T* const* b, size_t numB)
+{
+	// pointers are only compared, <b> may refer to objects deleted since
+	return (numA == numB && std::equal(a, a + numA, b));
+}
+
+
 void CProjectileHandler::CheckUnitFeatureCollisions(ProjectileContainer& pc)
 {
+	// projectiles are tested in batches whose size only depends on the
+	// simulation state (never on the thread count), broadphase and hit
+	// detection run in parallel and only the projectiles that actually
+	// touch something take the serial path below, in container order
+	//
+	// each serial collision can change anything the remaining results of
+	// its batch rely on, so their broadphase is repeated and a result is
+	// only kept if the projectile's ray, its candidates and the states of
+	// those candidates are all bitwise unchanged; everything else is tested
+	// again (piece trees and shields always are)
+	constexpr size_t MIN_BATCH_SIZE = 16;
+	constexpr size_t MAX_BATCH_SIZE = 256;
+	constexpr size_t QUERY_CHUNK_SIZE = 16;
+
 	static std::vector<CUnit*> tempUnits;
 	static std::vector<CFeature*> tempFeatures;
 	static std::vector<CPlasmaRepulser*> tempRepulsers;
 
-	for (size_t i = 0; i < pc.size(); ++i) {
-		CProjectile* p = pc[i];
+	static std::vector<CProjectile*> batchProjectiles;
+	static std::vector<size_t> batchIndices;
+	static std::vector<float4> batchSpheres;
+	// rays the current results were computed for
+	static std::vector<float4> prevSpheres;
+	static std::vector<float3> prevEnds;
+	static std::vector<uint8_t> batchContacts;
+	static std::array<CollisionBatchChunk, MAX_BATCH_SIZE / QUERY_CHUNK_SIZE> batchChunks;
+	static std::array<CollisionBatchChunk, MAX_BATCH_SIZE / QUERY_CHUNK_SIZE> prevChunks;
+
+	size_t batchSize = MAX_BATCH_SIZE;
+	size_t numProjectiles = 0;
+	size_t numChunks = 0;
+
+	// (re)computes batchContacts[n] for every n >= firstEntry
+	const auto DetectContacts = [&](const size_t firstEntry, const bool revalidate) {
+		const size_t firstChunk = firstEntry / QUERY_CHUNK_SIZE;
+
+		for (size_t c = firstChunk; c < numChunks; c++) {
+			std::swap(batchChunks[c], prevChunks[c]);
+		}
+		for (size_t n = firstEntry; n < numProjectiles; n++) {
+			const CProjectile* p = batchProjectiles[n];
+
+			prevSpheres[n] = batchSpheres[n];
+			batchSpheres[n] = float4(p->pos, p->radius + p->speed.w);
+		}
+
+		// entries of the first chunk before firstEntry are queried again
+		// as well, their results are never looked at anymore
+		for_mt(firstChunk, numChunks, [&](const int c) {
+			CollisionBatchChunk& chunk = batchChunks[c];
+
+			const size_t beg = c * QUERY_CHUNK_SIZE;
+			const size_t cnt = std::min(numProjectiles - beg, QUERY_CHUNK_SIZE);
+
+			quadField->GetUnitsAndFeaturesColVolBatch(chunk.query, &batchSpheres[beg], cnt);
+
+			chunk.unitStates.resize(chunk.query.units.size());
+			chunk.featureStates.resize(chunk.query.features.size());
+		});
+
+		// piece matrices are updated lazily on first read; do it here so the
+		// narrowphase threads below never write to shared model state
+		for (size_t c = firstChunk; c < numChunks; c++) {
+			const QuadFieldColVolBatchQuery& qfbq = batchChunks[c].query;
+
+			for (const CUnit* u: qfbq.units) {
+				if (u->collisionVolume.DefaultToPieceTree())
+					u->localModel.UpdatePieceMatrices();
+			}
+			for (const CFeature* f: qfbq.features) {
+				if (f->collisionVolume.DefaultToPieceTree())
+					f->localModel.UpdatePieceMatrices();
+			}
+		}
+
+		for_mt(firstEntry, numProjectiles, [&](const int n) {
+			CollisionBatchChunk& chunk = batchChunks[n / QUERY_CHUNK_SIZE];
 
-		if (!p->checkCol) continue;
-		if ( p->deleteMe) continue;
+			const QuadFieldColVolBatchQuery& qfbq = chunk.query;
+			const QuadFieldColVolBatchQuery& prev = prevChunks[n / QUERY_CHUNK_SIZE].query;
+			const CProjectile* p = batchProjectiles[n];
 
-		const float3 ppos0 = p->pos;
-		const float3 ppos1 = p->pos + p->speed;
+			const size_t k = n % QUERY_CHUNK_SIZE;
 
-		quadField->GetUnitsAndFeaturesColVol(p->pos, p->radius + p->speed.w, tempUnits, tempFeatures, &tempRepulsers);
+			const float3 ppos0 = p->pos;
+			const float3 ppos1 = p->pos + p->speed;
+
+			CUnit* const* units = qfbq.GetUnits(k);
+			CFeature* const* features = qfbq.GetFeatures(k);
+			CollisionCandidateState* unitStates = &chunk.unitStates[qfbq.unitOffsets[k]];
+			CollisionCandidateState* featureStates = &chunk.featureStates[qfbq.featureOffsets[k]];
+
+			for (size_t j = 0; j < qfbq.NumUnits(k); j++) {
+				unitStates[j].Set(units[j], TestUnitCandidate(p, units[j]));
+			}
+			for (size_t j = 0; j < qfbq.NumFeatures(k); j++) {
+				featureStates[j].Set(features[j], TestFeatureCandidate(p, features[j]));
+			}
+
+			bool reuse = revalidate;
+
+			reuse = reuse && (std::memcmp(&prevSpheres[n], &batchSpheres[n], sizeof(float4)) == 0);
+			reuse = reuse && (std::memcmp(&prevEnds[n], &ppos1, sizeof(float3)) == 0);
+			reuse = reuse && SameCandidates(units, qfbq.NumUnits(k), prev.GetUnits(k), prev.NumUnits(k));
+			reuse = reuse && SameCandidates(features, qfbq.NumFeatures(k), prev.GetFeatures(k), prev.NumFeatures(k));
+			reuse = reuse && (qfbq.NumRepulsers(k) == 0 && prev.NumRepulsers(k) == 0);
+
+			for (size_t j = 0; reuse && j < qfbq.NumUnits(k); j++) {
+				reuse = unitStates[j].Reusable(prevChunks[n / QUERY_CHUNK_SIZE].unitStates[prev.unitOffsets[k] + j]);
+			}
+			for (size_t j = 0; reuse && j < qfbq.NumFeatures(k); j++) {
+				reuse = featureStates[j].Reusable(prevChunks[n / QUERY_CHUNK_SIZE].featureStates[prev.featureOffsets[k] + j]);
+			}
+
+			prevEnds[n] = ppos1;
+
+			if (reuse)
+				return;
+
+			// shields are rare and run Lua callins, always leave them to the serial path
+			batchContacts[n] = (qfbq.NumRepulsers(k) != 0);
+			batchContacts[n] = batchContacts[n] || HaveCollision(units, unitStates, qfbq.NumUnits(k), ppos0, ppos1);
+			batchContacts[n] = batchContacts[n] || HaveCollision(features, featureStates, qfbq.NumFeatures(k), ppos0, ppos1);
+		});
+	};
+
+	for (size_t i = 0; i < pc.size(); ) {
+		batchProjectiles.clear();
+		batchIndices.clear();
+
+		for (size_t j = i; j < pc.size() && batchProjectiles.size() < batchSize; j++) {
+			CProjectile* p = pc[j];
+
+			if (!p->checkCol) continue;
+			if ( p->deleteMe) continue;
+
+			batchProjectiles.push_back(p);
+			batchIndices.push_back(j);
+		}
+
+		if (batchProjectiles.empty())
+			break;
+
+		numProjectiles = batchProjectiles.size();
+		numChunks = (numProjectiles + QUERY_CHUNK_SIZE - 1) / QUERY_CHUNK_SIZE;
+
+		batchSpheres.resize(numProjectiles);
+		prevSpheres.resize(numProjectiles);
+		prevEnds.resize(numProjectiles);
+
+		batchContacts.clear();
+		batchContacts.resize(numProjectiles, 0);
+
+		DetectContacts(0, false);
+
+		size_t numContacts = 0;
+
+		for (size_t n = 0; n < numProjectiles; n++) {
+			if (batchContacts[n] == 0)
+				continue;
+
+			CProjectile* p = batchProjectiles[n];
+
+			numContacts += 1;
+
+			// an earlier collision in this batch might have taken care of it
+			if (!p->checkCol) continue;
+			if ( p->deleteMe) continue;
+
+			const float3 ppos0 = p->pos;
+			const float3 ppos1 = p->pos + p->speed;
+
+			quadField->GetUnitsAndFeaturesColVol(p->pos, p->radius + p->speed.w, tempUnits, tempFeatures, &tempRepulsers);
+
+			CheckShieldCollisions(p, tempRepulsers, ppos0, ppos1); tempRepulsers.clear();
+			CheckUnitCollisions(p, tempUnits, ppos0, ppos1); tempUnits.clear();
+			CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1); tempFeatures.clear();
+
+			if ((n + 1) < numProjectiles)
+				DetectContacts(n + 1, true);
+		}
 
-		CheckShieldCollisions(p, tempRepulsers, ppos0, ppos1); tempRepulsers.clear();
-		CheckUnitCollisions(p, tempUnits, ppos0, ppos1); tempUnits.clear();
-		CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1); tempFeatures.clear();
+		// shrink batches while collisions are dense, every one of them
+		// repeats the broadphase for the rest of its batch
+		i = batchIndices.back() + 1;
+		batchSize = Clamp((numProjectiles * 2) / (numContacts + 1), MIN_BATCH_SIZE, MAX_BATCH_SIZE);
 	}
 }
 
@@ -717,9 +1005,7 @@ void CProjectileHandler::AddNanoParticle(
 
 CProjectile* CProjectileHandler::GetProjectileBySyncedID(int id)
 {
-	if ((size_t)id < syncedProjectileIDs.size())
-		return syncedProjectileIDs[id];
-	return nullptr;
+	return (syncedProjectileIDs.Get(id));
 }
 
 
@@ -728,9 +1014,7 @@ CProjectile* CProjectileHandler::GetProjectileByUnsyncedID(int id)
 	if (UNSYNCED_PROJ_NOEVENT)
 		return nullptr; // unsynced projectiles have no IDs if UNSYNCED_PROJ_NOEVENT
 
-	if ((size_t)id < unsyncedProjectileIDs.size())
-		return unsyncedProjectileIDs[id];
-	return nullptr;
+	return (unsyncedProjectileIDs.Get(id));
 }
 
 
@@ -7,6 +7,7 @@
 #include <deque>
 #include <vector>
 #include "Rendering/Models/3DModel.h"
+#include "Sim/Misc/SimObjectHandleTable.h"
 #include "Sim/Projectiles/ProjectileFunctors.h"
 #include "System/float3.h"
 
@@ -22,7 +23,7 @@ struct UnitDef;
 struct FlyingPiece;
 
 
-typedef std::vector<CProjectile*> ProjectileMap;
+typedef SimObjectHandleTable<CProjectile> ProjectileMap;
 typedef std::vector<CProjectile*> ProjectileContainer; // <unsorted>
 typedef std::vector<CGroundFlash*> GroundFlashContainer;
 typedef std::vector<FlyingPiece> FlyingPieceContainer;
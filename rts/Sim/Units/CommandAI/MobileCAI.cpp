@@ -1584,10 +1584,16 @@ CUnit* CMobileCAI::FindUnitToTransport(float3 center, float radius)
 	CUnit* bestUnit = nullptr;
 	float bestDist = std::numeric_limits<float>::max();
 
-	QuadFieldQuery qfQuery;
-	quadField->GetUnitsExact(qfQuery, center, radius);
+	// reused across calls; the batched query also leaves CUnit::tempNum alone
+	static QuadFieldBatchQuery qfbq;
+
+	const float4 sphere = {center, radius};
+
+	quadField->GetUnitsExactBatch(qfbq, &sphere, 1);
+
+	for (size_t i = 0, n = qfbq.NumResults(0); i < n; i++) {
+		CUnit* unit = qfbq.GetResults(0)[i];
 
-	for (CUnit* unit: *qfQuery.units) {
 		const float dist = unit->pos.SqDistance2D(owner->pos);
 
 		if (unit->loadingTransportId != -1 && unit->loadingTransportId != owner->id) {
@@ -11,6 +11,7 @@
 #include "UnitTypes/Factory.h"
 
 #include "CommandAI/BuilderCAI.h"
+#include "Game/GameHelper.h"
 #include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/MoveTypes/MoveType.h"
@@ -20,17 +21,26 @@
 #include "System/myMath.h"
 #include "System/TimeProfiler.h"
 #include "System/Sync/SyncTracer.h"
+#include "System/Threading/ThreadPool.h"
 #include "System/creg/STL_Deque.h"
 #include "System/creg/STL_List.h"
 #include "System/creg/STL_Set.h"
 
 
+CR_BIND_TEMPLATE(SimObjectHandleTable<CUnit>, )
+CR_REG_METADATA_TEMPLATE(SimObjectHandleTable<CUnit>, (
+	CR_MEMBER(objects),
+	CR_MEMBER(generations)
+))
+
 CR_BIND(CUnitHandler, )
 CR_REG_METADATA(CUnitHandler, (
 	CR_MEMBER(units),
 	CR_MEMBER(unitsByDefs),
 	CR_MEMBER(activeUnits),
 	CR_MEMBER(builderCAIs),
+	CR_IGNORED(autoTargetWeapons),
+	CR_IGNORED(autoTargetCandidates),
 	CR_MEMBER(idPool),
 	CR_MEMBER(unitsToBeRemoved),
 	CR_MEMBER(activeSlowUpdateUnit),
@@ -94,13 +104,13 @@ CUnitHandler::CUnitHandler():
 		maxUnits += teamHandler->Team(n)->GetMaxUnits();
 	}
 
-	units.resize(maxUnits, nullptr);
+	units.Resize(maxUnits);
 	unitsByDefs.resize(teamHandler->ActiveTeams(), std::vector<std::vector<CUnit*>>(unitDefHandler->unitDefs.size()));
 
 	unitMemPool.reserve(128);
-	// id's are used as indices, so they must lie in [0, units.size() - 1]
+	// id's are used as indices, so they must lie in [0, units.Size() - 1]
 	// (furthermore all id's are treated equally, none have special status)
-	idPool.Expand(0, units.size());
+	idPool.Expand(0, units.Size());
 
 	activeSlowUpdateUnit = 0;
 	activeUpdateUnit = 0;
@@ -134,8 +144,7 @@ void CUnitHandler::InsertActiveUnit(CUnit* unit)
 {
 	idPool.AssignID(unit);
 
-	assert(unit->id < units.size());
-	assert(units[unit->id] == nullptr);
+	assert(units.IsFree(unit->id));
 
 	#if 0
 	// randomized insertion is supposed to break up peak loads
@@ -160,7 +169,7 @@ void CUnitHandler::InsertActiveUnit(CUnit* unit)
 	activeUnits.push_back(unit);
 	#endif
 
-	units[unit->id] = unit;
+	units.Insert(unit->id, unit);
 }
 
 
@@ -216,7 +225,7 @@ void CUnitHandler::DeleteUnitNow(CUnit* delUnit)
 		spring::VectorErase(unitsByDefs[delTeam][delType], delUnit);
 		idPool.FreeID(delUnit->id, true);
 
-		units[delUnit->id] = nullptr;
+		units.Erase(delUnit->id);
 
 		CSolidObject::SetDeletingRefID(delUnit->id);
 		unitMemPool.free(delUnit);
@@ -227,6 +236,50 @@ void CUnitHandler::DeleteUnitNow(CUnit* delUnit)
 }
 
 
+void CUnitHandler::UpdateWeaponTargets()
+{
+	if (autoTargetWeapons.empty())
+		return;
+
+	// targets are applied in unit-ID (then weapon-number) order
+	std::sort(autoTargetWeapons.begin(), autoTargetWeapons.end(), [](const CWeapon* a, const CWeapon* b) {
+		if (a->owner->id != b->owner->id)
+			return (a->owner->id < b->owner->id);
+
+		return (a->weaponNum < b->weaponNum);
+	});
+
+	if (autoTargetCandidates.size() < autoTargetWeapons.size())
+		autoTargetCandidates.resize(autoTargetWeapons.size());
+
+	// read-only pass; every weapon gathers into its own candidate list
+	// so the result is identical for any number of threads
+	for_mt(0, autoTargetWeapons.size(), [&](const int i) {
+		const CWeapon* w = autoTargetWeapons[i];
+
+		autoTargetCandidates[i].clear();
+
+		if (!w->owner->CanUpdateWeapons())
+			return;
+
+		CGameHelper::GatherWeaponTargets(w, w->GetAutoTargetAvoidUnit(), autoTargetCandidates[i]);
+	});
+
+	// serial pass; draws from the synced RNG and calls into Lua
+	for (size_t i = 0; i < autoTargetWeapons.size(); i++) {
+		CWeapon* w = autoTargetWeapons[i];
+
+		// owner may have been killed in the meantime (e.g. by Lua)
+		if (w->owner->CanUpdateWeapons())
+			w->AutoTarget(autoTargetCandidates[i]);
+
+		w->ClearAutoTargetPending();
+	}
+
+	autoTargetWeapons.clear();
+}
+
+
 void CUnitHandler::Update()
 {
 	auto UNIT_SANITY_CHECK = [](const CUnit* unit) {
@@ -251,6 +304,13 @@ void CUnitHandler::Update()
 	{
 		SCOPED_TIMER("Sim::Unit::MoveType");
 
+		// read-only pass; the serial commit loop below revalidates
+		// every cached intent, so the result is identical for any
+		// number of threads
+		for_mt(0, activeUnits.size(), [&](const int i) {
+			activeUnits[i]->moveType->UpdateMoveIntent();
+		});
+
 		for (activeUpdateUnit = 0; activeUpdateUnit < activeUnits.size(); ++activeUpdateUnit) {
 			CUnit* unit = activeUnits[activeUpdateUnit];
 			AMoveType* moveType = unit->moveType;
@@ -316,8 +376,15 @@ void CUnitHandler::Update()
 			unit->localModel.UpdateBoundingVolume();
 			UNIT_SANITY_CHECK(unit);
 
+			for (CWeapon* w: unit->weapons) {
+				if (w->AutoTargetPending())
+					autoTargetWeapons.push_back(w);
+			}
+
 			n--;
 		}
+
+		UpdateWeaponTargets();
 	}
 
 	{
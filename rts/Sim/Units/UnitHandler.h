@@ -6,10 +6,13 @@
 #include <vector>
 
 #include "UnitDef.h"
+#include "Sim/Misc/SimObjectHandleTable.h"
 #include "Sim/Misc/SimObjectIDPool.h"
+#include "Sim/Weapons/WeaponTarget.h"
 #include "System/creg/STL_Map.h"
 
 class CUnit;
+class CWeapon;
 class CBuilderCAI;
 
 class CUnitHandler
@@ -31,7 +34,7 @@ public:
 			return (!idPool.IsEmpty());
 		// is this ID not already in use?
 		if (id < MaxUnits())
-			return (units[id] == nullptr);
+			return (units.IsFree(id));
 		// AddUnit will not make new room for us
 		return false;
 	}
@@ -46,8 +49,11 @@ public:
 	void RemoveBuilderCAI(CBuilderCAI*);
 
 	// note: negative ID's are implicitly converted
-	CUnit* GetUnitUnsafe(unsigned int id) const { return units[id]; }
-	CUnit* GetUnit(unsigned int id) const { return ((id < MaxUnits())? units[id]: nullptr); }
+	CUnit* GetUnitUnsafe(unsigned int id) const { return (units.GetUnsafe(id)); }
+	CUnit* GetUnit(unsigned int id) const { return (units.Get(id)); }
+	CUnit* GetUnit(const SimObjectHandle& h) const { return (units.Get(h)); }
+
+	SimObjectHandle GetUnitHandle(unsigned int id) const { return (units.GetHandle(id)); }
 
 	static CUnit* NewUnit(const UnitDef* ud);
 
@@ -65,16 +71,21 @@ private:
 	void DeleteUnitNow(CUnit* unit);
 	void DeleteUnitsNow();
 	void InsertActiveUnit(CUnit* unit);
+	void UpdateWeaponTargets();
 
 private:
 	SimObjectIDPool idPool;
 
-	std::vector<CUnit*> units;                         ///< used to get units from IDs (0 if not created)
+	SimObjectHandleTable<CUnit> units;                 ///< used to get units from IDs (0 if not created)
 	std::vector<CUnit*> activeUnits;                   ///< used to get all active units
 	std::vector<CUnit*> unitsToBeRemoved;              ///< units that will be removed at start of next update
 
 	spring::unordered_map<unsigned int, CBuilderCAI*> builderCAIs;
 
+	// transient per-frame state of the batched weapon auto-targeting pass
+	std::vector<CWeapon*> autoTargetWeapons;
+	std::vector< std::vector<SWeaponTargetCandidate> > autoTargetCandidates;
+
 	size_t activeSlowUpdateUnit;  ///< first unit of batch that will be SlowUpdate'd this frame
 	size_t activeUpdateUnit;  ///< first unit of batch that will be SlowUpdate'd this frame
 
@@ -42,6 +42,7 @@ private:
 	const float3& GetAimFromPos(bool useMuzzle = false) const override { return weaponMuzzlePos; }
 
 	bool HaveFreeLineOfFire(const float3 srcPos, const float3 tgtPos, const SWeaponTarget& trg) const override final;
+	float4 GetLineOfFireParams() const override final { return {gravity, projectileSpeed, highTrajectory? 1.0f: 0.0f, 0.0f}; }
 	void FireImpl(const bool scriptCall) override final;
 };
 
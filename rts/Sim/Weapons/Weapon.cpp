@@ -8,10 +8,12 @@
 #include "Game/Players/Player.h"
 #include "Lua/LuaConfig.h"
 #include "Map/Ground.h"
+#include "Map/ReadMap.h"
 #include "Sim/Misc/CollisionHandler.h"
 #include "Sim/Misc/CollisionVolume.h"
 #include "Sim/Misc/InterceptHandler.h"
 #include "Sim/Misc/ModInfo.h"
+#include "Sim/Misc/QuadField.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/MoveTypes/AAirMoveType.h"
 #include "Sim/Projectiles/ProjectileHandler.h"
@@ -59,6 +61,7 @@ CR_REG_METADATA(CWeapon, (
 	CR_MEMBER(muzzleFlareSize),
 	CR_MEMBER(doTargetGroundPos),
 	CR_MEMBER(noAutoTarget),
+	CR_MEMBER(autoTargetPending),
 	CR_MEMBER(alreadyWarnedAboutMissingPieces),
 
 	CR_MEMBER(badTargetCategory),
@@ -94,7 +97,13 @@ CR_REG_METADATA(CWeapon, (
 	CR_MEMBER(currentTarget),
 	CR_MEMBER(currentTargetPos),
 
-	CR_MEMBER(incomingProjectileIDs)
+	CR_MEMBER(incomingProjectileIDs),
+
+	CR_IGNORED(lineOfFireQueries),
+	CR_IGNORED(lineOfFireQueryIdx),
+
+	CR_IGNORED(autoTargetCandidates),
+	CR_IGNORED(autoTargets)
 ))
 
 
@@ -131,6 +140,7 @@ CWeapon::CWeapon(CUnit* owner, const WeaponDef* def):
 	onlyForward(false),
 	doTargetGroundPos(false),
 	noAutoTarget(false),
+	autoTargetPending(false),
 	alreadyWarnedAboutMissingPieces(false),
 	badTargetCategory(0),
 	onlyTargetCategory(0xffffffff),
@@ -161,9 +171,14 @@ CWeapon::CWeapon(CUnit* owner, const WeaponDef* def):
 	errorVectorAdd(ZeroVector),
 	muzzleFlareSize(1),
 	fireSoundId(0),
-	fireSoundVolume(0)
+	fireSoundVolume(0),
+	lineOfFireQueryIdx(0)
 {
 	assert(weaponMemPool.alloced(this));
+
+	for (LineOfFireQuery& q: lineOfFireQueries) {
+		q.frameNum = -1;
+	}
 }
 
 
@@ -400,7 +415,7 @@ void CWeapon::UpdateFire()
 	if (!CanFire(false, false, false))
 		return;
 
-	if (!TryTarget(currentTargetPos, currentTarget, true))
+	if (!TryTarget(currentTargetPos, currentTarget, true, true))
 		return;
 
 	// pre-check if we got enough resources (so CobBlockShot gets only called when really possible to shoot)
@@ -585,7 +600,7 @@ bool CWeapon::AllowWeaponAutoTarget() const
 	if (avoidTarget)   { return true; }
 
 	if (currentTarget.type == Target_Unit) {
-		if (!TryTarget(SWeaponTarget(currentTarget.unit, currentTarget.isUserTarget))) {
+		if (!TryTargetCached(SWeaponTarget(currentTarget.unit, currentTarget.isUserTarget))) {
 			// if we have a user-target (ie. a user attack order)
 			// then only allow generating opportunity targets iff
 			// it is not possible to hit the user's chosen unit
@@ -624,19 +639,32 @@ bool CWeapon::AutoTarget()
 	// search for other in range targets
 	lastTargetRetry = gs->frameNum;
 
-	const CUnit* avoidUnit = (avoidTarget && currentTarget.type == Target_Unit) ? currentTarget.unit : nullptr;
+	autoTargetCandidates.clear();
+
+	CGameHelper::GatherWeaponTargets(this, GetAutoTargetAvoidUnit(), autoTargetCandidates);
 
+	return (AutoTarget(autoTargetCandidates));
+}
+
+bool CWeapon::AutoTarget(const std::vector<SWeaponTargetCandidate>& candidates)
+{
+	// batched version; AllowWeaponAutoTarget was already checked by SlowUpdate
+	// and <candidates> were gathered by CGameHelper::GatherWeaponTargets
+	//
 	// NOTE:
-	//   GenerateWeaponTargets sorts by INCREASING order of priority, so lower equals better
-	//   <targets> is normally sorted such that all bad TargetCategory units are at the end,
+	//   ScoreWeaponTargets sorts by INCREASING order of priority, so lower equals better
+	//   <autoTargets> is normally sorted such that all bad TargetCategory units are at the end,
 	//   but Lua can mess with the ordering arbitrarily
-	static std::vector<std::pair<float, CUnit*>> targets;
+	autoTargets.clear();
+	autoTargets.reserve(16);
 
-	targets.clear();
-	targets.reserve(16);
+	CGameHelper::ScoreWeaponTargets(this, candidates, autoTargets);
 
-	CGameHelper::GenerateWeaponTargets(this, avoidUnit, targets);
+	return (PickAutoTarget(autoTargets));
+}
 
+bool CWeapon::PickAutoTarget(const std::vector<std::pair<float, CUnit*>>& targets)
+{
 	CUnit* goodTargetUnit = nullptr;
 	CUnit* badTargetUnit = nullptr;
 
@@ -649,7 +677,7 @@ bool CWeapon::AutoTarget()
 		if (isBadTarget && (badTargetUnit != nullptr))
 			continue;
 
-		if (!TryTarget(SWeaponTarget(unit)))
+		if (!TryTargetCached(SWeaponTarget(unit)))
 			continue;
 
 		if (unit->IsNeutral() && (owner->fireState < FIRESTATE_FIREATNEUTRAL))
@@ -709,8 +737,11 @@ void CWeapon::SlowUpdate()
 		//Try to return fire
 		Attack(owner->lastAttacker);
 	}
-	// AutoTarget: Find new/better Target
-	AutoTarget();
+	// AutoTarget: Find new/better Target; the search itself is deferred
+	// to the batched targeting pass run by CUnitHandler after all units
+	// scheduled for this frame have been SlowUpdate'd
+	if ((autoTargetPending = AllowWeaponAutoTarget()))
+		lastTargetRetry = gs->frameNum;
 }
 
 
@@ -719,7 +750,7 @@ void CWeapon::HoldIfTargetInvalid()
 	if (!HaveTarget())
 		return;
 
-	if (!TryTarget(currentTarget)) {
+	if (!TryTargetCached(currentTarget)) {
 		DropCurrentTarget();
 		return;
 	}
@@ -838,7 +869,7 @@ float3 CWeapon::GetTargetBorderPos(
 }
 
 
-bool CWeapon::TryTarget(const float3 tgtPos, const SWeaponTarget& trg, bool preFire) const
+bool CWeapon::TryTarget(const float3 tgtPos, const SWeaponTarget& trg, bool preFire, bool cachedLOF) const
 {
 	assert(GetLeadTargetPos(trg).SqDistance(tgtPos) < Square(250.0f));
 
@@ -852,6 +883,9 @@ bool CWeapon::TryTarget(const float3 tgtPos, const SWeaponTarget& trg, bool preF
 		return false;
 
 	// TODO: add a forcedUserTarget (forced-fire mode enabled with CTRL e.g.) and skip the tests below
+	if (cachedLOF)
+		return (HaveFreeLineOfFireCached(GetAimFromPos(preFire), tgtPos, trg));
+
 	return (HaveFreeLineOfFire(GetAimFromPos(preFire), tgtPos, trg));
 }
 
@@ -991,10 +1025,71 @@ bool CWeapon::HaveFreeLineOfFire(const float3 srcPos, const float3 tgtPos, const
 }
 
 
+float4 CWeapon::GetLineOfFireParams() const
+{
+	return {damages->damageAreaOfEffect, 0.0f, 0.0f, 0.0f};
+}
+
+bool CWeapon::HaveFreeLineOfFireCached(const float3 srcPos, const float3 tgtPos, const SWeaponTarget& trg) const
+{
+	LineOfFireQuery query;
+
+	query.srcPos = srcPos;
+	query.tgtPos = tgtPos;
+	query.muzzlePos = weaponMuzzlePos;
+	query.tgtObject = (trg.type == Target_Unit)? static_cast<const void*>(trg.unit): static_cast<const void*>(trg.intercept);
+	query.tgtType = trg.type;
+	query.frameNum = gs->frameNum;
+	query.avoidFlags = avoidFlags;
+	query.quadUpdateCount = quadField->GetUpdateCount();
+	query.mapUpdateCount = readMap->GetSyncedUpdateCount();
+	query.spread = AccuracyExperience() + SprayAngleExperience();
+	query.params = GetLineOfFireParams();
+
+	// exact comparison; float3::operator== has an epsilon tolerance
+	const auto SameVec = [](const float4& a, const float4& b) {
+		return (a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w);
+	};
+
+	// results are only reused within a frame and while no unit or feature
+	// has changed quads (or been added or removed) and the terrain has not
+	// been deformed; every input that HaveFreeLineOfFire reads from this
+	// weapon is part of the key
+	const auto SameQuery = [&](const LineOfFireQuery& q) {
+		if (q.frameNum != query.frameNum || q.tgtType != query.tgtType || q.tgtObject != query.tgtObject)
+			return false;
+		if (q.quadUpdateCount != query.quadUpdateCount || q.mapUpdateCount != query.mapUpdateCount)
+			return false;
+		if (q.avoidFlags != query.avoidFlags || q.spread != query.spread)
+			return false;
+		if (!SameVec(q.params, query.params))
+			return false;
+
+		return (SameVec(q.srcPos, query.srcPos) && SameVec(q.tgtPos, query.tgtPos) && SameVec(q.muzzlePos, query.muzzlePos));
+	};
+
+	for (const LineOfFireQuery& q: lineOfFireQueries) {
+		if (SameQuery(q))
+			return q.result;
+	}
+
+	query.result = HaveFreeLineOfFire(srcPos, tgtPos, trg);
+
+	lineOfFireQueries[lineOfFireQueryIdx] = query;
+	lineOfFireQueryIdx = (lineOfFireQueryIdx + 1) % lineOfFireQueries.size();
+
+	return query.result;
+}
+
+
 bool CWeapon::TryTarget(const SWeaponTarget& trg) const {
 	return TryTarget(GetLeadTargetPos(trg), trg);
 }
 
+bool CWeapon::TryTargetCached(const SWeaponTarget& trg) const {
+	return TryTarget(GetLeadTargetPos(trg), trg, false, true);
+}
+
 
 bool CWeapon::TryTargetRotate(const CUnit* unit, bool userTarget, bool manualFire)
 {
@@ -3,6 +3,7 @@
 #ifndef WEAPON_H
 #define WEAPON_H
 
+#include <array>
 #include <vector>
 
 #include "System/Object.h"
@@ -10,6 +11,7 @@
 #include "Sim/Projectiles/ProjectileParams.h"
 #include "Sim/Weapons/WeaponTarget.h"
 #include "System/float3.h"
+#include "System/float4.h"
 
 class CUnit;
 class CWeaponProjectile;
@@ -52,6 +54,9 @@ public:
 	virtual bool TestRange(const float3 tgtPos, const SWeaponTarget& trg) const;
 	/// test if something is blocking our LineOfFire
 	virtual bool HaveFreeLineOfFire(const float3 srcPos, const float3 tgtPos, const SWeaponTarget& trg) const;
+	/// inputs of HaveFreeLineOfFire that are specific to the weapon type (e.g.
+	/// trajectory settings) and may change at runtime; part of the LOF-cache key
+	virtual float4 GetLineOfFireParams() const;
 
 	virtual bool CanFire(bool ignoreAngleGood, bool ignoreTargetType, bool ignoreRequestedDir) const;
 
@@ -75,6 +80,10 @@ public:
 	virtual void UpdateRange(const float val) { range = val; }
 
 	bool AutoTarget();
+	bool AutoTarget(const std::vector<SWeaponTargetCandidate>& candidates);
+	bool AutoTargetPending() const { return autoTargetPending; }
+	void ClearAutoTargetPending() { autoTargetPending = false; }
+	const CUnit* GetAutoTargetAvoidUnit() const { return ((avoidTarget && currentTarget.type == Target_Unit)? currentTarget.unit: nullptr); }
 	void AimReady(const int value);
 	void Fire(const bool scriptCall);
 
@@ -107,11 +116,18 @@ private:
 
 	void UpdateInterceptTarget();
 	bool AllowWeaponAutoTarget() const;
+	bool PickAutoTarget(const std::vector<std::pair<float, CUnit*>>& targets);
 	bool CobBlockShot() const;
 	void ReAimWeapon();
 	void HoldIfTargetInvalid();
 
-	bool TryTarget(const float3 tgtPos, const SWeaponTarget& trg, bool preFire = false) const;
+	// cachedLOF may only be set by the synced update paths (UpdateFire,
+	// SlowUpdate and auto-targeting); public TryTarget is also called
+	// from unsynced code and must not touch lineOfFireQueries
+	bool TryTarget(const float3 tgtPos, const SWeaponTarget& trg, bool preFire = false, bool cachedLOF = false) const;
+	bool TryTargetCached(const SWeaponTarget& trg) const;
+	/// HaveFreeLineOfFire, reusing results of identical queries made earlier in the same frame
+	bool HaveFreeLineOfFireCached(const float3 srcPos, const float3 tgtPos, const SWeaponTarget& trg) const;
 
 public:
 	CUnit* owner;
@@ -149,6 +165,7 @@ public:
 	bool onlyForward;                       // can only fire in the forward direction of the unit (for aircrafts mostly?)
 	bool doTargetGroundPos;                 // (used for bombers) target the ground pos under the unit instead of the center aimPos
 	bool noAutoTarget;
+	bool autoTargetPending;                 // set by SlowUpdate, consumed by the batched targeting pass in CUnitHandler
 	bool alreadyWarnedAboutMissingPieces;
 
 	unsigned int badTargetCategory;         // targets in this category get a lot lower targetting priority
@@ -190,6 +207,37 @@ protected:
 	SWeaponTarget currentTarget;
 	float3 currentTargetPos;
 
+	struct LineOfFireQuery {
+		float3 srcPos;
+		float3 tgtPos;
+		float3 muzzlePos;
+		const void* tgtObject;
+
+		int tgtType;
+		int frameNum;
+
+		unsigned int avoidFlags;
+		unsigned int quadUpdateCount;
+		unsigned int mapUpdateCount;
+
+		float4 params;
+
+		float spread;
+		bool result;
+	};
+
+	// the last few HaveFreeLineOfFire results; the synced update paths
+	// (SlowUpdate, auto-targeting and UpdateFire) test the same target
+	// several times per frame and each test traces the ray
+	mutable std::array<LineOfFireQuery, 2> lineOfFireQueries;
+	mutable unsigned int lineOfFireQueryIdx;
+
+	// scratch buffers of AutoTarget; per weapon (not function-static) since
+	// the Lua AllowWeaponTarget callin can re-enter auto-targeting while a
+	// list is being walked
+	std::vector<SWeaponTargetCandidate> autoTargetCandidates;
+	std::vector<std::pair<float, CUnit*>> autoTargets;
+
 	// projectiles that are on the way to our interception zone
 	// (eg. nuke toward a repulsor, or missile toward a shield)
 	std::vector<int> incomingProjectileIDs;
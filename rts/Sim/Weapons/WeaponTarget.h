@@ -45,4 +45,12 @@ public:
 	float3 groundPos;             // if targettype=ground: the ground position
 };
 
+
+// auto-targeting candidate, see CGameHelper::GatherWeaponTargets
+struct SWeaponTargetCandidate {
+	CUnit* unit;
+	float priority; // partial, completed by CGameHelper::ScoreWeaponTargets
+	unsigned short losStatus;
+};
+
 #endif // WEAPONTARGET_H
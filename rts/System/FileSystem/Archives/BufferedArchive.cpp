@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "BufferedArchive.h"
+#include "System/FileSystem/FileView.h"
 
 #include <cassert>
 
@@ -9,22 +10,110 @@ CBufferedArchive::CBufferedArchive(const std::string& name, bool cache): IArchiv
 	caching = cache;
 }
 
+const std::shared_ptr<const std::vector<std::uint8_t>>& CBufferedArchive::GetCachedFile(unsigned int fid, bool& exists, std::unique_lock<spring::mutex>& lck)
+{
+	// lck must hold archiveLock
+	if (fid >= cache.size())
+		cache.resize(std::max(size_t(fid + 1), cache.size() * 2));
+
+	// a prefetch job is already inflating this file; wait for its result
+	// rather than inflating it a second time (and under the lock)
+	pendingCond.wait(lck, [&]() { return (!cache[fid].pending); });
+
+	if (!cache[fid].populated) {
+		std::shared_ptr<std::vector<std::uint8_t>> data = std::make_shared<std::vector<std::uint8_t>>();
+
+		cache[fid].exists = GetFileImpl(fid, *data);
+		cache[fid].populated = true;
+		cache[fid].data = std::move(data);
+	}
+
+	exists = cache[fid].exists;
+	return cache[fid].data;
+}
+
 bool CBufferedArchive::GetFile(unsigned int fid, std::vector<std::uint8_t>& buffer)
 {
-	std::lock_guard<spring::mutex> lck(archiveLock);
+	std::unique_lock<spring::mutex> lck(archiveLock);
 	assert(IsFileId(fid));
 
 	if (!caching)
 		return GetFileImpl(fid, buffer);
 
+	bool exists = false;
+	buffer = *GetCachedFile(fid, exists, lck);
+	return exists;
+}
+
+bool CBufferedArchive::GetFileView(unsigned int fid, CFileView& view)
+{
+	std::unique_lock<spring::mutex> lck(archiveLock);
+	assert(IsFileId(fid));
+
+	if (!caching) {
+		std::shared_ptr<std::vector<std::uint8_t>> buffer = std::make_shared<std::vector<std::uint8_t>>();
+
+		if (!GetFileImpl(fid, *buffer))
+			return false;
+
+		view = CFileView(std::move(buffer));
+		return true;
+	}
+
+	bool exists = false;
+	const std::shared_ptr<const std::vector<std::uint8_t>>& data = GetCachedFile(fid, exists, lck);
+
+	if (!exists)
+		return false;
+
+	// no copy; the view keeps the cache entry alive even if the archive is closed
+	view = CFileView(data);
+	return true;
+}
+
+bool CBufferedArchive::PrefetchFile(unsigned int fid)
+{
+	assert(IsFileId(fid));
+
+	if (!caching)
+		return false;
+
+	bool exists = false;
+
+	std::unique_lock<spring::mutex> lck(archiveLock);
+
+	if (!HasReentrantFileImpl()) {
+		GetCachedFile(fid, exists, lck);
+		return exists;
+	}
+
 	if (fid >= cache.size())
 		cache.resize(std::max(size_t(fid + 1), cache.size() * 2));
 
-	if (!cache[fid].populated) {
-		cache[fid].exists = GetFileImpl(fid, cache[fid].data);
-		cache[fid].populated = true;
-	}
+	if (cache[fid].populated)
+		return cache[fid].exists;
+	// being inflated by another prefetch job
+	if (cache[fid].pending)
+		return true;
+
+	// decompress without holding the lock s.t. other files can be read in
+	// parallel; readers of this file block in GetCachedFile until we are
+	// done, so no two GetFileImpl calls ever run for the same file
+	cache[fid].pending = true;
+	lck.unlock();
+
+	std::shared_ptr<std::vector<std::uint8_t>> data = std::make_shared<std::vector<std::uint8_t>>();
+
+	exists = GetFileImpl(fid, *data);
+
+	lck.lock();
+
+	cache[fid].exists = exists;
+	cache[fid].populated = true;
+	cache[fid].pending = false;
+	cache[fid].data = std::move(data);
 
-	buffer = cache[fid].data;
-	return cache[fid].exists;
+	lck.unlock();
+	pendingCond.notify_all();
+	return exists;
 }
@@ -4,6 +4,7 @@
 #define _BUFFERED_ARCHIVE_H
 
 #include <map>
+#include <memory>
 #include "System/Threading/SpringThreading.h"
 
 #include "IArchive.h"
@@ -19,20 +20,30 @@ public:
 	virtual ~CBufferedArchive() {}
 
 	virtual bool GetFile(unsigned int fid, std::vector<std::uint8_t>& buffer);
+	virtual bool GetFileView(unsigned int fid, CFileView& view);
+	virtual bool PrefetchFile(unsigned int fid);
+	virtual bool CanPrefetchConcurrently() const { return (caching && HasReentrantFileImpl()); }
 
 protected:
 	virtual bool GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffer) = 0;
+	/// true if GetFileImpl can run for different files without holding archiveLock
+	virtual bool HasReentrantFileImpl() const { return false; }
+
+	const std::shared_ptr<const std::vector<std::uint8_t>>& GetCachedFile(unsigned int fid, bool& exists, std::unique_lock<spring::mutex>& lck);
 
 	spring::mutex archiveLock; // neither 7zip nor zlib are threadsafe
+	// signalled when a file being prefetched outside archiveLock is cached
+	spring::condition_variable_any pendingCond;
 
 	struct FileBuffer {
-		FileBuffer(): populated(false), exists(false) {}
+		FileBuffer(): populated(false), pending(false), exists(false) {}
 		FileBuffer(const FileBuffer& fb) = delete;
 		FileBuffer(FileBuffer&& fb) { *this = std::move(fb); }
 
 		FileBuffer& operator = (const FileBuffer& fb) = delete;
 		FileBuffer& operator = (FileBuffer&& fb) {
 			populated = fb.populated;
+			pending = fb.pending;
 			exists = fb.exists;
 
 			data = std::move(fb.data);
@@ -40,8 +51,10 @@ protected:
 		}
 
 		bool populated; // files may be empty (0 bytes)
+		bool pending; // being decompressed by PrefetchFile
 		bool exists;
-		std::vector<std::uint8_t> data;
+		// shared with outstanding CFileView's, never modified once populated
+		std::shared_ptr<const std::vector<std::uint8_t>> data;
 	};
 
 	std::vector<FileBuffer> cache; // cache[fileId]
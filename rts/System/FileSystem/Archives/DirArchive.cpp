@@ -8,6 +8,7 @@
 
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/FileView.h"
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/StringUtil.h"
 
@@ -77,6 +78,32 @@ bool CDirArchive::GetFile(unsigned int fid, std::vector<std::uint8_t>& buffer)
 	}
 }
 
+bool CDirArchive::GetFileView(unsigned int fid, CFileView& view)
+{
+	assert(IsFileId(fid));
+
+	const std::string rawpath = dataDirsAccess.LocateFile(dirName + searchFiles[fid]);
+
+	// small files are copied: mapping them saves little, and a mapped file
+	// being truncated (eg. saved by an editor while developing an .sdd) is
+	// fatal (SIGBUS) for any view still referencing it
+	// NOTE:
+	//   large files remain exposed to this while a view into them is being
+	//   read (views are short-lived, and editors that save by writing a new
+	//   file and renaming it over the old one do not affect the mapping)
+	if (FileSystem::GetFileSize(rawpath) < MIN_MAPPED_FILE_SIZE)
+		return IArchive::GetFileView(fid, view);
+
+	const std::shared_ptr<CMemoryMappedFile> file = std::make_shared<CMemoryMappedFile>(rawpath);
+
+	// let the base-class deal with files that can not be mapped
+	if (!file->IsOpen())
+		return IArchive::GetFileView(fid, view);
+
+	view = CFileView(file, 0, file->GetSize());
+	return true;
+}
+
 void CDirArchive::FileInfo(unsigned int fid, std::string& name, int& size) const
 {
 	assert(IsFileId(fid));
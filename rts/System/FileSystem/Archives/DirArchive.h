@@ -36,9 +36,13 @@ public:
 
 	virtual unsigned int NumFiles() const;
 	virtual bool GetFile(unsigned int fid, std::vector<std::uint8_t>& buffer);
+	virtual bool GetFileView(unsigned int fid, CFileView& view);
 	virtual void FileInfo(unsigned int fid, std::string& name, int& size) const;
 
 private:
+	/// files smaller than this are read into memory by GetFileView
+	static constexpr size_t MIN_MAPPED_FILE_SIZE = 1024 * 1024;
+
 	/// "ExampleArchive.sdd/"
 	std::string dirName;
 
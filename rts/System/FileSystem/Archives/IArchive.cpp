@@ -3,6 +3,7 @@
 #include "IArchive.h"
 
 #include "System/CRC.h"
+#include "System/FileSystem/FileView.h"
 #include "System/StringUtil.h"
 
 IArchive::IArchive(const std::string& archiveName)
@@ -42,3 +43,14 @@ bool IArchive::GetFile(const std::string& name, std::vector<std::uint8_t>& buffe
 	return true;
 }
 
+
+bool IArchive::GetFileView(unsigned int fid, CFileView& view)
+{
+	std::shared_ptr<std::vector<std::uint8_t>> buffer = std::make_shared<std::vector<std::uint8_t>>();
+
+	if (!GetFile(fid, *buffer))
+		return false;
+
+	view = CFileView(std::move(buffer));
+	return true;
+}
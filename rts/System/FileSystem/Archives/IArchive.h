@@ -8,6 +8,8 @@
 #include <map>
 #include <cinttypes>
 
+class CFileView;
+
 /**
  * @brief Abstraction of different archive types
  *
@@ -75,6 +77,26 @@ public:
 	 * @see GetFile(unsigned int fid, std::vector<std::uint8_t>& buffer)
 	 */
 	bool GetFile(const std::string& name, std::vector<std::uint8_t>& buffer);
+	/**
+	 * Fetches the content of a file by its ID without copying it, if the
+	 * archive type allows; otherwise the view owns a private copy.
+	 * @param fid file ID in [0, NumFiles())
+	 * @param view on success, this will reference the file contents
+	 * @return true if the file was found and could be read
+	 */
+	virtual bool GetFileView(unsigned int fid, CFileView& view);
+	/**
+	 * Reads (and decompresses) a file into the archive's cache ahead of
+	 * use, so later GetFile / GetFileView calls are served from memory.
+	 * May be called from any thread.
+	 * @return true if the file is (being) cached afterwards
+	 */
+	virtual bool PrefetchFile(unsigned int fid) { return false; }
+	/**
+	 * @return true if PrefetchFile calls for different files may run
+	 *   concurrently, false if they are serialized by the archive
+	 */
+	virtual bool CanPrefetchConcurrently() const { return false; }
 
 	std::pair<std::string, int> FileInfo(unsigned int fid) const {
 		std::pair<std::string, int> info;
@@ -154,6 +154,8 @@ bool CPoolArchive::GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buff
 	gzclose(in);
 
 
+	// CBufferedArchive never runs two GetFileImpl's for the same fid at
+	// once (see PrefetchFile), so no other thread is writing this stat
 	s->readTime = (spring_now() - startTime).toNanoSecsi();
 
 	if (bytesRead != buffer.size()) {
@@ -92,6 +92,8 @@ public:
 
 protected:
 	bool GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffer) override;
+	// every file is a separate .gz in the pool, no shared stream state
+	bool HasReentrantFileImpl() const override { return true; }
 
 	std::pair<uint64_t, uint64_t> GetSums() const {
 		std::pair<uint64_t, uint64_t> p;
@@ -8,6 +8,8 @@
 #include <assert.h>
 
 #include "System/StringUtil.h"
+#include "System/FileSystem/FileView.h"
+#include "System/FileSystem/MemoryMappedFile.h"
 #include "System/Log/ILog.h"
 
 
@@ -128,3 +130,63 @@ bool CZipArchive::GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffe
 
 	return ret;
 }
+
+bool CZipArchive::GetFileView(unsigned int fid, CFileView& view)
+{
+	if (!zip)
+		return false;
+
+	{
+		std::lock_guard<spring::mutex> lck(archiveLock);
+
+		if (GetStoredFileView(fid, view))
+			return true;
+	}
+
+	// deflated entries go through the (shared) decompression cache
+	return CBufferedArchive::GetFileView(fid, view);
+}
+
+// Stored entries are kept verbatim inside the zip, so they can be viewed
+// straight from a mapping of the archive file; note that their CRC is not
+// checked on this path (same as for files in a CDirArchive)
+bool CZipArchive::GetStoredFileView(unsigned int fid, CFileView& view)
+{
+	assert(IsFileId(fid));
+
+	unzGoToFilePos(zip, &fileData[fid].fp);
+
+	unz_file_info fi;
+	unzGetCurrentFileInfo(zip, &fi, nullptr, 0, nullptr, 0, nullptr, 0);
+
+	// method 0 is "stored"; bit 0 of the flags marks encrypted entries
+	if (fi.compression_method != 0 || (fi.flag & 1) != 0)
+		return false;
+	if (fi.uncompressed_size == 0 || fi.compressed_size != fi.uncompressed_size)
+		return false;
+
+	if (unzOpenCurrentFile(zip) != UNZ_OK)
+		return false;
+
+	const ZPOS64_T dataOffset = unzGetCurrentFileZStreamPos64(zip);
+
+	unzCloseCurrentFile(zip);
+
+	// the mapping lives as long as the archive; if the file was changed
+	// on disk in the meantime, reading through it could fault (SIGBUS)
+	// so stop handing out views and let the buffered path handle it
+	if (zipMapping != nullptr && zipMapping->HasChanged()) {
+		LOG_L(L_WARNING, "[ZipArchive::%s] \"%s\" was modified on disk", __func__, GetArchiveName().c_str());
+		zipMapping = std::make_shared<CMemoryMappedFile>();
+	}
+	if (zipMapping == nullptr)
+		zipMapping = std::make_shared<CMemoryMappedFile>(GetArchiveName());
+
+	if (!zipMapping->IsOpen())
+		return false;
+	if ((dataOffset + fi.uncompressed_size) > zipMapping->GetSize())
+		return false;
+
+	view = CFileView(zipMapping, dataOffset, fi.uncompressed_size);
+	return true;
+}
@@ -7,9 +7,12 @@
 #include "BufferedArchive.h"
 #include "minizip/unzip.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
+class CMemoryMappedFile;
+
 
 /**
  * Creates zip compressed, single-file archives.
@@ -38,6 +41,8 @@ public:
 	virtual void FileInfo(unsigned int fid, std::string& name, int& size) const;
 	virtual unsigned int GetCrc32(unsigned int fid);
 
+	virtual bool GetFileView(unsigned int fid, CFileView& view);
+
 protected:
 	unzFile zip;
 
@@ -49,7 +54,11 @@ protected:
 	};
 	std::vector<FileData> fileData;
 
+	/// lazily created on the first view of a stored (uncompressed) entry
+	std::shared_ptr<const CMemoryMappedFile> zipMapping;
+
 	virtual bool GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffer);
+	bool GetStoredFileView(unsigned int fid, CFileView& view);
 };
 
 #endif // _ZIP_ARCHIVE_H
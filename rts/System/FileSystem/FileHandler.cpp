@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <cstring>
 #include <limits.h>
 #include "System/SpringRegex.h"
 
@@ -91,11 +92,8 @@ bool CFileHandler::TryReadFromVFS(const string& fileName, int section)
 	if (vfsHandler == nullptr)
 		return false;
 
-	if (vfsHandler->LoadFile(StringToLower(fileName), fileBuffer, (CVFSHandler::Section) section)) {
-		// capacity can exceed size if FH was used to open more than one file
-		// assert(fileBuffer.size() == fileBuffer.capacity());
-
-		fileSize = fileBuffer.size();
+	if (vfsHandler->LoadFileView(StringToLower(fileName), fileView, (CVFSHandler::Section) section)) {
+		fileSize = fileView.GetSize();
 		return true;
 	}
 #endif
@@ -127,6 +125,7 @@ void CFileHandler::Close()
 	fileSize = -1;
 
 	ifs.close();
+	fileView.Clear();
 	fileBuffer.clear();
 }
 
@@ -171,15 +170,14 @@ int CFileHandler::Read(void* buf, int length)
 		return ifs.gcount();
 	}
 
-	if (fileBuffer.empty())
+	if (!IsBuffered())
 		return 0;
 
 	if ((length + filePos) > fileSize)
 		length = fileSize - filePos;
 
 	if (length > 0) {
-		assert(fileBuffer.size() >= (filePos + length));
-		memcpy(buf, &fileBuffer[filePos], length);
+		memcpy(buf, GetBufferData() + filePos, length);
 		filePos += length;
 	}
 
@@ -213,7 +211,7 @@ void CFileHandler::Seek(int length, std::ios_base::seekdir where)
 		ifs.seekg(length, where);
 		return;
 	}
-	if (fileBuffer.empty())
+	if (!IsBuffered())
 		return;
 
 	switch (where) {
@@ -229,7 +227,7 @@ bool CFileHandler::Eof() const
 	if (ifs.is_open())
 		return ifs.eof();
 
-	if (!fileBuffer.empty())
+	if (IsBuffered())
 		return (filePos >= fileSize);
 
 	return true;
@@ -245,6 +243,17 @@ int CFileHandler::GetPos()
 }
 
 
+std::vector<std::uint8_t>& CFileHandler::GetBuffer()
+{
+	if (!fileView.Empty()) {
+		fileBuffer.assign(fileView.GetData(), fileView.GetData() + fileView.GetSize());
+		fileView.Clear();
+	}
+
+	return fileBuffer;
+}
+
+
 bool CFileHandler::LoadStringData(string& data)
 {
 	if (!FileExists())
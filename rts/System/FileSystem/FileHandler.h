@@ -9,6 +9,7 @@
 #include <fstream>
 #include <cinttypes>
 
+#include "FileView.h"
 #include "VFSModes.h"
 
 /**
@@ -38,7 +39,7 @@ public:
 	// true if any of TryReadFrom{RawFS,PWD,VFS} succeed
 	bool FileExists() const { return (fileSize >= 0); }
 	// true if (and only if) TryReadFromVFS succeeds
-	bool IsBuffered() const { return (!fileBuffer.empty()); }
+	bool IsBuffered() const { return (!fileBuffer.empty() || !fileView.Empty()); }
 
 	bool Eof() const;
 	int GetPos();
@@ -47,7 +48,11 @@ public:
 	bool LoadStringData(std::string& data);
 	std::string GetFileExt() const;
 
-	std::vector<std::uint8_t>& GetBuffer() { return fileBuffer; }
+	// copies the contents if the file is only referenced by a view
+	std::vector<std::uint8_t>& GetBuffer();
+	// zero-copy access to a file loaded from the VFS; empty if the
+	// contents had to be transformed (e.g. by CGZFileHandler)
+	const CFileView& GetFileView() const { return fileView; }
 
 	static bool InReadDir(const std::string& path);
 	static bool InWriteDir(const std::string& path);
@@ -73,8 +78,13 @@ protected:
 	static bool InsertRawDirs(std::set<std::string>& dirSet, const std::string& path, const std::string& pattern);
 	static bool InsertVFSDirs(std::set<std::string>& dirSet, const std::string& path, const std::string& pattern, int section);
 
+	const std::uint8_t* GetBufferData() const { return (fileView.Empty()? fileBuffer.data(): fileView.GetData()); }
+
 	std::string fileName;
 	std::ifstream ifs;
+	// VFS content is referenced through fileView when possible and only
+	// copied into fileBuffer on demand; one of them is empty at any time
+	CFileView fileView;
 	std::vector<std::uint8_t> fileBuffer;
 	int filePos;
 	int fileSize;
@@ -0,0 +1,50 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _FILE_VIEW_H
+#define _FILE_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "MemoryMappedFile.h"
+
+/**
+ * Read-only span over the contents of a VFS file. The storage behind it is
+ * either a memory-mapped file on disk (uncompressed archive content) or an
+ * archive's decompressed cache entry; in both cases the view only holds a
+ * reference, so any number of views can share one copy and the storage is
+ * released when the last of them goes away.
+ */
+class CFileView
+{
+public:
+	CFileView() = default;
+	CFileView(std::shared_ptr<const std::vector<std::uint8_t>> buffer)
+		: owner(buffer)
+		, data(buffer->empty()? nullptr: buffer->data())
+		, size(buffer->size())
+	{}
+	CFileView(std::shared_ptr<const CMemoryMappedFile> file, size_t offset, size_t length)
+		: owner(file)
+		, data(file->GetData() + offset)
+		, size(length)
+	{}
+
+	void Clear() { *this = CFileView(); }
+
+	bool Empty() const { return (size == 0); }
+	bool IsValid() const { return (owner != nullptr); }
+
+	const std::uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	std::shared_ptr<const void> owner;
+
+	const std::uint8_t* data = nullptr;
+	size_t size = 0;
+};
+
+#endif // _FILE_VIEW_H
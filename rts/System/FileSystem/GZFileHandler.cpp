@@ -47,6 +47,14 @@ bool CGZFileHandler::ReadToBuffer(const std::string& path)
 	while (true) {
 		int unzippedBytes = gzread(file, unzipBuffer, BUFFER_SIZE);
 		if (unzippedBytes < 0) {
+			int errnum = Z_OK;
+			gzerror(file, &errnum);
+
+			// unexpected end of file (e.g. a demo whose writer crashed);
+			// keep whatever was sync-flushed before the cut-off
+			if (errnum == Z_BUF_ERROR)
+				break;
+
 			fileBuffer.clear();
 			fileSize = -1;
 			gzclose(file);
@@ -64,8 +72,10 @@ bool CGZFileHandler::ReadToBuffer(const std::string& path)
 
 bool CGZFileHandler::UncompressBuffer()
 {
-	std::vector<std::uint8_t> compressed;
-	std::swap(compressed, fileBuffer);
+	// CFileHandler::TryReadFromVFS only references the compressed data
+	const CFileView compressed = fileView;
+	fileView.Clear();
+	fileBuffer.clear();
 
 
 	z_stream zstream;
@@ -77,8 +87,8 @@ bool CGZFileHandler::UncompressBuffer()
 	//+16 marks it's a gzip header
 	inflateInit2(&zstream, 15 + 16);
 
-	zstream.next_in   = &compressed[0];
-	zstream.avail_in  = compressed.size();
+	zstream.next_in   = const_cast<std::uint8_t*>(compressed.GetData());
+	zstream.avail_in  = compressed.GetSize();
 
 	std::uint8_t unzipBuffer[BUFFER_SIZE];
 
@@ -86,17 +96,29 @@ bool CGZFileHandler::UncompressBuffer()
 		zstream.avail_out = BUFFER_SIZE;
 		zstream.next_out = unzipBuffer;
 		const int ret = inflate(&zstream, Z_NO_FLUSH);
-		if (ret != Z_OK) {
-			fileBuffer.clear();
-			fileSize = -1;
-			return false;
-		}
 
 		const size_t unzippedBytes = BUFFER_SIZE - zstream.avail_out;
 		fileBuffer.insert(fileBuffer.end(), unzipBuffer, unzipBuffer + unzippedBytes);
 
-		if (ret == Z_STREAM_END)
+		if (ret == Z_STREAM_END) {
+			// concatenated gzip members are read as one stream (like gzread)
+			if (zstream.avail_in == 0)
+				break;
+
+			inflateReset(&zstream);
+			continue;
+		}
+
+		// truncated input; keep what could be decompressed
+		if (ret == Z_BUF_ERROR && zstream.avail_in == 0)
 			break;
+
+		if (ret != Z_OK) {
+			inflateEnd(&zstream);
+			fileBuffer.clear();
+			fileSize = -1;
+			return false;
+		}
 	}
 
 	inflateEnd(&zstream);
@@ -0,0 +1,167 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "MemoryMappedFile.h"
+
+#include <utility>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#else
+	#include <windows.h>
+#endif
+
+
+#ifdef _WIN32
+static std::int64_t GetWriteTime(void* fileHandle)
+{
+	FILETIME writeTime;
+
+	if (!GetFileTime(fileHandle, nullptr, nullptr, &writeTime))
+		return -1;
+
+	return ((std::int64_t(writeTime.dwHighDateTime) << 32) | writeTime.dwLowDateTime);
+}
+#endif
+
+
+CMemoryMappedFile& CMemoryMappedFile::operator = (CMemoryMappedFile&& f)
+{
+	if (this == &f)
+		return *this;
+
+	Close();
+
+	std::swap(data, f.data);
+	std::swap(size, f.size);
+
+	#ifdef _WIN32
+	std::swap(fileHandle, f.fileHandle);
+	std::swap(mapHandle, f.mapHandle);
+	#else
+	std::swap(fileDesc, f.fileDesc);
+	#endif
+
+	std::swap(modTime, f.modTime);
+	return *this;
+}
+
+
+bool CMemoryMappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+	#ifndef _WIN32
+	const int fd = open(filePath.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	void* ptr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (ptr == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+
+	// the mapping keeps its own reference to the file, the descriptor
+	// is only held on to for HasChanged
+	data = reinterpret_cast<const std::uint8_t*>(ptr);
+	size = info.st_size;
+
+	fileDesc = fd;
+	modTime = std::int64_t(info.st_mtime);
+
+	#else
+	// allow the file to be edited, renamed or deleted while mapped, as on POSIX
+	fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		fileHandle = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart <= 0) {
+		Close();
+		return false;
+	}
+
+	if ((mapHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr)) == nullptr) {
+		Close();
+		return false;
+	}
+
+	if ((data = reinterpret_cast<const std::uint8_t*>(MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0))) == nullptr) {
+		Close();
+		return false;
+	}
+
+	size = fileSize.QuadPart;
+	modTime = GetWriteTime(fileHandle);
+	#endif
+
+	return true;
+}
+
+bool CMemoryMappedFile::HasChanged() const
+{
+	if (!IsOpen())
+		return false;
+
+	#ifndef _WIN32
+	struct stat info;
+
+	if (fstat(fileDesc, &info) != 0)
+		return true;
+
+	return (size_t(info.st_size) != size || std::int64_t(info.st_mtime) != modTime);
+
+	#else
+	// a mapped file can not be truncated on win32, but its contents
+	// can still be rewritten through FILE_SHARE_WRITE handles
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+		return true;
+
+	return (size_t(fileSize.QuadPart) != size || GetWriteTime(fileHandle) != modTime);
+	#endif
+}
+
+void CMemoryMappedFile::Close()
+{
+	#ifndef _WIN32
+	if (data != nullptr)
+		munmap(const_cast<std::uint8_t*>(data), size);
+	if (fileDesc >= 0)
+		close(fileDesc);
+
+	fileDesc = -1;
+
+	#else
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapHandle != nullptr)
+		CloseHandle(mapHandle);
+	if (fileHandle != nullptr)
+		CloseHandle(fileHandle);
+
+	mapHandle = nullptr;
+	fileHandle = nullptr;
+	#endif
+
+	data = nullptr;
+	size = 0;
+	modTime = 0;
+}
@@ -0,0 +1,56 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _MEMORY_MAPPED_FILE_H
+#define _MEMORY_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Read-only view of a file on the raw filesystem, backed by the OS page
+ * cache (mmap / MapViewOfFile) instead of a private heap copy. Repeated
+ * opens of the same file by concurrent processes share physical memory.
+ */
+class CMemoryMappedFile
+{
+public:
+	CMemoryMappedFile() = default;
+	CMemoryMappedFile(const std::string& filePath) { Open(filePath); }
+	CMemoryMappedFile(const CMemoryMappedFile&) = delete;
+	CMemoryMappedFile(CMemoryMappedFile&& f) { *this = std::move(f); }
+	~CMemoryMappedFile() { Close(); }
+
+	CMemoryMappedFile& operator = (const CMemoryMappedFile&) = delete;
+	CMemoryMappedFile& operator = (CMemoryMappedFile&& f);
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	bool IsOpen() const { return (data != nullptr); }
+	/**
+	 * True if the file was resized or rewritten in place since it was
+	 * mapped. Reading a mapping past the end of a truncated file raises
+	 * SIGBUS on POSIX, so long-lived mappings should be checked before
+	 * new views into them are handed out.
+	 */
+	bool HasChanged() const;
+
+	const std::uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const std::uint8_t* data = nullptr;
+	size_t size = 0;
+
+	#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mapHandle = nullptr;
+	#else
+	int fileDesc = -1;
+	#endif
+
+	std::int64_t modTime = 0;
+};
+
+#endif // _MEMORY_MAPPED_FILE_H
@@ -4,6 +4,7 @@
 #include "VFSHandler.h"
 
 #include <algorithm>
+#include <fstream>
 #include <set>
 #include <cstring>
 
@@ -11,6 +12,9 @@
 #include "System/FileSystem/Archives/IArchive.h"
 #include "FileSystem.h"
 #include "ArchiveScanner.h"
+#include "DataDirsAccess.h"
+#include "FileQueryFlags.h"
+#include "System/Threading/ThreadPool.h"
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
 #include "System/StringUtil.h"
@@ -161,6 +165,8 @@ bool CVFSHandler::RemoveArchive(const std::string& archiveName)
 	if (ar == nullptr)
 		return true;
 
+	WaitForPrefetch();
+
 	// remove the files loaded from the archive-to-remove
 	for (auto f = files[section].begin(); f != files[section].end(); ) {
 		if (f->second.ar == ar) {
@@ -181,6 +187,8 @@ void CVFSHandler::DeleteArchives()
 {
 	LOG_L(L_INFO, "[VFSH::%s]", __func__);
 
+	WaitForPrefetch();
+
 	for (const auto& p: archives) {
 		LOG_L(L_INFO, "\tarchive=%s (%p)", (p.first).c_str(), p.second);
 		delete p.second;
@@ -194,6 +202,167 @@ void CVFSHandler::DeleteArchives()
 }
 
 
+void CVFSHandler::PrefetchFiles(const std::vector<std::string>& filePaths, Section section)
+{
+	assert(section < Section::Count);
+
+	// resolve on the calling thread, the file-maps are not safe to share
+	std::vector< std::pair<IArchive*, std::vector<unsigned int>> > archiveFiles;
+
+	for (const std::string& filePath: filePaths) {
+		const std::string& normalizedPath = GetNormalizedPath(filePath);
+		const FileData* fileData = GetFileData(normalizedPath, section);
+
+		if (fileData == nullptr)
+			continue;
+
+		const unsigned int fid = fileData->ar->FindFile(normalizedPath);
+
+		if (!fileData->ar->IsFileId(fid))
+			continue;
+
+		const auto pred = [&](const std::pair<IArchive*, std::vector<unsigned int>>& p) { return (p.first == fileData->ar); };
+		const auto iter = std::find_if(archiveFiles.begin(), archiveFiles.end(), pred);
+
+		if (iter == archiveFiles.end()) {
+			archiveFiles.emplace_back(fileData->ar, std::vector<unsigned int>{fid});
+		} else {
+			iter->second.push_back(fid);
+		}
+	}
+
+	for (const auto& p: archiveFiles) {
+		IArchive* ar = p.first;
+
+		const std::vector<unsigned int>& fids = p.second;
+
+		// archives that serialize reads get one job walking their files in order,
+		// others are striped over the workers s.t. early files still come first
+		const size_t numJobs = ar->CanPrefetchConcurrently()? std::min(fids.size(), size_t(ThreadPool::GetNumThreads())): 1;
+
+		LOG_L(L_DEBUG, "[VFSH::%s] prefetching %u files from \"%s\" (%u jobs)", __func__, unsigned(fids.size()), ar->GetArchiveName().c_str(), unsigned(numJobs));
+
+		for (size_t j = 0; j < numJobs; j++) {
+			std::vector<unsigned int> jobFids;
+			jobFids.reserve(fids.size() / numJobs + 1);
+
+			for (size_t i = j; i < fids.size(); i += numJobs) {
+				jobFids.push_back(fids[i]);
+			}
+
+			{
+				std::lock_guard<spring::mutex> lck(prefetchMutex);
+				numPrefetchJobs += 1;
+			}
+
+			ThreadPool::Enqueue([this, ar, jobFids]() {
+				for (const unsigned int fid: jobFids) {
+					ar->PrefetchFile(fid);
+				}
+
+				std::lock_guard<spring::mutex> lck(prefetchMutex);
+				numPrefetchJobs -= 1;
+				prefetchCond.notify_all();
+			});
+		}
+	}
+}
+
+void CVFSHandler::WaitForPrefetch()
+{
+	std::unique_lock<spring::mutex> lck(prefetchMutex);
+	prefetchCond.wait(lck, [this]() { return (numPrefetchJobs == 0); });
+}
+
+
+void CVFSHandler::BeginLoadManifest(const std::string& filePath)
+{
+	{
+		std::lock_guard<spring::mutex> lck(manifestMutex);
+
+		manifestPath = filePath;
+		manifestFiles.clear();
+		manifestFileSet.clear();
+	}
+
+	std::ifstream ifs(dataDirsAccess.LocateFile(filePath).c_str());
+
+	if (!ifs.is_open()) {
+		LOG_L(L_INFO, "[VFSH::%s] no load-manifest \"%s\", recording", __func__, filePath.c_str());
+		return;
+	}
+
+	std::array<std::vector<std::string>, Section::Count> sectionFiles;
+	std::string line;
+
+	size_t numFiles = 0;
+
+	// one "<section> <normalized path>" entry per line
+	while (std::getline(ifs, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.size() < 3 || line[1] != ' ')
+			continue;
+
+		const unsigned int section = line[0] - '0';
+
+		if (section >= Section::Count)
+			continue;
+
+		sectionFiles[section].emplace_back(line.substr(2));
+		numFiles += 1;
+	}
+
+	LOG("[VFSH::%s] prefetching %u files listed in \"%s\"", __func__, unsigned(numFiles), filePath.c_str());
+
+	for (unsigned int section = 0; section < Section::Count; section++) {
+		PrefetchFiles(sectionFiles[section], Section(section));
+	}
+}
+
+void CVFSHandler::EndLoadManifest(bool save)
+{
+	std::lock_guard<spring::mutex> lck(manifestMutex);
+
+	if (manifestPath.empty())
+		return;
+
+	if (!save) {
+		manifestPath.clear();
+		manifestFiles.clear();
+		manifestFileSet.clear();
+		return;
+	}
+
+	const std::string filePath = dataDirsAccess.LocateFile(manifestPath, FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+	std::ofstream ofs(filePath.c_str(), std::ios::out | std::ios::trunc);
+
+	for (const auto& p: manifestFiles) {
+		ofs << int(p.first) << ' ' << p.second << '\n';
+	}
+
+	LOG("[VFSH::%s] saved %u entries to load-manifest \"%s\"", __func__, unsigned(manifestFiles.size()), manifestPath.c_str());
+
+	manifestPath.clear();
+	manifestFiles.clear();
+	manifestFileSet.clear();
+}
+
+void CVFSHandler::RecordLoadedFile(const std::string& normalizedFilePath, Section section)
+{
+	std::lock_guard<spring::mutex> lck(manifestMutex);
+
+	if (manifestPath.empty())
+		return;
+
+	if (!manifestFileSet.insert(char('0' + section) + normalizedFilePath).second)
+		return;
+
+	manifestFiles.emplace_back(section, normalizedFilePath);
+}
+
+
 std::string CVFSHandler::GetNormalizedPath(const std::string& rawPath)
 {
 	std::string path = std::move(StringToLower(rawPath));
@@ -234,6 +403,33 @@ bool CVFSHandler::LoadFile(const std::string& filePath, std::vector<std::uint8_t
 		return false;
 	}
 
+	RecordLoadedFile(normalizedPath, section);
+	return true;
+}
+
+
+bool CVFSHandler::LoadFileView(const std::string& filePath, CFileView& view, Section section)
+{
+	assert(section < Section::Count);
+
+	LOG_L(L_DEBUG, "[VFSH::%s(filePath=\"%s\", )]", __func__, filePath.c_str());
+
+	const std::string& normalizedPath = GetNormalizedPath(filePath);
+	const FileData* fileData = GetFileData(normalizedPath, section);
+
+	if (fileData == nullptr) {
+		LOG_L(L_DEBUG, "[VFHS::%s] file \"%s\" does not exist in VFS", __func__, filePath.c_str());
+		return false;
+	}
+
+	const unsigned int fid = fileData->ar->FindFile(normalizedPath);
+
+	if (!fileData->ar->IsFileId(fid) || !fileData->ar->GetFileView(fid, view)) {
+		LOG_L(L_DEBUG, "[VFHS::%s] file \"%s\" does not exist in archive", __func__, filePath.c_str());
+		return false;
+	}
+
+	RecordLoadedFile(normalizedPath, section);
 	return true;
 }
 
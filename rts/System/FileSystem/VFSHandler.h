@@ -9,7 +9,11 @@
 #include <vector>
 #include <cinttypes>
 
+#include "System/UnorderedSet.hpp"
+#include "System/Threading/SpringThreading.h"
+
 class IArchive;
+class CFileView;
 
 /**
  * Main API for accessing the Virtual File System (VFS).
@@ -51,6 +55,15 @@ public:
 	 * @return true if the file exists in the VFS and was successfully read
 	 */
 	bool LoadFile(const std::string& filePath, std::vector<std::uint8_t>& buffer, Section section);
+	/**
+	 * Like LoadFile, but references the contents instead of copying them;
+	 * backed by a memory-mapping for uncompressed archive entries.
+	 * The view remains valid after the archive is removed from the VFS.
+	 * @param filePath raw file path, for example "maps/myMap.smf",
+	 *   case-insensitive
+	 * @return true if the file exists in the VFS and was successfully read
+	 */
+	bool LoadFileView(const std::string& filePath, CFileView& view, Section section);
 
 	/**
 	 * Returns all the files in the given (virtual) directory without the
@@ -89,6 +102,27 @@ public:
 
 	void DeleteArchives();
 
+	/**
+	 * Starts reading (and decompressing) the given files into their archive's
+	 * cache on worker threads, s.t. later LoadFile calls for them do not have
+	 * to wait on zlib. Returns immediately; files not in the VFS are ignored.
+	 * @param filePaths raw file paths, in the order they will be loaded
+	 */
+	void PrefetchFiles(const std::vector<std::string>& filePaths, Section section);
+	/// blocks until all jobs started by PrefetchFiles are done
+	void WaitForPrefetch();
+
+	/**
+	 * Prefetches the files listed in a manifest written by EndLoadManifest
+	 * during an earlier load (if one exists), then records all files read
+	 * from the VFS until EndLoadManifest is called.
+	 * @param manifestPath write-dir relative path of the manifest
+	 */
+	void BeginLoadManifest(const std::string& manifestPath);
+	/// stops recording; if save is true, writes the files loaded since
+	/// BeginLoadManifest (in load order) to the manifest
+	void EndLoadManifest(bool save);
+
 protected:
 	struct FileData {
 		IArchive* ar;
@@ -97,7 +131,21 @@ protected:
 	std::array<std::map<std::string, FileData>, Section::Count> files;
 	std::map<std::string, IArchive*> archives;
 
+	// jobs queued by PrefetchFiles; archives must not be deleted while any
+	// of these are still running
+	spring::mutex prefetchMutex;
+	spring::condition_variable_any prefetchCond;
+	unsigned int numPrefetchJobs = 0;
+
+	// files loaded since BeginLoadManifest, and where to save their names
+	spring::mutex manifestMutex;
+	std::string manifestPath;
+	std::vector<std::pair<Section, std::string>> manifestFiles;
+	spring::unsynced_set<std::string> manifestFileSet;
+
 private:
+	void RecordLoadedFile(const std::string& normalizedFilePath, Section section);
+
 	std::string GetNormalizedPath(const std::string& rawPath);
 	const FileData* GetFileData(const std::string& normalizedFilePath, Section section);
 };
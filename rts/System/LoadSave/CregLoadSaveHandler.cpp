@@ -1,5 +1,10 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
 #include <sstream>
 #include <zlib.h>
 
@@ -111,6 +116,59 @@ static void PrintSize(const char* txt, int size)
 		LOG("%s %u B",    txt, size);
 	}
 }
+
+static std::string CompressBlock(const char* data, size_t size)
+{
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+
+	// windowBits + 16 selects the gzip wrapper
+	if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return "";
+
+	std::string block(deflateBound(&zs, size), 0);
+
+	zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	zs.avail_in = size;
+	zs.next_out = reinterpret_cast<Bytef*>(&block[0]);
+	zs.avail_out = block.size();
+
+	deflate(&zs, Z_FINISH);
+	block.resize(block.size() - zs.avail_out);
+	deflateEnd(&zs);
+	return block;
+}
+
+/**
+ * Compresses the package in blocks, each stored as a separate gzip member
+ * (which gzread and CGZFileHandler read back as a single stream), so the
+ * blocks can be deflated in parallel. Memory use is bounded by compressing
+ * at most numThreads blocks ahead of the one being written.
+ */
+static void WriteCompressed(FILE* file, const std::string& data, int numThreads)
+{
+	constexpr size_t BLOCK_SIZE = 4 * 1024 * 1024;
+
+	const size_t numBlocks = (data.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const size_t maxQueued = std::max(1, numThreads);
+
+	std::deque< std::future<std::string> > blocks;
+
+	for (size_t n = 0; n < numBlocks || !blocks.empty(); ) {
+		while (n < numBlocks && blocks.size() < maxQueued) {
+			const char* blockData = data.data() + n * BLOCK_SIZE;
+			const size_t blockSize = std::min(BLOCK_SIZE, data.size() - n * BLOCK_SIZE);
+
+			blocks.emplace_back(std::async(std::launch::async, CompressBlock, blockData, blockSize));
+			n++;
+		}
+
+		const std::string block = blocks.front().get();
+		blocks.pop_front();
+
+		fwrite(block.data(), block.size(), 1, file);
+	}
+}
 #endif //USING_CREG
 
 static void ReadString(std::istream& s, std::string& str)
@@ -160,7 +218,7 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 		}
 
 		{
-			gzFile file = gzopen(dataDirsAccess.LocateFile(path, FileQueryFlags::WRITE).c_str(), "wb9");
+			FILE* file = fopen(dataDirsAccess.LocateFile(path, FileQueryFlags::WRITE).c_str(), "wb");
 
 			if (file == nullptr) {
 				LOG_L(L_ERROR, "[LSH::%s] could not open save-file", __func__);
@@ -168,15 +226,17 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 			}
 
 			std::string data = std::move(oss.str());
-			std::function<void(gzFile, std::string&&)> func = [](gzFile file, std::string&& data) {
-				gzwrite(file, data.c_str(), data.size());
-				gzflush(file, Z_FINISH);
-				gzclose(file);
+			std::function<void(FILE*, std::string&&, int)> func = [](FILE* file, std::string&& data, int numThreads) {
+				WriteCompressed(file, data, numThreads);
+				fclose(file);
 			};
 
-			// gzFile is just a plain typedef (struct gzFile_s {}* gzFile), can be copied
-			// need to keep a reference to the future around or its destructor will block
-			ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::move(data))));
+			if (!asyncWrite) {
+				func(file, std::move(data), ThreadPool::GetMaxThreads());
+			} else {
+				// need to keep a reference to the future around or its destructor will block
+				ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::move(data), ThreadPool::GetMaxThreads())));
+			}
 		}
 
 		//FIXME add lua state
@@ -0,0 +1,142 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "DemoKeyFrameIndex.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/Log/ILog.h"
+#include "System/SpringFormat.h"
+#include "System/Sync/HsiehHash.h"
+
+
+std::string CDemoKeyFrameIndex::GetKeyFrameDir(const std::string& demoName)
+{
+	return ("demos/keyframes/" + FileSystem::GetBasename(demoName) + "/");
+}
+
+
+void CDemoKeyFrameIndex::Load(const std::string& demoName)
+{
+	keyFrames.clear();
+
+	keyFrameDir = GetKeyFrameDir(demoName);
+	indexName = dataDirsAccess.LocateFile(keyFrameDir + "index.txt", FileQueryFlags::WRITE);
+
+	std::ifstream file(indexName.c_str());
+	std::string line;
+
+	while (std::getline(file, line)) {
+		std::istringstream buf(line);
+		KeyFrame kf;
+
+		// lines written before sizes and checksums were indexed are skipped
+		if (!(buf >> kf.frameNum >> kf.streamPos >> kf.saveSize >> kf.saveChecksum))
+			continue;
+
+		// checksums are only compared before seeking, the size is cheap
+		if (FileSystem::GetFileSize(dataDirsAccess.LocateFile(GetSaveFileName(kf.frameNum))) != kf.saveSize)
+			continue;
+
+		keyFrames.push_back(kf);
+	}
+
+	std::sort(keyFrames.begin(), keyFrames.end());
+
+	if (keyFrames.empty())
+		return;
+
+	LOG("[DemoKeyFrameIndex::%s] loaded %u keyframes for \"%s\"", __func__, unsigned(keyFrames.size()), demoName.c_str());
+}
+
+
+bool CDemoKeyFrameIndex::AddKeyFrame(int frameNum, int streamPos)
+{
+	if (indexName.empty() || HasKeyFrame(frameNum))
+		return false;
+
+	KeyFrame kf = {frameNum, streamPos, 0, 0};
+
+	if (!GetSaveFileInfo(frameNum, kf.saveSize, kf.saveChecksum)) {
+		LOG_L(L_WARNING, "[DemoKeyFrameIndex::%s] could not read snapshot for frame %d", __func__, frameNum);
+		return false;
+	}
+
+	if (!FileSystem::CreateDirectory(keyFrameDir))
+		return false;
+
+	std::ofstream file(indexName.c_str(), std::ios::out | std::ios::app);
+
+	if (!file.good()) {
+		LOG_L(L_WARNING, "[DemoKeyFrameIndex::%s] could not open \"%s\" for writing", __func__, indexName.c_str());
+		return false;
+	}
+
+	file << kf.frameNum << " " << kf.streamPos << " " << kf.saveSize << " " << kf.saveChecksum << "\n";
+
+	keyFrames.insert(std::upper_bound(keyFrames.begin(), keyFrames.end(), kf), kf);
+	return true;
+}
+
+
+const CDemoKeyFrameIndex::KeyFrame* CDemoKeyFrameIndex::GetKeyFrame(int frameNum) const
+{
+	const KeyFrame kf = {frameNum, 0, 0, 0};
+	const auto it = std::lower_bound(keyFrames.begin(), keyFrames.end(), kf);
+
+	if (it == keyFrames.end() || it->frameNum != frameNum)
+		return nullptr;
+
+	return &(*it);
+}
+
+const CDemoKeyFrameIndex::KeyFrame* CDemoKeyFrameIndex::FindKeyFrame(int frameNum) const
+{
+	const KeyFrame kf = {frameNum, 0, 0, 0};
+	const auto it = std::upper_bound(keyFrames.begin(), keyFrames.end(), kf);
+
+	if (it == keyFrames.begin())
+		return nullptr;
+
+	return &(*(it - 1));
+}
+
+
+bool CDemoKeyFrameIndex::CheckKeyFrame(const KeyFrame& kf) const
+{
+	unsigned int size = 0;
+	unsigned int checksum = 0;
+
+	if (!GetSaveFileInfo(kf.frameNum, size, checksum))
+		return false;
+
+	return (size == kf.saveSize && checksum == kf.saveChecksum);
+}
+
+bool CDemoKeyFrameIndex::GetSaveFileInfo(int frameNum, unsigned int& size, unsigned int& checksum) const
+{
+	std::ifstream file(dataDirsAccess.LocateFile(GetSaveFileName(frameNum)).c_str(), std::ios::in | std::ios::binary);
+
+	if (!file.good())
+		return false;
+
+	const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (data.empty())
+		return false;
+
+	size = data.size();
+	checksum = HsiehHash(data.data(), data.size(), 0);
+	return true;
+}
+
+
+std::string CDemoKeyFrameIndex::GetSaveFileName(int frameNum) const
+{
+	return (keyFrameDir + spring::format("frame_%08d.ssf", frameNum));
+}
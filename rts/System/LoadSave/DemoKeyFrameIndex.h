@@ -0,0 +1,69 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef DEMO_KEYFRAME_INDEX_H
+#define DEMO_KEYFRAME_INDEX_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Sidecar index of game-state snapshots taken while playing a demo
+ *
+ * Every keyframe pairs a creg savegame written at the end of a sim-frame
+ * with the position in the demo file of the first packet following that
+ * frame, so playback can be resumed from the snapshot rather than from
+ * the start of the stream. Keyframes are produced by (any) playback and
+ * stored next to each other under demos/keyframes/<demo basename>/.
+ *
+ * The size and checksum of each savegame are indexed along with it, a
+ * keyframe whose file was changed or only partially written is ignored.
+ */
+class CDemoKeyFrameIndex
+{
+public:
+	struct KeyFrame {
+		bool operator < (const KeyFrame& kf) const { return (frameNum < kf.frameNum); }
+
+		int frameNum;
+		int streamPos;
+
+		unsigned int saveSize;
+		unsigned int saveChecksum;
+	};
+
+public:
+	void Load(const std::string& demoName);
+	void Clear() { keyFrames.clear(); indexName.clear(); }
+
+	/**
+	 * @brief appends a keyframe and writes it out to the index-file immediately
+	 * Its savegame has to be complete by now, the keyframe is not added if
+	 * it can not be read.
+	 */
+	bool AddKeyFrame(int frameNum, int streamPos);
+	/// true if the savegame of <kf> is (still) the one that was indexed
+	bool CheckKeyFrame(const KeyFrame& kf) const;
+
+	bool Empty() const { return keyFrames.empty(); }
+	bool HasKeyFrame(int frameNum) const { return (GetKeyFrame(frameNum) != nullptr); }
+
+	const KeyFrame* GetKeyFrame(int frameNum) const;
+	/// @return the last keyframe at or before <frameNum>, or null if none
+	const KeyFrame* FindKeyFrame(int frameNum) const;
+
+	std::string GetSaveFileName(int frameNum) const;
+
+	static std::string GetKeyFrameDir(const std::string& demoName);
+
+private:
+	bool GetSaveFileInfo(int frameNum, unsigned int& size, unsigned int& checksum) const;
+
+private:
+	// sorted by frameNum
+	std::vector<KeyFrame> keyFrames;
+
+	std::string keyFrameDir;
+	std::string indexName;
+};
+
+#endif // DEMO_KEYFRAME_INDEX_H
@@ -43,7 +43,8 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDe
 		) {
 			const std::string demoMsg = std::string("Demofile ") + filename + " corrupt or created by a different version of Spring, expects version " + fileHeader.versionString + ".";
 #ifndef TOOLS
-			if (!configHandler->GetBool("DisableDemoVersionCheck"))
+			// demotool also reads demos without a config
+			if (configHandler != nullptr && !configHandler->GetBool("DisableDemoVersionCheck"))
 				throw std::runtime_error(demoMsg);
 #endif
 			LOG_L(L_WARNING, "%s", demoMsg.c_str());
@@ -55,6 +56,9 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDe
 		setupScript = std::string(&buf[0], fileHeader.scriptSize);
 	}
 
+	streamBeg = fileHeader.headerSize + fileHeader.scriptSize;
+	chunkPos = streamBeg;
+
 	playbackDemo->Read((char*)&chunkHeader, sizeof(chunkHeader));
 	chunkHeader.swab();
 
@@ -65,15 +69,18 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDe
 	playbackDemo->Seek(0, std::ios::end);
 	playbackDemoSize = playbackDemo->GetPos();
 	if (fileHeader.demoStreamSize != 0) {
-		bytesRemaining = fileHeader.demoStreamSize;
+		streamEnd = streamBeg + fileHeader.demoStreamSize;
 	}
 	else {
 		// Spring crashed while recording the demo: replay until EOF,
 		// but at most filesize bytes to block watching demo of running game.
 		// For this we must determine the file size.
 		// (if this had still used CFileHandler that would have been easier ;-))
-		bytesRemaining = playbackDemoSize - curPos;
+		streamEnd = playbackDemoSize;
 	}
+	// the first chunk header is already consumed; do not count it
+	// or the stats following the stream are read as another header
+	bytesRemaining = streamEnd - curPos;
 	playbackDemo->Seek(curPos);
 }
 
@@ -100,6 +107,7 @@ netcode::RawPacket* CDemoReader::GetData(const float readTime)
 			return nullptr;
 		}
 		bytesRemaining -= chunkHeader.length;
+		chunkPos += (sizeof(chunkHeader) + chunkHeader.length);
 
 		if (!ReachedEnd()) {
 			// read next chunk header
@@ -127,6 +135,44 @@ bool CDemoReader::ReachedEnd()
 	return (bytesRemaining <= 0 || playbackDemo->Eof() || (playbackDemo->GetPos() > playbackDemoSize));
 }
 
+int CDemoReader::GetStreamPos() const
+{
+	// the header of the next chunk has usually been consumed already, but
+	// not at the end of the stream (or it was not part of the stream), so
+	// the file position can not be used here
+	return chunkPos;
+}
+
+bool CDemoReader::SeekToStreamPos(int pos, float curTime)
+{
+	if (pos < streamBeg || pos > streamEnd)
+		return false;
+
+	playbackDemo->Seek(pos);
+
+	chunkPos = pos;
+
+	// past the last chunk; nothing more to read
+	if (pos == streamEnd) {
+		bytesRemaining = 0;
+		return true;
+	}
+
+	if ((pos + int(sizeof(chunkHeader))) > streamEnd)
+		return false;
+
+	if (playbackDemo->Read((char*)&chunkHeader, sizeof(chunkHeader)) < sizeof(chunkHeader))
+		return false;
+
+	chunkHeader.swab();
+
+	// same as at construction, but relative to the chunk we resume from
+	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
+	nextDemoReadTime = curTime - 0.01f;
+	bytesRemaining = streamEnd - (pos + sizeof(chunkHeader));
+	return true;
+}
+
 
 void CDemoReader::LoadStats()
 {
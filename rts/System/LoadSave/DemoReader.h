@@ -39,6 +39,17 @@ public:
 	*/
 	bool ReachedEnd();
 
+	/**
+	@brief Position of the next (not yet returned) chunk in the demo file
+	The end of the demo stream once all chunks were returned.
+	*/
+	int GetStreamPos() const;
+	/**
+	@brief Continue reading from a chunk-position obtained via GetStreamPos
+	@return false if pos does not lie within the demo stream (its end is valid)
+	*/
+	bool SeekToStreamPos(int pos, float curTime);
+
 	float GetModGameTime() const { return chunkHeader.modGameTime; }
 	float GetDemoTimeOffset() const { return demoTimeOffset; }
 	float GetNextDemoReadTime() const { return nextDemoReadTime; }
@@ -63,6 +74,11 @@ private:
 	int bytesRemaining;
 	int playbackDemoSize;
 
+	int streamBeg;
+	int streamEnd;
+	/// file position of the chunk whose header is in chunkHeader
+	int chunkPos;
+
 	DemoStreamChunkHeader chunkHeader;
 
 	std::string setupScript;	// the original, unaltered version from script
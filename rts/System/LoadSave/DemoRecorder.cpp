@@ -2,8 +2,11 @@
 
 #include <cassert>
 #include <cerrno>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <memory>
+#include <zlib.h>
 
 #include "DemoRecorder.h"
 #include "Game/GameVersion.h"
@@ -25,16 +28,172 @@
 #undef GetCurrentTime
 #endif
 
-// server and client memory-streams
-static std::unique_ptr<std::stringstream> demoStreams[2] = {nullptr, nullptr};
+// uncompressed bytes per chunk handed to the writer thread
+static constexpr size_t STREAM_CHUNK_SIZE = 256 * 1024;
+// number of chunks that may be queued before SaveToDemo blocks
+static constexpr size_t STREAM_QUEUE_SIZE = 64;
+
+static_assert(sizeof(DemoFileHeader) < 65536, "header must fit into a single stored deflate block");
+
+
+/**
+ * @brief Compresses and appends demo data on its own thread
+ *
+ * The file is a sequence of gzip members (which gzread treats as one
+ * stream): a stored member holding the DemoFileHeader, followed by a
+ * single deflate member for everything else. The body is sync-flushed
+ * after every chunk so a partially written demo remains readable.
+ */
+class CDemoStreamWriter {
+public:
+	CDemoStreamWriter(const std::string& fileName) {
+		memset(&stream, 0, sizeof(stream));
+
+		if ((file = fopen(fileName.c_str(), "wb")) == nullptr) {
+			LOG_L(L_ERROR, "[DemoStreamWriter] could not open \"%s\" for writing (%s)", fileName.c_str(), strerror(errno));
+			return;
+		}
+
+		// windowBits + 16 selects the gzip wrapper
+		if (deflateInit2(&stream, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			fclose(file);
+			file = nullptr;
+		}
+	}
+
+	~CDemoStreamWriter() {
+		assert(file == nullptr);
+	}
+
+	void PushHeader(const DemoFileHeader& header) { PushJob(JOB_HEADER, std::string(reinterpret_cast<const char*>(&header), sizeof(header))); }
+	void PushChunk(std::string&& data) { PushJob(JOB_CHUNK, std::move(data)); }
+	void PushFinish() { PushJob(JOB_FINISH, ""); }
+
+	void Run() {
+		while (true) {
+			Job job;
+
+			{
+				std::unique_lock<spring::mutex> lock(mutex);
+
+				while (jobs.empty())
+					cond.wait(lock);
+
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			// wake up a blocked producer
+			cond.notify_all();
+
+			switch (job.type) {
+				case JOB_HEADER: { WriteHeader(job.data); } break;
+				case JOB_CHUNK : { WriteChunk(job.data, Z_SYNC_FLUSH); } break;
+				case JOB_FINISH: { WriteChunk(job.data, Z_FINISH); Close(); return; } break;
+				default: {} break;
+			}
+		}
+	}
+
+private:
+	enum {
+		JOB_HEADER,
+		JOB_CHUNK,
+		JOB_FINISH,
+	};
+
+	struct Job {
+		int type;
+		std::string data;
+	};
+
+	void PushJob(int type, std::string&& data) {
+		std::unique_lock<spring::mutex> lock(mutex);
+
+		// bound memory usage if the disk can not keep up
+		while (jobs.size() >= STREAM_QUEUE_SIZE)
+			cond.wait(lock);
+
+		jobs.push_back({type, std::move(data)});
+		cond.notify_all();
+	}
+
+	void WriteHeader(const std::string& data) {
+		if (file == nullptr)
+			return;
+
+		// stored-block gzip member; always has the same size so it can be rewritten in place
+		const uint8_t gzHeader[10] = {0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 0xff};
+		const uint16_t len = data.size();
+		const uint8_t blockHeader[5] = {1, uint8_t(len & 0xff), uint8_t(len >> 8), uint8_t(~len & 0xff), uint8_t((~len >> 8) & 0xff)};
+
+		const uint32_t crc = crc32(0, reinterpret_cast<const Bytef*>(data.data()), data.size());
+		const uint8_t gzTrailer[8] = {
+			uint8_t(crc      ), uint8_t(crc >>  8), uint8_t(crc >> 16), uint8_t(crc >> 24),
+			uint8_t(len & 0xff), uint8_t(len >> 8), 0, 0,
+		};
+
+		fseek(file, 0, SEEK_SET);
+		fwrite(gzHeader, sizeof(gzHeader), 1, file);
+		fwrite(blockHeader, sizeof(blockHeader), 1, file);
+		fwrite(data.data(), data.size(), 1, file);
+		fwrite(gzTrailer, sizeof(gzTrailer), 1, file);
+		fseek(file, 0, SEEK_END);
+		fflush(file);
+	}
+
+	void WriteChunk(const std::string& data, int flush) {
+		if (file == nullptr)
+			return;
+
+		unsigned char outBuffer[64 * 1024];
+
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+		stream.avail_in = data.size();
+
+		do {
+			stream.next_out = outBuffer;
+			stream.avail_out = sizeof(outBuffer);
+
+			deflate(&stream, flush);
+			fwrite(outBuffer, sizeof(outBuffer) - stream.avail_out, 1, file);
+		} while (stream.avail_out == 0);
+
+		fflush(file);
+	}
+
+	void Close() {
+		if (file == nullptr)
+			return;
+
+		deflateEnd(&stream);
+		fclose(file);
+
+		file = nullptr;
+	}
+
+private:
+	FILE* file = nullptr;
+	z_stream stream;
+
+	std::deque<Job> jobs;
+
+	spring::mutex mutex;
+	spring::condition_variable_any cond;
+};
+
+
 
 CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modName, bool serverDemo): isServerDemo(serverDemo)
 {
-	SetStream();
 	SetName(mapName, modName);
-	SetFileHeader();
 
-	file = gzopen(demoName.c_str(), "wb9");
+	streamWriter = std::make_shared<CDemoStreamWriter>(demoName);
+	std::shared_ptr<CDemoStreamWriter> writer = streamWriter;
+	streamThread = spring::thread([writer]() { writer->Run(); });
+	streamBuffer.reserve(STREAM_CHUNK_SIZE + 1024);
+
+	SetFileHeader();
 }
 
 CDemoRecorder::~CDemoRecorder()
@@ -47,15 +206,6 @@ CDemoRecorder::~CDemoRecorder()
 	WriteDemoFile();
 }
 
-void CDemoRecorder::SetStream()
-{
-	if (demoStreams[isServerDemo].get() == nullptr)
-		demoStreams[isServerDemo].reset(new std::stringstream(std::ios::binary | std::ios::out));
-
-	demoStreams[isServerDemo]->clear();
-	demoStreams[isServerDemo]->seekp(0);
-}
-
 void CDemoRecorder::SetFileHeader()
 {
 	memset(&fileHeader, 0, sizeof(DemoFileHeader));
@@ -69,35 +219,41 @@ void CDemoRecorder::SetFileHeader()
 	fileHeader.teamStatPeriod = TeamStatistics::statsPeriod;
 	fileHeader.winningAllyTeamsSize = 0;
 
-	demoStreams[isServerDemo]->seekp(WriteFileHeader(false) + sizeof(DemoFileHeader));
+	WriteFileHeader(false);
 }
 
 void CDemoRecorder::WriteDemoFile()
 {
-	// using operator<<(basic_stringbuf*) requires the stream to be opened with std::ios::in
-	// stringbuf::{eback(), egptr(), gptr()} are protected so we cannot access them directly
-	// (plus data is not guaranteed to be stored contiguously) ==> the only clean OO solution
-	// that avoids str()'s copy would be to supply our own stringbuffer backend to demoStream
-	// which is slightly overdoing it
-	//
-	// zlib FAQ claims the lib is thread-safe, "however any library routines that zlib uses and
-	// any application-provided memory allocation routines must also be thread-safe. zlib's gz*
-	// functions use stdio library routines, and most of zlib's functions use the library memory
-	// allocation routines by default" (should be OK)
-	std::string data = std::move(demoStreams[isServerDemo]->str());
-	std::function<void(gzFile, std::string&&)> func = [](gzFile file, std::string&& data) {
-		gzwrite(file, data.c_str(), data.size());
-		gzflush(file, Z_FINISH);
-		gzclose(file);
-	};
+	FlushStream();
+
+	// the writer thread owns the file from here on; hand it off so
+	// shutdown does not stall on compressing and writing the tail
+	streamWriter->PushFinish();
+	streamWriter.reset();
+
+	ThreadPool::AddExtJob(std::move(streamThread));
+}
+
+void CDemoRecorder::WriteToStream(const void* data, size_t size)
+{
+	streamBuffer.append(reinterpret_cast<const char*>(data), size);
+
+	if (streamBuffer.size() < STREAM_CHUNK_SIZE)
+		return;
 
-	#ifndef WIN32
-	// NOTE: can not use ThreadPool for this directly here, workers are already gone
-	// FIXME: does not currently (august 2017) compile on Windows mingw buildbots
-	ThreadPool::AddExtJob(spring::thread(std::move(func), file, std::move(data)));
-	#else
-	ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::move(data))));
-	#endif
+	FlushStream();
+}
+
+void CDemoRecorder::FlushStream()
+{
+	if (streamBuffer.empty())
+		return;
+
+	std::string chunk;
+	chunk.reserve(STREAM_CHUNK_SIZE + 1024);
+	chunk.swap(streamBuffer);
+
+	streamWriter->PushChunk(std::move(chunk));
 }
 
 void CDemoRecorder::WriteSetupText(const std::string& text)
@@ -108,7 +264,9 @@ void CDemoRecorder::WriteSetupText(const std::string& text)
 	}
 
 	fileHeader.scriptSize = length;
-	demoStreams[isServerDemo]->write(text.c_str(), length);
+	WriteToStream(text.c_str(), length);
+	// scriptSize is needed to read back anything that follows
+	WriteFileHeader(false);
 }
 
 void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime)
@@ -118,8 +276,8 @@ void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length,
 	chunkHeader.modGameTime = modGameTime;
 	chunkHeader.length = length;
 	chunkHeader.swab();
-	demoStreams[isServerDemo]->write((char*) &chunkHeader, sizeof(chunkHeader));
-	demoStreams[isServerDemo]->write((char*) buf, length);
+	WriteToStream(&chunkHeader, sizeof(chunkHeader));
+	WriteToStream(buf, length);
 	fileHeader.demoStreamSize += (length + sizeof(chunkHeader));
 }
 
@@ -213,49 +371,31 @@ void CDemoRecorder::SetWinningAllyTeams(const std::vector<unsigned char>& winnin
 }
 
 /** @brief Write DemoFileHeader
-Write the DemoFileHeader at the start of the file and restores the original
-position in the file afterwards. */
-unsigned int CDemoRecorder::WriteFileHeader(bool updateStreamLength)
+Queues a rewrite of the DemoFileHeader at the start of the file; if the
+stream length is not updated the demo is marked as unfinished. */
+void CDemoRecorder::WriteFileHeader(bool updateStreamLength)
 {
-#ifdef _MSC_VER // MSVC8 behaves strange if tell/seek is called before anything has been written
-	const bool empty = (demoStreams[isServerDemo]->str() == "");
-	const unsigned int pos = empty? 0 : demoStreams[isServerDemo]->tellp();
-#else
-	const unsigned int pos = demoStreams[isServerDemo]->tellp();
-#endif
-
 	DemoFileHeader tmpHeader;
 	memcpy(&tmpHeader, &fileHeader, sizeof(fileHeader));
 	if (!updateStreamLength)
 		tmpHeader.demoStreamSize = 0;
 	tmpHeader.swab(); // to little endian
 
-#ifdef _MSC_VER
-	if (!empty)
-#endif
-	{
-		demoStreams[isServerDemo]->seekp(0);
-	}
-
-
-	demoStreams[isServerDemo]->write((char*) &tmpHeader, sizeof(tmpHeader));
-	demoStreams[isServerDemo]->seekp(pos);
-
-	return pos;
+	// keep the header in order with the data it describes
+	FlushStream();
+	streamWriter->PushHeader(tmpHeader);
 }
 
 /** @brief Write the CPlayer::Statistics at the current position in the file. */
 void CDemoRecorder::WritePlayerStats()
 {
-	int pos = demoStreams[isServerDemo]->tellp();
-
 	for (PlayerStatistics& stats: playerStats) {
 		stats.swab();
-		demoStreams[isServerDemo]->write(reinterpret_cast<char*>(&stats), sizeof(PlayerStatistics));
+		WriteToStream(&stats, sizeof(PlayerStatistics));
 	}
 
 	fileHeader.numPlayers = playerStats.size();
-	fileHeader.playerStatSize = (int)demoStreams[isServerDemo]->tellp() - pos;
+	fileHeader.playerStatSize = playerStats.size() * sizeof(PlayerStatistics);
 
 	playerStats.clear();
 }
@@ -268,38 +408,38 @@ void CDemoRecorder::WriteWinnerList()
 	if (fileHeader.numTeams == 0)
 		return;
 
-	const int pos = demoStreams[isServerDemo]->tellp();
-
 	// Write the array of winningAllyTeams.
 	for (std::vector<unsigned char>::const_iterator it = winningAllyTeams.begin(); it != winningAllyTeams.end(); ++it) {
-		demoStreams[isServerDemo]->write((char*) &(*it), sizeof(unsigned char));
+		WriteToStream(&(*it), sizeof(unsigned char));
 	}
 
-	winningAllyTeams.clear();
+	fileHeader.winningAllyTeamsSize = winningAllyTeams.size() * sizeof(unsigned char);
 
-	fileHeader.winningAllyTeamsSize = int(demoStreams[isServerDemo]->tellp()) - pos;
+	winningAllyTeams.clear();
 }
 
 /** @brief Write the TeamStatistics at the current position in the file. */
 void CDemoRecorder::WriteTeamStats()
 {
-	int pos = demoStreams[isServerDemo]->tellp();
+	int size = 0;
 
 	// Write array of dwords indicating number of TeamStatistics per team.
 	for (std::vector<TeamStatistics>& history: teamStats) {
 		unsigned int c = swabDWord(history.size());
-		demoStreams[isServerDemo]->write((char*)&c, sizeof(unsigned int));
+		WriteToStream(&c, sizeof(unsigned int));
+		size += sizeof(unsigned int);
 	}
 
 	// Write big array of TeamStatistics.
 	for (std::vector<TeamStatistics>& history: teamStats) {
 		for (TeamStatistics& stats: history) {
 			stats.swab();
-			demoStreams[isServerDemo]->write(reinterpret_cast<char*>(&stats), sizeof(TeamStatistics));
+			WriteToStream(&stats, sizeof(TeamStatistics));
+			size += sizeof(TeamStatistics);
 		}
 	}
 
-	fileHeader.teamStatSize = (int)demoStreams[isServerDemo]->tellp() - pos;
+	fileHeader.teamStatSize = size;
 
 	teamStats.clear();
 }
@@ -3,17 +3,25 @@
 #ifndef DEMO_RECORDER
 #define DEMO_RECORDER
 
+#include <memory>
+#include <string>
 #include <vector>
-#include <sstream>
-#include <zlib.h>
 
 #include "Demo.h"
 #include "Game/Players/PlayerStatistics.h"
 #include "Sim/Misc/TeamStatistics.h"
+#include "System/Threading/SpringThreading.h"
 
 
+class CDemoStreamWriter;
+
 /**
  * @brief Used to record demos
+ *
+ * Packets are buffered in small chunks which a background thread compresses
+ * and appends to the demo file while the game is running; the header is a
+ * fixed-size stored gzip member at the start of the file that gets patched
+ * in place once the stream and stats sizes are known.
  */
 class CDemoRecorder : public CDemo
 {
@@ -24,7 +32,6 @@ public:
 	void WriteSetupText(const std::string& text);
 	void SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime);
 
-	void SetStream();
 	void SetName(const std::string& mapName, const std::string& modName);
 	const std::string& GetName() const { return demoName; }
 
@@ -38,15 +45,21 @@ public:
 	void SetWinningAllyTeams(const std::vector<unsigned char>& winningAllyTeams);
 
 private:
-	unsigned int WriteFileHeader(bool updateStreamLength);
+	void WriteFileHeader(bool updateStreamLength);
 	void SetFileHeader();
 	void WritePlayerStats();
 	void WriteTeamStats();
 	void WriteWinnerList();
 	void WriteDemoFile();
 
+	void WriteToStream(const void* data, size_t size);
+	void FlushStream();
+
 private:
-	gzFile file;
+	std::shared_ptr<CDemoStreamWriter> streamWriter;
+	spring::thread streamThread;
+	// uncompressed data not yet handed to streamWriter
+	std::string streamBuffer;
 
 	std::vector<PlayerStatistics> playerStats;
 	std::vector< std::vector<TeamStatistics> > teamStats;
@@ -25,6 +25,9 @@ public:
 	std::string scriptText;
 	std::string mapName;
 	std::string modName;
+
+	/// if false, SaveGame only returns once the file is completely written
+	bool asyncWrite = true;
 };
 
 #endif // _LOAD_SAVE_HANDLER_H
@@ -237,7 +237,7 @@ namespace springproc {
 		const auto oldAffinity = Threading::GetAffinity();
 
 		for (int processor = 0; processor < numProcessors; processor++) {
-			Threading::SetAffinity(1u << processor, true);
+			Threading::SetAffinity(std::uint64_t(1) << processor, true);
 			spring::this_thread::yield();
 			processorApicIds[processor] = getApicIdIntel();
 		}
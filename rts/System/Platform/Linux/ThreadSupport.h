@@ -21,6 +21,4 @@ namespace Threading {
 	);
 }
 
-int gettid ();
-
 #endif // THREADSIGNALHANDLER_H
@@ -13,6 +13,7 @@
 #include <process.h>
 #include <shlobj.h>
 #include <shlwapi.h>
+#include <psapi.h>
 
 #ifndef SHGFP_TYPE_CURRENT
 	#define SHGFP_TYPE_CURRENT 0
@@ -39,6 +40,7 @@
 
 
 #if !defined(WIN32)
+#include <sys/resource.h> // for getrusage()
 #include <sys/utsname.h> // for uname()
 #include <sys/types.h> // for getpw
 #include <pwd.h> // for getpw
@@ -409,6 +411,39 @@ namespace Platform
 	}
 
 
+	uint64_t PeakMemoryUsage() {
+		#ifdef WIN32
+		// not linked against psapi, look the kernel32 export up at runtime
+		typedef BOOL (WINAPI *GetProcessMemoryInfoFunc)(HANDLE, PROCESS_MEMORY_COUNTERS*, DWORD);
+
+		const HMODULE k32 = GetModuleHandle("kernel32.dll");
+		const GetProcessMemoryInfoFunc func = (k32 != nullptr)? (GetProcessMemoryInfoFunc) GetProcAddress(k32, "K32GetProcessMemoryInfo"): nullptr;
+
+		PROCESS_MEMORY_COUNTERS pmc;
+
+		if (func == nullptr || !func(GetCurrentProcess(), &pmc, sizeof(pmc)))
+			return 0;
+
+		return (pmc.PeakWorkingSetSize / (1024 * 1024));
+
+		#else
+
+		struct rusage ru;
+
+		if (getrusage(RUSAGE_SELF, &ru) != 0)
+			return 0;
+
+		#ifdef __APPLE__
+		// reported in bytes
+		return (uint64_t(ru.ru_maxrss) / (1024 * 1024));
+		#else
+		// reported in kilobytes
+		return (uint64_t(ru.ru_maxrss) / 1024);
+		#endif
+		#endif
+	}
+
+
 	uint32_t NativeWordSize() { return (sizeof(void*)); }
 	uint32_t SystemWordSize() { return ((Is32BitEmulation())? 8: NativeWordSize()); }
 	uint32_t DequeChunkSize() {
@@ -89,6 +89,7 @@ bool Is32BitEmulation();
 bool IsRunningInGDB();
 
 uint64_t FreeDiskSpace(const std::string& path);
+uint64_t PeakMemoryUsage(); // resident high-water mark of this process, in MB
 uint32_t NativeWordSize(); // compiled process code
 uint32_t SystemWordSize(); // host operating system
 uint32_t DequeChunkSize();
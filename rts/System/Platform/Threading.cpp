@@ -20,6 +20,9 @@
 		#include <sys/prctl.h>
 	#endif
 	#include <sched.h>
+	#include <sys/resource.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
 #endif
 
 #ifndef WIN32
@@ -77,28 +80,28 @@ namespace Threading {
 	#if defined(__APPLE__) || defined(__FreeBSD__)
 	#elif defined(WIN32)
 	#else
-	static std::uint32_t CalcCoreAffinityMask(const cpu_set_t* cpuSet) {
-		std::uint32_t coreMask = 0;
+	static std::uint64_t CalcCoreAffinityMask(const cpu_set_t* cpuSet) {
+		std::uint64_t coreMask = 0;
 
-		// without the min(..., 32), `(1 << n)` could overflow
-		const int numCPUs = std::min(CPU_COUNT(cpuSet), 32);
+		// without the min(..., 64), `(1 << n)` could overflow
+		const int numCPUs = std::min(CPU_COUNT(cpuSet), 64);
 
 		for (int n = numCPUs - 1; n >= 0; --n) {
 			if (CPU_ISSET(n, cpuSet)) {
-				coreMask |= (1 << n);
+				coreMask |= (std::uint64_t(1) << n);
 			}
 		}
 
 		return coreMask;
 	}
 
-	static void SetWantedCoreAffinityMask(const cpu_set_t* cpuSrcSet, cpu_set_t* cpuDstSet, std::uint32_t coreMask) {
+	static void SetWantedCoreAffinityMask(const cpu_set_t* cpuSrcSet, cpu_set_t* cpuDstSet, std::uint64_t coreMask) {
 		CPU_ZERO(cpuDstSet);
 
-		const int numCPUs = std::min(CPU_COUNT(cpuSrcSet), 32);
+		const int numCPUs = std::min(CPU_COUNT(cpuSrcSet), 64);
 
 		for (int n = numCPUs - 1; n >= 0; --n) {
-			if ((coreMask & (1 << n)) != 0) {
+			if ((coreMask & (std::uint64_t(1) << n)) != 0) {
 				CPU_SET(n, cpuDstSet);
 			}
 		}
@@ -109,7 +112,7 @@ namespace Threading {
 
 
 
-	std::uint32_t GetAffinity()
+	std::uint64_t GetAffinity()
 	{
 	#if defined(__APPLE__) || defined(__FreeBSD__)
 		// no-op
@@ -130,7 +133,7 @@ namespace Threading {
 	}
 
 
-	std::uint32_t SetAffinity(std::uint32_t coreMask, bool hard)
+	std::uint64_t SetAffinity(std::uint64_t coreMask, bool hard)
 	{
 		if (coreMask == 0)
 			return (~0);
@@ -154,7 +157,7 @@ namespace Threading {
 		}
 
 		// return final mask
-		return ((static_cast<std::uint32_t>(cpusWanted)) * (result > 0));
+		return ((static_cast<std::uint64_t>(cpusWanted)) * (result > 0));
 	#else
 		cpu_set_t cpusWanted;
 
@@ -169,24 +172,24 @@ namespace Threading {
 	#endif
 	}
 
-	void SetAffinityHelper(const char *threadName, std::uint32_t affinity) {
-		const std::uint32_t cpuMask  = Threading::SetAffinity(affinity);
-		if (cpuMask == ~0u) {
+	void SetAffinityHelper(const char *threadName, std::uint64_t affinity) {
+		const std::uint64_t cpuMask  = Threading::SetAffinity(affinity);
+		if (cpuMask == ~std::uint64_t(0)) {
 			LOG("[Threading] %s thread CPU affinity not set", threadName);
 		}
 		else if (cpuMask != affinity) {
-			LOG("[Threading] %s thread CPU affinity mask set: %d (config is %d)", threadName, cpuMask, affinity);
+			LOG("[Threading] %s thread CPU affinity mask set: %" PRIu64 " (config is %" PRIu64 ")", threadName, cpuMask, affinity);
 		}
 		else if (cpuMask == 0) {
-			LOG_L(L_ERROR, "[Threading] %s thread CPU affinity mask failed: %d", threadName, affinity);
+			LOG_L(L_ERROR, "[Threading] %s thread CPU affinity mask failed: %" PRIu64, threadName, affinity);
 		}
 		else {
-			LOG("[Threading] %s thread CPU affinity mask set: %d", threadName, cpuMask);
+			LOG("[Threading] %s thread CPU affinity mask set: %" PRIu64, threadName, cpuMask);
 		}
 	}
 
 
-	std::uint32_t GetAvailableCoresMask()
+	std::uint64_t GetAvailableCoresMask()
 	{
 	#if defined(__APPLE__) || defined(__FreeBSD__)
 		// no-op
@@ -241,6 +244,20 @@ namespace Threading {
 	#endif
 	}
 
+	void SetBackgroundThreadPriority(bool background)
+	{
+	#if defined(__APPLE__) || defined(__FreeBSD__)
+		// no-op
+
+	#elif defined(WIN32)
+		::SetThreadPriority(::GetCurrentThread(), background? THREAD_PRIORITY_BELOW_NORMAL: THREAD_PRIORITY_NORMAL);
+
+	#else
+		// on Linux niceness is a per-thread attribute when addressed by tid
+		setpriority(PRIO_PROCESS, syscall(SYS_gettid), background? 10: 0);
+	#endif
+	}
+
 
 	NativeThreadHandle GetCurrentThread()
 	{
@@ -73,8 +73,12 @@ static std::vector<void*> workerThreads[2];
 static std::array<bool, ThreadPool::MAX_THREADS> exitFlags;
 static std::array<ThreadStats, ThreadPool::MAX_THREADS> threadStats[2];
 static spring::signal newTasksSignal[2];
+// whether async workers should run at background priority; they start at
+// normal priority (as raising it again later needs privileges on Linux)
+static std::atomic<bool> asyncBackgroundPriority(false);
 
 static _threadlocal int threadnum(0);
+static _threadlocal bool asyncthread(false);
 
 #ifndef UNITSYNC
 // if enabled, allows OpenGL calls from ThreadPool tasks
@@ -93,6 +97,7 @@ std::atomic_uint ITaskGroup::lastId(0);
 namespace ThreadPool {
 
 int GetThreadNum() { return threadnum; }
+bool IsAsyncThread() { return asyncthread; }
 static void SetThreadNum(const int idx) { threadnum = idx; }
 
 
@@ -138,6 +143,64 @@ bool HasThreads() { return !workerThreads[false].empty(); }
 
 
 
+static void ExecuteTask(ITaskGroup* tg, int tid, bool async)
+{
+	assert(!async || tg->IsAsyncTask());
+
+	#ifdef USE_TASK_STATS_TRACKING
+	const uint64_t wdt = tg->GetDeltaTime(spring_now());
+	const uint64_t edt = tg->ExecuteLoop(tid, false);
+
+	threadStats[async][tid].numTasksRun += 1;
+	threadStats[async][tid].sumExecTime += edt;
+	threadStats[async][tid].sumWaitTime += wdt;
+	threadStats[async][tid].minExecTime  = std::min(threadStats[async][tid].minExecTime, edt);
+	threadStats[async][tid].maxExecTime  = std::max(threadStats[async][tid].maxExecTime, edt);
+	threadStats[async][tid].minWaitTime  = std::min(threadStats[async][tid].minWaitTime, wdt);
+	threadStats[async][tid].maxWaitTime  = std::max(threadStats[async][tid].maxWaitTime, wdt);
+	#else
+	tg->ExecuteLoop(tid, false);
+	#endif
+}
+
+static bool StealTask(int tid, bool async)
+{
+	// only Enqueue'd background tasks may migrate between workers; the
+	// per-thread sync queues carry tasks that *must* run on a specific
+	// thread (parallel, per-thread buffers) and for_mt slices are pushed
+	// to every worker already so need no stealing
+	if (!async)
+		return false;
+
+	const int numWorkers = GetNumThreads() - 1;
+
+	ITaskGroup* tg = nullptr;
+
+	// start with our right neighbour so victims are spread evenly
+	for (int n = 1; n < numWorkers; n++) {
+		auto& queue = taskQueues[async][1 + (tid - 1 + n) % numWorkers];
+
+		#ifdef USE_BOOST_LOCKFREE_QUEUE
+		if (!queue.pop(tg))
+			continue;
+		#else
+		if (!queue.try_dequeue(tg))
+			continue;
+		#endif
+
+		// parallel_reduce also pushes AsyncTask's, pinned to one worker each
+		if (!tg->AllowSteal()) {
+			PushTaskGroup(tg);
+			continue;
+		}
+
+		ExecuteTask(tg, tid, async);
+		return true;
+	}
+
+	return false;
+}
+
 static bool DoTask(int tid, bool async)
 {
 	#ifndef UNIT_TEST
@@ -163,22 +226,7 @@ static bool DoTask(int tid, bool async)
 			if (idx == 0)
 				NotifyWorkerThreads(true, async);
 
-			assert(!async || tg->IsAsyncTask());
-
-			#ifdef USE_TASK_STATS_TRACKING
-			const uint64_t wdt = tg->GetDeltaTime(spring_now());
-			const uint64_t edt = tg->ExecuteLoop(tid, false);
-
-			threadStats[async][tid].numTasksRun += 1;
-			threadStats[async][tid].sumExecTime += edt;
-			threadStats[async][tid].sumWaitTime += wdt;
-			threadStats[async][tid].minExecTime  = std::min(threadStats[async][tid].minExecTime, edt);
-			threadStats[async][tid].maxExecTime  = std::max(threadStats[async][tid].maxExecTime, edt);
-			threadStats[async][tid].minWaitTime  = std::min(threadStats[async][tid].minWaitTime, wdt);
-			threadStats[async][tid].maxWaitTime  = std::max(threadStats[async][tid].maxWaitTime, wdt);
-			#else
-			tg->ExecuteLoop(tid, false);
-			#endif
+			ExecuteTask(tg, tid, async);
 		}
 
 		#ifdef USE_BOOST_LOCKFREE_QUEUE
@@ -186,27 +234,16 @@ static bool DoTask(int tid, bool async)
 		#else
 		while (queue.try_dequeue(tg)) {
 		#endif
-			assert(!async || tg->IsAsyncTask());
-
-			#ifdef USE_TASK_STATS_TRACKING
-			const uint64_t wdt = tg->GetDeltaTime(spring_now());
-			const uint64_t edt = tg->ExecuteLoop(tid, false);
-
-			threadStats[async][tid].numTasksRun += 1;
-			threadStats[async][tid].sumExecTime += edt;
-			threadStats[async][tid].sumWaitTime += wdt;
-			threadStats[async][tid].minExecTime  = std::min(threadStats[async][tid].minExecTime, edt);
-			threadStats[async][tid].maxExecTime  = std::max(threadStats[async][tid].maxExecTime, edt);
-			threadStats[async][tid].minWaitTime  = std::min(threadStats[async][tid].minWaitTime, wdt);
-			threadStats[async][tid].maxWaitTime  = std::max(threadStats[async][tid].maxWaitTime, wdt);
-			#else
-			tg->ExecuteLoop(tid, false);
-			#endif
+			ExecuteTask(tg, tid, async);
 		}
 	}
 
 	// if true, queue contained at least one element
-	return (tg != nullptr);
+	if (tg != nullptr)
+		return true;
+
+	// own queues were empty, help out a busier background worker
+	return (tid != 0 && StealTask(tid, async));
 }
 
 
@@ -215,10 +252,13 @@ static void WorkerLoop(int tid, bool async)
 {
 	assert(tid != 0);
 	SetThreadNum(tid);
+	asyncthread = async;
 	#ifndef UNIT_TEST
 	Threading::SetThreadName(IntToString(tid, "worker%i"));
 	#endif
 
+	bool backgroundPriority = false;
+
 	// make first worker spin a while before sleeping/waiting on the thread signal
 	// this increases the chance that at least one worker is awake when a new task
 	// is inserted, which can then take over the job of waking up sleeping workers
@@ -228,6 +268,16 @@ static void WorkerLoop(int tid, bool async)
 	const auto maxSleepTime = spring_time::fromMilliSecs(30);
 
 	while (!exitFlags[tid]) {
+		// background workers yield their cores to frame-critical ones
+		// except while loading (see SetAsyncBackgroundPriority)
+		if (async && backgroundPriority != asyncBackgroundPriority.load(std::memory_order_relaxed)) {
+			#ifndef UNIT_TEST
+			Threading::SetBackgroundThreadPriority(backgroundPriority = !backgroundPriority);
+			#else
+			backgroundPriority = !backgroundPriority;
+			#endif
+		}
+
 		const auto spinlockEnd = spring_now() + ourSpinTime;
 		      auto sleepTime   = spring_time::fromMicroSecs(1);
 
@@ -334,6 +384,13 @@ void PushTaskGroup(ITaskGroup* taskGroup)
 	#endif
 }
 
+void SetAsyncBackgroundPriority(bool background)
+{
+	asyncBackgroundPriority.store(background);
+	// idle workers apply the change when they next wake up
+	NotifyWorkerThreads(true, true);
+}
+
 void NotifyWorkerThreads(bool force, bool async)
 {
 	// OPTIMIZATION
@@ -422,11 +479,11 @@ static void KillThreads(int wantedNumThreads, int curNumThreads)
 }
 
 
-static std::uint32_t FindWorkerThreadCore(std::int32_t index, std::uint32_t availCores, std::uint32_t avoidCores)
+static std::uint64_t FindWorkerThreadCore(std::int32_t index, std::uint64_t availCores, std::uint64_t avoidCores)
 {
 	// find an unused core for worker-thread <index>
-	const auto FindCore = [&index](std::uint32_t targetCores) {
-		std::uint32_t workerCore = 1;
+	const auto FindCore = [&index](std::uint64_t targetCores) {
+		std::uint64_t workerCore = 1;
 		std::int32_t n = index;
 
 		while ((workerCore != 0) && !(workerCore & targetCores))
@@ -442,8 +499,8 @@ static std::uint32_t FindWorkerThreadCore(std::int32_t index, std::uint32_t avai
 		return workerCore;
 	};
 
-	const std::uint32_t threadAvailCore = FindCore(availCores);
-	const std::uint32_t threadAvoidCore = FindCore(avoidCores);
+	const std::uint64_t threadAvailCore = FindCore(availCores);
+	const std::uint64_t threadAvoidCore = FindCore(avoidCores);
 
 	if (threadAvailCore != 0)
 		return threadAvailCore;
@@ -452,7 +509,7 @@ static std::uint32_t FindWorkerThreadCore(std::int32_t index, std::uint32_t avai
 		return threadAvoidCore;
 
 	// fallback; use all
-	return (~0u);
+	return (~std::uint64_t(0));
 }
 
 
@@ -573,37 +630,37 @@ void SetMaximumThreadCount()
 
 void SetDefaultThreadCount()
 {
-	std::uint32_t systemCores  = Threading::GetAvailableCoresMask();
-	std::uint32_t mainAffinity = systemCores;
+	std::uint64_t systemCores  = Threading::GetAvailableCoresMask();
+	std::uint64_t mainAffinity = systemCores;
 
 	#ifndef UNIT_TEST
 	mainAffinity &= configHandler->GetUnsigned("SetCoreAffinity");
 	#endif
 
-	std::uint32_t workerAvailCores = systemCores & ~mainAffinity;
+	std::uint64_t workerAvailCores = systemCores & ~mainAffinity;
 
 	SetThreadCount(GetDefaultNumWorkers());
 
 	{
 		// parallel_reduce now folds over shared_ptrs to futures
-		// const auto ReduceFunc = [](std::uint32_t a, std::future<std::uint32_t>& b) -> std::uint32_t { return (a | b.get()); };
-		const auto ReduceFunc = [](std::uint32_t a, std::shared_ptr< std::future<std::uint32_t> >& b) -> std::uint32_t { return (a | (b.get())->get()); };
-		const auto AffinityFunc = [&]() -> std::uint32_t {
+		// const auto ReduceFunc = [](std::uint64_t a, std::future<std::uint64_t>& b) -> std::uint64_t { return (a | b.get()); };
+		const auto ReduceFunc = [](std::uint64_t a, std::shared_ptr< std::future<std::uint64_t> >& b) -> std::uint64_t { return (a | (b.get())->get()); };
+		const auto AffinityFunc = [&]() -> std::uint64_t {
 			const int i = ThreadPool::GetThreadNum();
 
 			// 0 is the source thread, skip
 			if (i == 0)
 				return 0;
 
-			const std::uint32_t workerCore = FindWorkerThreadCore(i - 1, workerAvailCores, mainAffinity);
-			// const std::uint32_t workerCore = workerAvailCores;
+			const std::uint64_t workerCore = FindWorkerThreadCore(i - 1, workerAvailCores, mainAffinity);
+			// const std::uint64_t workerCore = workerAvailCores;
 
 			Threading::SetAffinity(workerCore);
 			return workerCore;
 		};
 
-		const std::uint32_t poolCoreAffinity = parallel_reduce(AffinityFunc, ReduceFunc);
-		const std::uint32_t mainCoreAffinity = ~poolCoreAffinity;
+		const std::uint64_t poolCoreAffinity = parallel_reduce(AffinityFunc, ReduceFunc);
+		const std::uint64_t mainCoreAffinity = ~poolCoreAffinity;
 
 		if (mainAffinity == 0)
 			mainAffinity = systemCores;
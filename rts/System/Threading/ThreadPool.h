@@ -5,6 +5,8 @@
 
 #ifndef THREADPOOL
 #include  <functional>
+#include  <future>
+#include  <memory>
 #include "System/Threading/SpringThreading.h"
 
 namespace ThreadPool {
@@ -14,6 +16,26 @@ namespace ThreadPool {
 		f(args ...);
 	}
 
+	// same signature as the threaded version, both tasks run immediately
+	template<class F, class C>
+	static inline auto EnqueueThen(F&& f, C&& c)
+	-> std::shared_ptr<std::future<typename std::result_of<C(std::shared_ptr<std::future<typename std::result_of<F()>::type>>)>::type>>
+	{
+		typedef typename std::result_of<F()>::type antecedent_type;
+		typedef std::shared_ptr<std::future<antecedent_type>> antecedent_future;
+		typedef typename std::result_of<C(antecedent_future)>::type return_type;
+
+		std::packaged_task<antecedent_type()> task(std::forward<F>(f));
+		std::packaged_task<return_type(antecedent_future)> cont(std::forward<C>(c));
+
+		antecedent_future antecedent = std::make_shared<std::future<antecedent_type>>(task.get_future());
+		std::shared_ptr<std::future<return_type>> fut = std::make_shared<std::future<return_type>>(cont.get_future());
+
+		task();
+		cont(antecedent);
+		return fut;
+	}
+
 	static inline void AddExtJob(spring::thread&& t) { t.join(); }
 	static inline void AddExtJob(std::future<void>&& f) { f.get(); }
 	static inline void ClearExtJobs() {}
@@ -22,9 +44,11 @@ namespace ThreadPool {
 	static inline void SetDefaultThreadCount() {}
 	static inline void SetThreadCount(int num) {}
 	static inline int GetThreadNum() { return 0; }
+	static inline bool IsAsyncThread() { return false; }
 	static inline int GetMaxThreads() { return 1; }
 	static inline int GetNumThreads() { return 1; }
 	static inline void NotifyWorkerThreads(bool force, bool async) {}
+	static inline void SetAsyncBackgroundPriority(bool background) {}
 	static inline bool HasThreads() { return false; }
 
 	static constexpr int MAX_THREADS = 1;
@@ -102,12 +126,18 @@ namespace ThreadPool {
 	void SetDefaultThreadCount();
 	void SetThreadCount(int num);
 	int GetThreadNum();
+	/// async and sync workers share thread numbers, this tells them apart
+	bool IsAsyncThread();
 	bool HasThreads();
 	int GetMaxThreads();
 	int GetNumThreads();
 	void NotifyWorkerThreads(bool force, bool async);
+	/// lowers (or restores) the OS priority of the async workers, which run
+	/// at normal priority until this is first called with background=true
+	void SetAsyncBackgroundPriority(bool background);
 
-	static constexpr int MAX_THREADS = 16;
+	// NOTE: worker affinity masks are 64 bits wide, matching this limit
+	static constexpr int MAX_THREADS = 64;
 }
 
 
@@ -126,6 +156,7 @@ public:
 
 	virtual bool IsAsyncTask() const { return false; }
 	virtual bool IsSliceTask() const { return false; }
+	virtual bool AllowSteal() const { return false; }
 	virtual bool ExecuteStep() = 0;
 	virtual bool SelfDelete() const { return false; }
 
@@ -220,7 +251,7 @@ class AsyncTask: public ITaskGroup
 public:
 	typedef  typename std::result_of<F(Args...)>::type  return_type;
 
-	AsyncTask(F f, Args... args) : selfDelete(true) {
+	AsyncTask(F f, Args... args) : selfDelete(true), allowSteal(false) {
 		task = std::make_shared<std::packaged_task<return_type()>>(std::bind(f, std::forward<Args>(args)...));
 		result = std::make_shared<std::future<return_type>>(task->get_future());
 
@@ -229,6 +260,7 @@ public:
 
 	bool IsAsyncTask() const override { return true; }
 	bool SelfDelete() const override { return (selfDelete.load()); }
+	bool AllowSteal() const override { return allowSteal; }
 	bool ExecuteStep() override {
 		// note: *never* called from WaitForFinished
 		(*task)();
@@ -242,6 +274,8 @@ public:
 public:
 	// if true, we are not managed by a shared_ptr
 	std::atomic<bool> selfDelete;
+	// if true, any idle async worker may run us (not just wantedThread)
+	bool allowSteal;
 
 	std::shared_ptr<std::packaged_task<return_type()>> task;
 	std::shared_ptr<std::future<return_type>> result;
@@ -814,11 +848,39 @@ namespace ThreadPool {
 		// minor hack: assume AsyncTask's will cause (heavy) disk IO
 		// although these can never block the main thread, the async
 		// workers might still be handed an uneven work distribution
+		// (idle ones steal from the others) and run at background
+		// priority so they never compete with frame-critical tasks
 		task->wantedThread.store(1 + task->GetId() % (ThreadPool::GetNumThreads() - 1));
+		task->allowSteal = true;
 
 		ThreadPool::PushTaskGroup(task);
 		return fut;
 	}
+
+
+	// runs <f> as an async task, then queues <c> as a task of its own that
+	// receives <f>'s (ready) future; no worker ever blocks waiting for <f>
+	template<class F, class C>
+	static inline auto EnqueueThen(F&& f, C&& c)
+	-> std::shared_ptr<std::future<typename std::result_of<C(std::shared_ptr<std::future<typename std::result_of<F()>::type>>)>::type>>
+	{
+		typedef typename std::result_of<F()>::type antecedent_type;
+		typedef std::shared_ptr<std::future<antecedent_type>> antecedent_future;
+		typedef typename std::result_of<C(antecedent_future)>::type return_type;
+
+		auto task = std::make_shared<std::packaged_task<antecedent_type()>>(std::forward<F>(f));
+		auto cont = std::make_shared<std::packaged_task<return_type(antecedent_future)>>(std::forward<C>(c));
+		auto fut = std::make_shared<std::future<return_type>>(cont->get_future());
+
+		Enqueue([task, cont]() {
+			antecedent_future antecedent = std::make_shared<std::future<antecedent_type>>(task->get_future());
+
+			(*task)();
+			Enqueue([cont, antecedent]() { (*cont)(antecedent); });
+		});
+
+		return fut;
+	}
 }
 
 #endif
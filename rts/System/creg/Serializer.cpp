@@ -18,7 +18,6 @@
 #include <fstream>
 #include <assert.h>
 #include <stdexcept>
-#include <map>
 #include <vector>
 #include <string>
 #include <string.h>
@@ -26,7 +25,6 @@
 
 using namespace creg;
 using std::string;
-using std::map;
 using std::vector;
 
 LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_CREG_SERIALIZER)
@@ -88,11 +86,17 @@ static void WriteZStr(std::ostream& file, const std::string& str)
 template<typename T>
 void ReadVarSizeUInt(std::istream* stream, T* buf)
 {
+	// bypass the (per-call sentry) istream interface
+	std::streambuf* sbuf = stream->rdbuf();
 	std::uint64_t val = 0;
 	unsigned offset = 0;
 	while (true) {
-		unsigned char a;
-		stream->read((char*)&a, sizeof(char));
+		const int a = sbuf->sbumpc();
+
+		if (a == std::char_traits<char>::eof()) {
+			stream->setstate(std::ios::eofbit | std::ios::failbit);
+			break;
+		}
 
 		val += ((std::uint64_t)(a & 0x7F)) << offset;
 		if ((a & 0x80) == 0)
@@ -108,6 +112,10 @@ void ReadVarSizeUInt(std::istream* stream, T* buf)
 template<typename T>
 void WriteVarSizeUInt(std::ostream* stream, T val)
 {
+	// at most ceil(64 / 7) bytes, written at once
+	char buf[10];
+	unsigned len = 0;
+
 	std::uint64_t v = val;
 	do {
 		unsigned char a = v & 0x7F;
@@ -116,10 +124,15 @@ void WriteVarSizeUInt(std::ostream* stream, T val)
 		if (v > 0)
 			a |= 0x80;
 
-		stream->write((char*)&a, sizeof(char));
+		buf[len++] = a;
 	} while (v > 0);
+
+	stream->rdbuf()->sputn(buf, len);
 }
 
+// object count of the previous package, used to size the tables of the next
+static size_t numPrevPackageObjects = 0;
+
 //-------------------------------------------------------------------------
 // Base output serializer
 //-------------------------------------------------------------------------
@@ -135,59 +148,56 @@ bool COutputStreamSerializer::IsWriting()
 
 COutputStreamSerializer::ObjectRef* COutputStreamSerializer::FindObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
 {
-	std::vector<ObjectRef*>* refs = &(ptrToId[inst]);
-	for (std::vector<ObjectRef*>::iterator i = refs->begin(); i != refs->end(); ++i) {
-		if ((*i)->isThisObject(inst, objClass, isEmbedded))
-			return *i;
+	const auto it = ptrToId.find(inst);
+
+	if (it == ptrToId.end())
+		return nullptr;
+
+	for (ObjectRef* ref = it->second; ref != nullptr; ref = ref->nextRef) {
+		if (ref->isThisObject(inst, objClass, isEmbedded))
+			return ref;
 	}
+
 	return nullptr;
 }
 
+COutputStreamSerializer::ObjectRef* COutputStreamSerializer::AddObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
+{
+	objects.emplace_back(inst, objects.size(), isEmbedded, objClass);
+
+	ObjectRef* obj = &objects.back();
+	ObjectRef*& ref = ptrToId[inst];
+
+	obj->nextRef = ref;
+	ref = obj;
+	return obj;
+}
+
 void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* objr)
 {
-	const unsigned objstart = stream->tellp();
+	// stream positions are only needed for the statistics
+	const bool logSizes = LOG_IS_ENABLED(L_DEBUG);
+	const unsigned objstart = logSizes? unsigned(stream->tellp()): 0u;
 
 	if (c->base())
 		SerializeObject(c->base(), ptr, objr);
 
-	ObjectMemberGroup omg;
-	omg.membersClass = c;
-	omg.size = 0;
-
 	for (uint a = 0; a < c->members.size(); a++)
 	{
 		creg::Class::Member* m = &c->members[a];
 		if (m->flags & CM_NoSerialize)
 			continue;
 
-		ObjectMember om;
-		om.member = m;
-		om.memberId = a;
 		void* memberAddr = ((char*)ptr) + m->offset;
-		unsigned mstart = stream->tellp();
 		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s", c->name, m->name, m->type->GetName().c_str());
 		m->type->Serialize(this, memberAddr);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
-		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s size:%d", c->name, m->name, m->type->GetName().c_str(), om.size);
 	}
 
-
-	if (c->HasSerialize()) {
-		ObjectMember om;
-		om.member = nullptr;
-		om.memberId = -1;
-		unsigned mstart = stream->tellp();
+	if (c->HasSerialize())
 		c->CallSerializeProc(ptr, this);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
-	}
 
-	objr->memberGroups.push_back(omg);
+	if (!logSizes)
+		return;
 
 	const unsigned objend = stream->tellp();
 	const int sz = objend - objstart;
@@ -200,18 +210,14 @@ void COutputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* o
 	// register the object, and mark it as embedded if a pointer was already referencing it
 	ObjectRef* obj = FindObjectRef(inst, objClass, true);
 	if (!obj) {
-		objects.emplace_back(inst, objects.size(), true, objClass);
-		obj = &objects.back();
-		ptrToId[inst].push_back(obj);
+		obj = AddObjectRef(inst, objClass, true);
 	} else if (obj->isEmbedded) {
 		throw std::string("Reserialization of embedded object (") + objClass->name + ")";
+	} else if (!obj->isPending) {
+		throw std::string("Object pointer was serialized (") + objClass->name + ")";
 	} else {
-		std::vector<ObjectRef*>::iterator it = std::find(pendingObjects.begin(), pendingObjects.end(), obj);
-		if (it == pendingObjects.end()) {
-			throw std::string("Object pointer was serialized (") + objClass->name + ")";
-		} else {
-			pendingObjects.erase(it);
-		}
+		// stays in pendingObjects, but will be skipped there
+		obj->isPending = false;
 	}
 	obj->class_ = objClass;
 	obj->isEmbedded = true;
@@ -230,9 +236,8 @@ void COutputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* objCla
 		int id;
 		ObjectRef* obj = FindObjectRef(*ptr, objClass, false);
 		if (!obj) {
-			objects.push_back(ObjectRef(*ptr, objects.size(), false, objClass));
-			obj = &objects.back();
-			ptrToId[*ptr].push_back(obj);
+			obj = AddObjectRef(*ptr, objClass, false);
+			obj->isPending = true;
 			pendingObjects.push_back(obj);
 		}
 		id = obj->id;
@@ -246,7 +251,7 @@ void COutputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* objCla
 
 void COutputStreamSerializer::Serialize(void* data, int byteSize)
 {
-	stream->write((char*)data, byteSize);
+	stream->rdbuf()->sputn((char*)data, byteSize);
 }
 
 void COutputStreamSerializer::SerializeInt(void* data, int byteSize)
@@ -284,52 +289,47 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	stream->seekp(startOffset + sizeof(PackageHeader));
 	ph.objDataOffset = (int)stream->tellp();
 
+	// size the tables for a state similar to the last one saved
+	ptrToId.reserve(numPrevPackageObjects);
+	pendingObjects.reserve(numPrevPackageObjects / 2);
+
 	// Insert dummy object with id 0
-	objects.push_back(ObjectRef(0, 0, true, 0));
-	ObjectRef* obj = &objects.back();
-	obj->classIndex = 0;
+	objects.emplace_back(nullptr, 0, true, nullptr);
 
 	// Insert the first object that will provide references to everything
-	objects.push_back(ObjectRef(rootObj, objects.size(), false, rootObjClass));
-	obj = &objects.back();
-	ptrToId[rootObj].push_back(obj);
+	ObjectRef* obj = AddObjectRef(rootObj, rootObjClass, false);
+	obj->isPending = true;
 	pendingObjects.push_back(obj);
 
-	// Save until all the referenced objects have been stored
-	while (!pendingObjects.empty())
-	{
-		const std::vector<ObjectRef*> po = pendingObjects;
-		pendingObjects.clear();
-
-		for (std::vector<ObjectRef*>::const_iterator i = po.begin(); i != po.end(); ++i)
-		{
-			ObjectRef* obj = *i;
-			SerializeObject(obj->class_, obj->ptr, obj);
-			//LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s size:%i", obj->class_->name.c_str(), sz);
-		}
+	// Save until all the referenced objects have been stored; new
+	// ones are appended while iterating so index instead of using
+	// iterators, and skip those meanwhile saved as embedded objects
+	for (size_t i = 0; i < pendingObjects.size(); i++) {
+		obj = pendingObjects[i];
+
+		if (!obj->isPending)
+			continue;
+
+		obj->isPending = false;
+		SerializeObject(obj->class_, obj->ptr, obj);
 	}
 
 	// Collect a set of all used classes
-	std::map<creg::Class*, ClassRef> classMap;
-	std::vector<ClassRef*> classRefs;
+	spring::unsynced_map<creg::Class*, int> classMap;
+	std::vector<ClassRef> classRefs;
 	for (ObjectRef& oRef: objects) {
 		if (oRef.ptr == nullptr)
 			continue;
 
-		creg::Class* c = oRef.class_;
-		while (c) {
-			std::map<creg::Class*, ClassRef>::iterator cr = classMap.find(c);
-			if (cr == classMap.end()) {
-				ClassRef* pRef = &classMap[c];
-				pRef->index = classRefs.size();
-				pRef->class_ = c;
-				classRefs.push_back(pRef);
-			}
-			c = c->base();
+		for (creg::Class* c = oRef.class_; c != nullptr; c = c->base()) {
+			if (classMap.find(c) != classMap.end())
+				break;
+
+			classMap[c] = classRefs.size();
+			classRefs.push_back({int(classRefs.size()), c});
 		}
 
-		std::map<creg::Class*, ClassRef>::iterator cr = classMap.find(oRef.class_);
-		oRef.classIndex = cr->second.index;
+		oRef.classIndex = classMap[oRef.class_];
 	}
 
 
@@ -347,7 +347,7 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	ph.numObjClassRefs = classRefs.size();
 	ph.objClassRefOffset = (int)stream->tellp();
 	for (uint a = 0; a < classRefs.size(); a++) {
-		creg::Class* c =  classRefs[a]->class_;
+		creg::Class* c =  classRefs[a].class_;
 		WriteZStr(*stream, c->name);
 	};
 
@@ -358,7 +358,7 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 		int classRefIndex = oRef.classIndex;
 		char isEmbedded = oRef.isEmbedded ? 1 : 0;
 		WriteVarSizeUInt(stream, classRefIndex);
-		stream->write((char*)&isEmbedded, sizeof(char));
+		stream->rdbuf()->sputc(isEmbedded);
 		if (!isEmbedded && oRef.class_ != nullptr && oRef.class_->HasGetSize())
 			WriteVarSizeUInt(stream, oRef.class_->CallGetSizeProc(oRef.ptr));
 	}
@@ -367,7 +367,7 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	ph.metadataChecksum = 0;
 	for (uint a = 0; a < classRefs.size(); a++)
 	{
-		Class* c = classRefs[a]->class_;
+		Class* c = classRefs[a].class_;
 		c->CalculateChecksum(ph.metadataChecksum);
 	}
 
@@ -382,6 +382,7 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 			ph.metadataChecksum, int(objects.size()), int(classRefs.size()));
 
 	stream->seekp(endOffset);
+	numPrevPackageObjects = objects.size();
 	ptrToId.clear();
 	pendingObjects.clear();
 	objects.clear();
@@ -421,10 +422,9 @@ void CInputStreamSerializer::SerializeObject(Class* c, void* ptr)
 		if (m->flags & CM_NoSerialize)
 			continue;
 
-		const unsigned oldPos = stream->tellg();
 		void* memberAddr = ((char*)ptr) + m->offset;
 		m->type->Serialize(this, memberAddr);
-		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Deserialized %s::%s type:%s size:%u", c->name, m->name, m->type->GetName().c_str(), unsigned(stream->tellg()) - oldPos);
+		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Deserialized %s::%s type:%s", c->name, m->name, m->type->GetName().c_str());
 	}
 
 	if (c->HasSerialize()) {
@@ -434,7 +434,8 @@ void CInputStreamSerializer::SerializeObject(Class* c, void* ptr)
 
 void CInputStreamSerializer::Serialize(void* data, int byteSize)
 {
-	stream->read((char*)data, byteSize);
+	if (stream->rdbuf()->sgetn((char*)data, byteSize) < byteSize)
+		stream->setstate(std::ios::eofbit | std::ios::failbit);
 }
 
 void CInputStreamSerializer::SerializeInt(void* data, int byteSize)
@@ -8,11 +8,12 @@
 
 #ifdef USING_CREG
 
-#include <map>
 #include <vector>
 #include <deque>
 #include <istream>
 
+#include "System/UnorderedMap.hpp"
+
 namespace creg {
 
 	/**
@@ -23,43 +24,25 @@ namespace creg {
 	class COutputStreamSerializer : public ISerializer
 	{
 	protected:
-		struct ObjectMember {
-			Class::Member* member;
-			int memberId;
-			int size;
-		};
-		struct ObjectMemberGroup {
-			Class* membersClass;
-			std::vector<COutputStreamSerializer::ObjectMember> members;
-			int size;
-		};
 		struct ObjectRef {
-			ObjectRef() {
-				ptr = 0;
-				id=0;
-				classIndex=0;
-				isEmbedded=false;
-				class_=0;
-			}
 			ObjectRef(void* ptr, int id, bool isEmbedded, Class* class_) {
 				this->ptr = ptr;
-				this->id=id;
-				classIndex=0;
-				this->isEmbedded=isEmbedded;
-				this->class_=class_;
-			}
-			ObjectRef(const ObjectRef&src) :memberGroups(src.memberGroups){
-				ptr=src.ptr;
-				id=src.id;
-				classIndex=src.classIndex;
-				isEmbedded=src.isEmbedded;
-				class_=src.class_;
+				this->id = id;
+				this->classIndex = 0;
+				this->isEmbedded = isEmbedded;
+				this->isPending = false;
+				this->class_ = class_;
+				this->nextRef = nullptr;
 			}
+
 			void* ptr;
 			int id, classIndex;
 			bool isEmbedded;
+			bool isPending;
 			Class* class_;
-			std::vector<COutputStreamSerializer::ObjectMemberGroup> memberGroups;
+			// next object sharing the same address (e.g. an embedded first member)
+			ObjectRef* nextRef;
+
 			bool isThisObject(void* objPtr, Class* objClass, bool objEmbedded) const
 			{
 				if (ptr != objPtr) return false;
@@ -81,18 +64,16 @@ namespace creg {
 		struct ClassRef;
 
 		std::ostream* stream;
-		std::map<void*,std::vector<ObjectRef*> > ptrToId;
+		// first object registered at each address, others are chained via nextRef
+		spring::unsynced_map<void*, ObjectRef*> ptrToId;
 		std::deque<ObjectRef> objects;
-		std::vector<ObjectRef*> pendingObjects; // these objects still have to be saved
-		std::map<Class*, int> classSizes;
-		std::map<Class*, int> classCounts;
-
-		// Serialize all class names
-		void WriteObjectInfo();
-		// Helper for instance/ptr saving
-		void WriteObjectRef(void* inst, Class* cls, bool embedded);
+		std::vector<ObjectRef*> pendingObjects; // these objects still have to be saved (if isPending)
+		// per-class statistics, only collected with debug logging
+		spring::unsynced_map<Class*, int> classSizes;
+		spring::unsynced_map<Class*, int> classCounts;
 
 		ObjectRef* FindObjectRef(void* inst, Class* objClass, bool isEmbedded);
+		ObjectRef* AddObjectRef(void* inst, Class* objClass, bool isEmbedded);
 
 		void SerializeObject(Class* c, void* ptr, ObjectRef* objr);
 
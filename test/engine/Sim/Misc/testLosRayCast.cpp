@@ -0,0 +1,240 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Misc/LosRayCast.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define BOOST_TEST_MODULE LosRayCast
+#include <boost/test/unit_test.hpp>
+
+
+typedef std::vector<int2> LosRay;
+
+// a ray to every square of the upper right sector, including the ones along
+// both axes and the diagonal (same construction as CLosTableHelper::GetRay)
+static std::vector<LosRay> GetRays(int radius)
+{
+	std::vector<LosRay> rays;
+
+	for (int yf = 0; yf <= radius; yf++) {
+		for (int xf = 0; xf <= radius; xf++) {
+			if (xf == 0 && yf == 0)
+				continue;
+
+			LosRay ray;
+
+			if (xf > yf) {
+				const float m = (float) yf / (float) xf;
+				for (int x = 1; x <= xf; x++) {
+					ray.emplace_back(x, int(std::floor(m * x + 0.5f)));
+				}
+			} else {
+				const float m = (float) xf / (float) yf;
+				for (int y = 1; y <= yf; y++) {
+					ray.emplace_back(int(std::floor(m * y + 0.5f)), y);
+				}
+			}
+
+			rays.push_back(std::move(ray));
+		}
+	}
+
+	return rays;
+}
+
+static std::vector<float> GetIsqrtTable(int radius)
+{
+	std::vector<float> table((radius + 1) * (radius + 1) * 2 + 1);
+
+	for (size_t i = 0; i < table.size(); i++) {
+		table[i] = 1.0f / std::sqrt(float(std::max(i, size_t(1))));
+	}
+
+	return table;
+}
+
+// converts heights to angles like CLosMap::UnsafeLosAdd
+static std::vector<float> GetAnglesMap(const std::vector<float>& heights, const std::vector<float>& isqrtTable, int radius, float losHeight)
+{
+	std::vector<float> anglesMap(heights.size(), -1e8);
+
+	for (int y = -radius; y <= radius; y++) {
+		for (int x = -radius; x <= radius; x++) {
+			if (x == 0 && y == 0)
+				continue;
+
+			const size_t idx = LosRayCast::ToAngleMapIdx(int2(x, y), radius);
+			const float dh = std::max(0.0f, heights[idx]) - losHeight;
+
+			anglesMap[idx] = (dh + LOS_BONUS_HEIGHT) * isqrtTable[x * x + y * y];
+		}
+	}
+
+	return anglesMap;
+}
+
+
+enum CastMode {
+	CAST_SCALAR,
+	CAST_SSE,
+	CAST_AVX,
+};
+
+static std::vector<char> CastRays(CastMode mode, const std::vector<LosRay>& rays, const std::vector<float>& anglesMap, const std::vector<float>& isqrtTable, int radius)
+{
+	std::vector<char> squaresMap(anglesMap.size(), true);
+
+	size_t i = 0;
+
+	if (mode == CAST_AVX) {
+		for (; (i + 1) < rays.size(); i += 2) {
+			const int2* pair[2] = {rays[i].data(), rays[i + 1].data()};
+			const size_t numSquares[2] = {rays[i].size(), rays[i + 1].size()};
+
+			LosRayCast::CastLosRayPairAVX(pair, numSquares, squaresMap.data(), anglesMap.data(), isqrtTable.data(), radius);
+		}
+	}
+
+	for (; i < rays.size(); i++) {
+		if (mode == CAST_SCALAR) {
+			LosRayCast::CastLosRay(rays[i].data(), rays[i].size(), squaresMap.data(), anglesMap.data(), isqrtTable.data(), radius);
+		} else {
+			LosRayCast::CastLosRaySSE(rays[i].data(), rays[i].size(), squaresMap.data(), anglesMap.data(), isqrtTable.data(), radius);
+		}
+	}
+
+	return squaresMap;
+}
+
+static void CheckKernels(const std::vector<LosRay>& rays, const std::vector<float>& anglesMap, const std::vector<float>& isqrtTable, int radius)
+{
+	const std::vector<char> scalar = CastRays(CAST_SCALAR, rays, anglesMap, isqrtTable, radius);
+	const std::vector<char> sse = CastRays(CAST_SSE, rays, anglesMap, isqrtTable, radius);
+
+	BOOST_CHECK(sse == scalar);
+
+	if (!LosRayCast::HaveAVX())
+		return;
+
+	const std::vector<char> avx = CastRays(CAST_AVX, rays, anglesMap, isqrtTable, radius);
+
+	BOOST_CHECK(avx == scalar);
+}
+
+
+BOOST_AUTO_TEST_CASE(RandomHeightmaps)
+{
+	std::mt19937 rng(1234);
+
+	for (const int radius: {1, 2, 7, 16, 33}) {
+		const std::vector<float> isqrtTable = GetIsqrtTable(radius);
+
+		std::vector<LosRay> rays = GetRays(radius);
+		std::vector<float> heights((2 * radius + 1) * (2 * radius + 1));
+
+		for (int n = 0; n < 20; n++) {
+			// odd ray counts leave a single ray for the SSE kernel, shuffling
+			// pairs rays of different lengths in the AVX kernel
+			std::shuffle(rays.begin(), rays.end(), rng);
+
+			std::uniform_real_distribution<float> heightDist(-50.0f, 150.0f);
+
+			for (float& h: heights) {
+				h = heightDist(rng);
+			}
+
+			CheckKernels(rays, GetAnglesMap(heights, isqrtTable, radius, heightDist(rng)), isqrtTable, radius);
+
+			// few distinct heights produce many equal angles along a ray
+			std::uniform_int_distribution<int> levelDist(0, 3);
+
+			for (float& h: heights) {
+				h = levelDist(rng) * 10.0f;
+			}
+
+			CheckKernels(rays, GetAnglesMap(heights, isqrtTable, radius, 10.0f), isqrtTable, radius);
+
+			if (rays.size() > 1)
+				rays.pop_back();
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(FlatAndBelowZero)
+{
+	for (const int radius: {1, 5, 24}) {
+		const std::vector<float> isqrtTable = GetIsqrtTable(radius);
+		const std::vector<LosRay> rays = GetRays(radius);
+
+		// flat terrain; heights below zero are clamped to zero (water)
+		for (const float height: {0.0f, -100.0f, 20.0f}) {
+			const std::vector<float> heights((2 * radius + 1) * (2 * radius + 1), height);
+
+			for (const float losHeight: {0.0f, 5.0f, 40.0f, -10.0f}) {
+				CheckKernels(rays, GetAnglesMap(heights, isqrtTable, radius, losHeight), isqrtTable, radius);
+			}
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(BoundaryAngles)
+{
+	// walk each ray and pick every angle relative to its predecessor such that
+	// the comparisons in CastLos hit their boundaries (equal to the previous
+	// angle or to the hilltop derived from it, and one ulp either side)
+	std::mt19937 rng(5678);
+
+	for (const int radius: {3, 12, 31}) {
+		const std::vector<float> isqrtTable = GetIsqrtTable(radius);
+		const std::vector<LosRay> rays = GetRays(radius);
+
+		for (int n = 0; n < 10; n++) {
+			std::vector<float> anglesMap((2 * radius + 1) * (2 * radius + 1), -1e8);
+			std::uniform_int_distribution<int> choiceDist(0, 6);
+
+			for (const LosRay& ray: rays) {
+				float prevAng = 1.0f;
+
+				for (const int2 square: ray) {
+					const float hillAng = prevAng - LOS_BONUS_HEIGHT * isqrtTable[square.x * square.x + square.y * square.y];
+
+					float curAng = prevAng;
+
+					switch (choiceDist(rng)) {
+						case 0: { curAng = prevAng; } break;
+						case 1: { curAng = std::nextafter(prevAng, -1e9f); } break;
+						case 2: { curAng = std::nextafter(prevAng, 1e9f); } break;
+						case 3: { curAng = hillAng; } break;
+						case 4: { curAng = std::nextafter(hillAng, -1e9f); } break;
+						case 5: { curAng = std::nextafter(hillAng, 1e9f); } break;
+						case 6: { curAng = prevAng + 0.5f; } break;
+					}
+
+					// squares shared with other rays keep their first value;
+					// mirrored directions see the same angles as this one
+					const size_t indices[4] = {
+						LosRayCast::ToAngleMapIdx(square, radius),
+						LosRayCast::ToAngleMapIdx(-square, radius),
+						LosRayCast::ToAngleMapIdx(int2(square.y, -square.x), radius),
+						LosRayCast::ToAngleMapIdx(int2(-square.y, square.x), radius),
+					};
+
+					if (anglesMap[indices[0]] == -1e8f) {
+						for (const size_t idx: indices) {
+							anglesMap[idx] = curAng;
+						}
+					}
+
+					prevAng = anglesMap[indices[0]];
+				}
+			}
+
+			CheckKernels(rays, anglesMap, isqrtTable, radius);
+		}
+	}
+}
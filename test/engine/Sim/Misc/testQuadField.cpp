@@ -3,6 +3,8 @@
 #include "Sim/Misc/QuadField.h"
 #include "System/float3.h"
 #include "System/myMath.h"
+#include <algorithm>
+#include <limits>
 #include <stdlib.h>
 #include <time.h>
 
@@ -101,3 +103,84 @@ BOOST_AUTO_TEST_CASE( QuadField )
 
 	BOOST_CHECK_MESSAGE(!fail, "Too less quads returned!");
 }
+
+
+struct TestObject {
+	int id;
+	float radius;
+	float3 pos;
+};
+
+BOOST_AUTO_TEST_CASE( GetObjectsExact )
+{
+	static const int NUM_QUADS = 16;
+	static const int NUM_OBJECTS = 200;
+	static const int TEST_RUNS = 2000;
+
+	// objects overlapping several quads are registered in each of them,
+	// so the batched query has to deduplicate like tempNum does
+	std::vector<TestObject> objects(NUM_OBJECTS);
+	std::vector< std::vector<TestObject*> > quadObjects(NUM_QUADS);
+
+	for (int i = 0; i < NUM_OBJECTS; ++i) {
+		objects[i].id = i * 3; // sparse ids
+		objects[i].radius = randf() * 10.0f;
+		objects[i].pos = float3(randf() * 100.0f, randf() * 20.0f, randf() * 100.0f);
+
+		for (int n = 1 + (rand() % 4); n > 0; --n) {
+			quadObjects[rand() % NUM_QUADS].push_back(&objects[i]);
+		}
+	}
+
+	const auto getQuadObjects = [&](int qi) -> const std::vector<TestObject*>& { return quadObjects[qi]; };
+
+	QuadFieldStamps stamps;
+	std::vector<TestObject*> results;
+	std::vector<TestObject*> expected;
+	std::vector<TestObject*> visited;
+	std::vector<int> quads;
+
+	for (int n = 0; n < TEST_RUNS; ++n) {
+		// exercise the wrap-around of the stamp sequence
+		if (n == TEST_RUNS / 2)
+			stamps.stamp = std::numeric_limits<int>::max() - 5;
+
+		const float3 pos = float3(randf() * 100.0f, randf() * 20.0f, randf() * 100.0f);
+		const float radius = randf() * 30.0f;
+		const bool spherical = (rand() & 1) != 0;
+
+		quads.clear();
+
+		for (int qi = 0; qi < NUM_QUADS; ++qi) {
+			if (randf() < 0.5f)
+				quads.push_back(qi);
+		}
+
+		// reference: first occurrence in quad order, same distance test as GetUnitsExact
+		expected.clear();
+		visited.clear();
+
+		for (const int qi: quads) {
+			for (TestObject* o: quadObjects[qi]) {
+				if (std::find(visited.begin(), visited.end(), o) != visited.end())
+					continue;
+
+				visited.push_back(o);
+
+				const float dstSq = spherical? pos.SqDistance(o->pos): pos.SqDistance2D(o->pos);
+
+				if (dstSq >= Square(radius + o->radius))
+					continue;
+
+				expected.push_back(o);
+			}
+		}
+
+		// results are appended, earlier ones must stay untouched
+		results.assign(1, nullptr);
+		CQuadField::GetObjectsExact(results, stamps, quads, getQuadObjects, pos, radius, spherical);
+
+		BOOST_CHECK(results.front() == nullptr);
+		BOOST_CHECK(std::equal(results.begin() + 1, results.end(), expected.begin(), expected.end()));
+	}
+}
@@ -0,0 +1,61 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Misc/SimObjectHandleTable.h"
+
+#define BOOST_TEST_MODULE SimObjectHandleTable
+#include <boost/test/unit_test.hpp>
+
+
+struct Obj {
+	int value;
+};
+
+
+BOOST_AUTO_TEST_CASE(HandleTableLookup)
+{
+	SimObjectHandleTable<Obj> table;
+	Obj objs[2] = {{1}, {2}};
+
+	table.Resize(4);
+	BOOST_CHECK(table.Size() == 4);
+	BOOST_CHECK(table.IsFree(2));
+	BOOST_CHECK(!table.IsFree(4));
+
+	table.Insert(2, &objs[0]);
+	BOOST_CHECK(!table.IsFree(2));
+	BOOST_CHECK(table.Get(2) == &objs[0]);
+	BOOST_CHECK(table.GetUnsafe(2) == &objs[0]);
+
+	// out-of-range and negative ID's
+	BOOST_CHECK(table.Get(4) == nullptr);
+	BOOST_CHECK(table.Get(-1) == nullptr);
+	BOOST_CHECK(table.GetHandle(4).id == -1);
+}
+
+
+BOOST_AUTO_TEST_CASE(HandleTableRecycle)
+{
+	SimObjectHandleTable<Obj> table;
+	Obj objs[2] = {{1}, {2}};
+
+	table.Resize(4);
+	table.Insert(1, &objs[0]);
+
+	const SimObjectHandle h0 = table.GetHandle(1);
+
+	BOOST_CHECK(table.IsValid(h0));
+	BOOST_CHECK(table.Get(h0) == &objs[0]);
+
+	// reusing the ID must not revive handles to the erased object
+	table.Erase(1);
+	BOOST_CHECK(!table.IsValid(h0));
+
+	table.Insert(1, &objs[1]);
+
+	const SimObjectHandle h1 = table.GetHandle(1);
+
+	BOOST_CHECK(h0 != h1);
+	BOOST_CHECK(table.Get(h0) == nullptr);
+	BOOST_CHECK(table.Get(h1) == &objs[1]);
+	BOOST_CHECK(table.Get(1) == &objs[1]);
+}
@@ -0,0 +1,77 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Misc/SimObjectMemPool.h"
+
+#include <vector>
+
+#define BOOST_TEST_MODULE SimObjectMemPool
+#include <boost/test/unit_test.hpp>
+
+
+struct SmallObj {
+	SmallObj(int v): value(v) {}
+	int value;
+	int dummy;
+};
+
+struct LargeObj: public SmallObj {
+	LargeObj(int v): SmallObj(v) {}
+	unsigned char data[200];
+};
+
+
+BOOST_AUTO_TEST_CASE(DynMemPoolReuse)
+{
+	DynMemPool<sizeof(LargeObj)> pool;
+	std::vector<SmallObj*> objs;
+
+	// span several slabs
+	const size_t numObjs = pool.slab_pages() * 3 + 1;
+
+	for (size_t i = 0; i < numObjs; i++) {
+		if ((i & 1) == 0) {
+			objs.push_back(pool.alloc<SmallObj>(i));
+		} else {
+			objs.push_back(pool.alloc<LargeObj>(i));
+		}
+
+		BOOST_CHECK(pool.alloced(objs.back()));
+		BOOST_CHECK(pool.mapped(objs.back()));
+		BOOST_CHECK((reinterpret_cast<size_t>(objs.back()) & 7) == 0);
+	}
+
+	for (size_t i = 0; i < numObjs; i++) {
+		BOOST_CHECK(objs[i]->value == int(i));
+	}
+
+	BOOST_CHECK(pool.alloc_size() == numObjs * pool.page_size());
+	BOOST_CHECK(pool.freed_size() == 0);
+
+	SmallObj* freed = objs[5];
+	void* freedMem = freed;
+
+	pool.free(objs[5]);
+	BOOST_CHECK(objs[5] == nullptr);
+	BOOST_CHECK(!pool.mapped(freedMem));
+	BOOST_CHECK(pool.freed_size() == pool.page_size());
+
+	// freed page is recycled first and handed out zeroed
+	LargeObj* reused = pool.alloc<LargeObj>(-1);
+	BOOST_CHECK(static_cast<void*>(reused) == freedMem);
+	BOOST_CHECK(pool.freed_size() == 0);
+	BOOST_CHECK(pool.alloc_size() == numObjs * pool.page_size());
+
+	for (unsigned char c: reused->data) {
+		BOOST_CHECK(c == 0);
+	}
+
+	// interior and foreign pointers are never mapped
+	int foreign = 0;
+
+	BOOST_CHECK(!pool.mapped(&foreign));
+	BOOST_CHECK(!pool.mapped(&reused->data[0]));
+
+	pool.clear();
+	BOOST_CHECK(pool.alloc_size() == 0);
+	BOOST_CHECK(!pool.mapped(freedMem));
+}
@@ -0,0 +1,94 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Path/Default/PathEstimatorCache.h"
+#include "System/FileSystem/MemoryMappedFile.h"
+
+#include <cstdio>
+#include <fstream>
+
+#define BOOST_TEST_MODULE PathEstimatorCache
+#include <boost/test/unit_test.hpp>
+
+
+static constexpr std::uint32_t NUM_BLOCKS = 37;
+static constexpr std::uint32_t NUM_PATH_TYPES = 3;
+static constexpr std::uint32_t NUM_VERTICES = 4;
+
+struct PathData {
+	PathData(): nodeOffsets(NUM_PATH_TYPES, std::vector<short2>(NUM_BLOCKS)), vertexCosts(NUM_PATH_TYPES * NUM_BLOCKS * NUM_VERTICES, 0.0f) {}
+
+	void Fill() {
+		for (std::uint32_t pathType = 0; pathType < NUM_PATH_TYPES; ++pathType) {
+			for (std::uint32_t block = 0; block < NUM_BLOCKS; ++block) {
+				nodeOffsets[pathType][block] = short2(pathType * 100 + block, -int(block));
+			}
+		}
+		for (size_t n = 0; n < vertexCosts.size(); ++n) {
+			vertexCosts[n] = n * 0.25f;
+		}
+	}
+
+	std::vector< std::vector<short2> > nodeOffsets;
+	std::vector<float> vertexCosts;
+};
+
+
+BOOST_AUTO_TEST_CASE(PathEstimatorCacheRoundTrip)
+{
+	const CPathEstimatorCache cache(0x1234abcd, 16, NUM_BLOCKS, NUM_PATH_TYPES, NUM_VERTICES);
+
+	PathData src;
+	PathData dst;
+	src.Fill();
+
+	std::vector<std::uint8_t> buffer;
+	cache.Write(buffer, src.nodeOffsets, src.vertexCosts);
+	BOOST_CHECK(buffer.size() == cache.GetSize());
+	BOOST_CHECK((buffer.size() % CPathEstimatorCache::ALIGNMENT) == 0);
+
+	// go through a mapped file, as CPathEstimator::ReadFile does
+	const char* filePath = "testPathEstimatorCache.pecache";
+	{
+		std::ofstream ofs(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+		ofs.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	}
+	{
+		const CMemoryMappedFile file(filePath);
+
+		BOOST_CHECK(file.IsOpen());
+		BOOST_CHECK(cache.Read(file.GetData(), file.GetSize(), dst.nodeOffsets, dst.vertexCosts));
+	}
+
+	std::remove(filePath);
+
+	BOOST_CHECK(dst.nodeOffsets == src.nodeOffsets);
+	BOOST_CHECK(dst.vertexCosts == src.vertexCosts);
+}
+
+BOOST_AUTO_TEST_CASE(PathEstimatorCacheRejects)
+{
+	const CPathEstimatorCache cache(0x1234abcd, 16, NUM_BLOCKS, NUM_PATH_TYPES, NUM_VERTICES);
+
+	PathData src;
+	PathData dst;
+	src.Fill();
+
+	std::vector<std::uint8_t> buffer;
+	cache.Write(buffer, src.nodeOffsets, src.vertexCosts);
+
+	// different estimator parameters
+	BOOST_CHECK(!CPathEstimatorCache(0x1234abce, 16, NUM_BLOCKS, NUM_PATH_TYPES, NUM_VERTICES).Read(buffer.data(), buffer.size(), dst.nodeOffsets, dst.vertexCosts));
+	BOOST_CHECK(!CPathEstimatorCache(0x1234abcd, 32, NUM_BLOCKS, NUM_PATH_TYPES, NUM_VERTICES).Read(buffer.data(), buffer.size(), dst.nodeOffsets, dst.vertexCosts));
+	BOOST_CHECK(!CPathEstimatorCache(0x1234abcd, 16, NUM_BLOCKS, NUM_PATH_TYPES - 1, NUM_VERTICES).Read(buffer.data(), buffer.size(), dst.nodeOffsets, dst.vertexCosts));
+
+	// truncated data
+	BOOST_CHECK(!cache.Read(buffer.data(), buffer.size() - 1, dst.nodeOffsets, dst.vertexCosts));
+	BOOST_CHECK(!cache.Read(nullptr, 0, dst.nodeOffsets, dst.vertexCosts));
+
+	// corrupted payload
+	buffer.back() ^= 0xFF;
+	BOOST_CHECK(!cache.Read(buffer.data(), buffer.size(), dst.nodeOffsets, dst.vertexCosts));
+
+	// nothing was copied out of rejected data
+	BOOST_CHECK(dst.vertexCosts == std::vector<float>(dst.vertexCosts.size(), 0.0f));
+}
@@ -0,0 +1,147 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/LoadSave/DemoReader.h"
+#include "System/Net/RawPacket.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_MODULE DemoReader
+#include <boost/test/unit_test.hpp>
+
+
+static const char* DEMO_NAME = "testDemoReader.sdfz";
+static const std::string SCRIPT = "[game]\n{\n}\n";
+
+// time far past every chunk, GetData then returns them one by one
+static constexpr float READ_TIME = 1e6f;
+
+
+// writes a demo with one chunk per packet; the stream is followed by
+// a few bytes of stats unless <crashed> is set, in which case the stream
+// size is left at zero as by a recorder that did not finish the demo
+static int WriteDemo(const std::vector<std::string>& packets, bool crashed)
+{
+	DemoFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, DEMOFILE_MAGIC, sizeof(header.magic));
+
+	header.version = DEMOFILE_VERSION;
+	header.headerSize = sizeof(header);
+	header.scriptSize = SCRIPT.size();
+	header.playerStatElemSize = sizeof(PlayerStatistics);
+	header.teamStatElemSize = sizeof(TeamStatistics);
+
+	std::string stream;
+
+	for (size_t i = 0; i < packets.size(); i++) {
+		DemoStreamChunkHeader chunkHeader;
+		chunkHeader.modGameTime = i * 0.5f;
+		chunkHeader.length = packets[i].size();
+		chunkHeader.swab();
+
+		stream.append(reinterpret_cast<const char*>(&chunkHeader), sizeof(chunkHeader));
+		stream.append(packets[i]);
+	}
+
+	if (!crashed)
+		header.demoStreamSize = stream.size();
+
+	header.winningAllyTeamsSize = 1 - crashed;
+	header.swab();
+
+	std::ofstream file(DEMO_NAME, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(SCRIPT.data(), SCRIPT.size());
+	file.write(stream.data(), stream.size());
+
+	// stats, looks like a chunk header of a large packet
+	if (!crashed)
+		file.write("\x00\x00\x80\x3f\xff\xff\x00\x00", 8);
+
+	return (sizeof(header) + SCRIPT.size() + stream.size());
+}
+
+static std::vector<std::string> ReadPackets(CDemoReader& reader, std::vector<int>* streamPositions = nullptr)
+{
+	std::vector<std::string> packets;
+
+	if (streamPositions != nullptr)
+		streamPositions->push_back(reader.GetStreamPos());
+
+	while (!reader.ReachedEnd()) {
+		netcode::RawPacket* packet = reader.GetData(READ_TIME);
+
+		if (packet == nullptr)
+			break;
+
+		packets.emplace_back(reinterpret_cast<const char*>(packet->data), packet->length);
+		delete packet;
+
+		if (streamPositions != nullptr)
+			streamPositions->push_back(reader.GetStreamPos());
+	}
+
+	// nothing is returned past the end
+	BOOST_CHECK(reader.GetData(READ_TIME) == nullptr);
+	return packets;
+}
+
+
+static void CheckSeeking(bool crashed)
+{
+	const std::vector<std::string> packets = {"first", "", "third packet", std::string(300, 'x'), "last"};
+
+	const int streamBeg = sizeof(DemoFileHeader) + SCRIPT.size();
+	const int streamEnd = WriteDemo(packets, crashed);
+
+	std::vector<int> streamPositions;
+
+	{
+		CDemoReader reader(DEMO_NAME, 0.0f);
+
+		BOOST_CHECK(ReadPackets(reader, &streamPositions) == packets);
+		BOOST_CHECK(reader.ReachedEnd());
+	}
+
+	BOOST_REQUIRE_EQUAL(streamPositions.size(), packets.size() + 1);
+	BOOST_CHECK_EQUAL(streamPositions.front(), streamBeg);
+	// after the last packet the position is the end of the stream, which
+	// is where a keyframe taken after the last frame has to resume from
+	BOOST_CHECK_EQUAL(streamPositions.back(), streamEnd);
+
+	for (size_t i = 0; i < streamPositions.size(); i++) {
+		CDemoReader reader(DEMO_NAME, 0.0f);
+
+		BOOST_CHECK(reader.SeekToStreamPos(streamPositions[i], 10.0f));
+		BOOST_CHECK_EQUAL(reader.GetStreamPos(), streamPositions[i]);
+
+		const std::vector<std::string> remaining(packets.begin() + i, packets.end());
+
+		BOOST_CHECK(ReadPackets(reader) == remaining);
+		BOOST_CHECK_EQUAL(reader.GetStreamPos(), streamEnd);
+	}
+
+	{
+		CDemoReader reader(DEMO_NAME, 0.0f);
+
+		BOOST_CHECK(!reader.SeekToStreamPos(streamBeg - 1, 0.0f));
+		BOOST_CHECK(!reader.SeekToStreamPos(streamEnd + 1, 0.0f));
+	}
+
+	std::remove(DEMO_NAME);
+}
+
+
+BOOST_AUTO_TEST_CASE(SeekFinishedDemo)
+{
+	CheckSeeking(false);
+}
+
+BOOST_AUTO_TEST_CASE(SeekCrashedDemo)
+{
+	CheckSeeking(true);
+}
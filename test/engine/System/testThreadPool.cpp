@@ -146,6 +146,21 @@ BOOST_AUTO_TEST_CASE( test_nested_for_mt )
 	});
 }
 
+BOOST_AUTO_TEST_CASE( test_enqueue_then )
+{
+	LOG("[%s::test_enqueue_then]", __func__);
+
+	std::atomic<int> order(0);
+
+	auto fut = ThreadPool::EnqueueThen(
+		[&]() { return (++order) * 20; },
+		[&](std::shared_ptr<std::future<int>> antecedent) { SAFE_BOOST_CHECK(order == 1); return (antecedent->get() + (++order)); }
+	);
+
+	BOOST_CHECK(fut->get() == 22);
+	BOOST_CHECK(order == 2);
+}
+
 BOOST_AUTO_TEST_CASE( test_nested_parallel )
 {
 	#if 0
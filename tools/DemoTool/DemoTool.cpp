@@ -5,7 +5,9 @@
 #include <iostream>
 #include <gflags/gflags.h>
 #include <iomanip> //hex
+#include <thread>
 
+#include "ReplayFarm.h"
 #include "StringSerializer.h"
 
 #include "Net/Protocol/BaseNetProtocol.h"
@@ -17,6 +19,13 @@
 Usage:
 Start with the full! path to the demofile as the only argument
 
+Batch replay: --replaydir <dir> --engine <path/to/spring-headless>
+replays all demos in <dir> with --jobs parallel engine processes and
+prints a CSV line per demo (exit code, timing, sync checksum).
+Start scripts are parsed with the base content, so demotool has to
+find the spring data-dirs too; engine write-dirs and the caches they
+share are kept in <logdir>/replayfarm.
+
 Please note that not all NETMSG's are implemented, expand if needed.
 
 When compiling for windows with MinGW, make sure to use the
@@ -33,6 +42,13 @@ no console output (you still could use this.exe > z.tzt though).
 	DEFINE_int32 (team,         -1,    "Select team");
 	DEFINE_string(teamsstatcsv, "",    "Write teamstats in a csv file");
 
+	DEFINE_string(replaydir,    "",    "Replay all demos in this directory (batch mode)");
+	DEFINE_string(engine,       "",    "Batch mode: path to the spring-headless executable");
+	DEFINE_string(springcfg,    "",    "Batch mode: engine config file (default: HeadlessFastSim = 1)");
+	DEFINE_string(logdir,       "",    "Batch mode: directory for per-demo engine logs (default: replaydir)");
+	DEFINE_string(results,      "",    "Batch mode: write results to this csv file instead of stdout");
+	DEFINE_int32 (jobs,         0,     "Batch mode: number of parallel engine processes (0: one per core)");
+
 
 void TrafficDump(CDemoReader& reader, bool trafficStats);
 void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string& file);
@@ -43,6 +59,24 @@ int main (int argc, char* argv[])
 
 	gflags::SetUsageMessage(std::string("Usage: ") + argv[0] + " [options] path_to_demo.sdfz");
 	gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+	if (!FLAGS_replaydir.empty()) {
+		if (FLAGS_engine.empty()) {
+			std::cout << "replaydir requires an engine executable" << std::endl;
+			exit(1);
+		}
+
+		ReplayFarmOptions options;
+		options.demoDir = FLAGS_replaydir;
+		options.engine = FLAGS_engine;
+		options.configFile = FLAGS_springcfg;
+		options.logDir = FLAGS_logdir;
+		options.results = FLAGS_results;
+		options.numJobs = (FLAGS_jobs > 0)? FLAGS_jobs: std::max(1u, std::thread::hardware_concurrency());
+
+		return (RunReplayFarm(options) != 0);
+	}
+
 	if (!FLAGS_demofile.empty()) {
 		filename = FLAGS_demofile;
 	} else if (argc >= 2) {
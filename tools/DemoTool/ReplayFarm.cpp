@@ -0,0 +1,435 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "ReplayFarm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+	#include "System/Platform/Win/win32.h"
+#else
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
+
+#include "System/StringUtil.h"
+#include "System/TdfParser.h"
+#include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirLocater.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/FileSystemAbstraction.h"
+#include "System/FileSystem/FileSystemInitializer.h"
+#include "System/LoadSave/DemoReader.h"
+#include "System/Misc/SpringTime.h"
+
+
+struct ReplayJob {
+	std::string demoFile;
+	std::string mapName;
+	std::string logFile;
+
+	int exitCode = -1;
+	int numFrames = -1;
+	int numDesyncWarnings = 0;
+
+	float wallSecs = 0.0f;
+	float framesPerSec = 0.0f;
+
+	std::string syncChecksum;
+};
+
+// Every worker runs the engine with its own write-dir, so no two engines
+// ever write the same infolog or cache file. The caches they would all
+// build are kept in a shared directory which workers never write to:
+// demotool fills it with the archive cache while scanning archives for
+// the start scripts, path estimator caches written by a worker are copied
+// in once the worker is done with them.
+struct ReplayCache {
+	std::string sharedDir;
+	std::string cacheDir; ///< relative to a data-dir, see FileSystem::GetCacheDir
+
+	std::mutex mutex;
+};
+
+
+static std::string GetMapName(const std::string& demoFile)
+{
+	try {
+		CDemoReader reader(demoFile, 0.0f);
+
+		const std::string& script = reader.GetSetupScript();
+		const TdfParser parser(script.c_str(), script.size());
+
+		// see CGameSetup::Init
+		return (parser.SGetValueDef("", "GAME\\MapName"));
+	} catch (const std::exception& ex) {
+		std::cerr << "[ReplayFarm] could not read " << demoFile << ": " << ex.what() << std::endl;
+	}
+
+	return "";
+}
+
+static std::string ShellQuote(const std::string& s) { return ("\"" + s + "\""); }
+
+// fields with separators, quotes or line breaks are quoted and their quotes doubled (RFC 4180)
+static std::string CSVField(const std::string& s)
+{
+	if (s.find_first_of(",\"\r\n") == std::string::npos)
+		return s;
+
+	std::string field = "\"";
+
+	for (const char c: s) {
+		if (c == '"')
+			field += c;
+
+		field += c;
+	}
+
+	return (field + "\"");
+}
+
+// the filesystem initialization changes the working directory
+static std::string GetAbsolutePath(const std::string& path)
+{
+	if (path.empty() || FileSystemAbstraction::IsAbsolutePath(path))
+		return path;
+
+	return (FileSystemAbstraction::EnsurePathSepAtEnd(FileSystemAbstraction::GetCwd()) + path);
+}
+
+
+static bool CopyCacheFile(const std::string& srcPath, const std::string& dstPath)
+{
+	std::ifstream src(srcPath.c_str(), std::ios::in | std::ios::binary);
+	std::ofstream dst(dstPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!src.is_open() || !dst.is_open())
+		return false;
+
+	dst << src.rdbuf();
+	return (dst.good());
+}
+
+// the engine replaces path estimator caches by renaming a new file over them,
+// so a hard link never lets it write into the shared copy; falls back to a
+// plain copy where links are not supported
+static bool LinkCacheFile(const std::string& srcPath, const std::string& dstPath)
+{
+#ifdef _WIN32
+	if (CreateHardLinkA(dstPath.c_str(), srcPath.c_str(), nullptr) != 0)
+		return true;
+#else
+	if (link(srcPath.c_str(), dstPath.c_str()) == 0)
+		return true;
+#endif
+
+	return (CopyCacheFile(srcPath, dstPath));
+}
+
+// copies <srcPath> to the shared cache unless it is already there; readers
+// only ever see complete files
+static void PublishCacheFile(const std::string& srcPath, const std::string& dstPath)
+{
+	if (FileSystem::FileExists(dstPath))
+		return;
+
+	const std::string tmpPath = dstPath + ".tmp";
+
+	if (CopyCacheFile(srcPath, tmpPath) && std::rename(tmpPath.c_str(), dstPath.c_str()) == 0)
+		return;
+
+	FileSystem::Remove(tmpPath);
+}
+
+
+static std::string GetPathCacheDir(const ReplayCache& cache) { return (cache.cacheDir + "/paths/"); }
+
+// the engine reads its archive cache only from the write-dir and rewrites
+// it in place, so every worker gets a copy before its first replay
+static void SeedWorkerArchiveCache(ReplayCache& cache, const std::string& workerDir)
+{
+	std::vector<std::string> files;
+	std::lock_guard<std::mutex> lck(cache.mutex);
+
+	FileSystem::CreateDirectory(workerDir + GetPathCacheDir(cache));
+	FileSystemAbstraction::FindFiles(files, cache.sharedDir, cache.cacheDir + "/", "ArchiveCache.*\\.lua", 0);
+
+	for (const std::string& file: files) {
+		CopyCacheFile(cache.sharedDir + file, workerDir + file);
+	}
+}
+
+static void SeedWorkerPathCaches(ReplayCache& cache, const std::string& workerDir)
+{
+	std::vector<std::string> files;
+	std::lock_guard<std::mutex> lck(cache.mutex);
+
+	FileSystemAbstraction::FindFiles(files, cache.sharedDir, GetPathCacheDir(cache), ".*\\.pecache", 0);
+
+	for (const std::string& file: files) {
+		if (FileSystem::FileExists(workerDir + file))
+			continue;
+
+		LinkCacheFile(cache.sharedDir + file, workerDir + file);
+	}
+}
+
+static void PublishWorkerPathCaches(ReplayCache& cache, const std::string& workerDir)
+{
+	std::vector<std::string> files;
+	std::lock_guard<std::mutex> lck(cache.mutex);
+
+	FileSystem::CreateDirectory(cache.sharedDir + GetPathCacheDir(cache));
+	FileSystemAbstraction::FindFiles(files, workerDir, GetPathCacheDir(cache), ".*\\.pecache", 0);
+
+	for (const std::string& file: files) {
+		PublishCacheFile(workerDir + file, cache.sharedDir + file);
+	}
+}
+
+static int RunProcess(const std::string& cmd)
+{
+#ifdef _WIN32
+	// cmd.exe strips the outermost pair of quotes
+	return std::system(ShellQuote(cmd).c_str());
+#else
+	const int status = std::system(cmd.c_str());
+
+	if (status == -1 || !WIFEXITED(status))
+		return -1;
+
+	return WEXITSTATUS(status);
+#endif
+}
+
+static void ParseEngineLog(ReplayJob& job)
+{
+	std::ifstream log(job.logFile.c_str());
+	std::string line;
+
+	// see CGame::PrintSimThroughput
+	static const std::string throughputTag = "[Game::PrintSimThroughput] simulated ";
+	static const std::string checksumTag = "[Game::PrintSimThroughput] sync checksum ";
+	static const std::string desyncTag = "[DESYNC WARNING]";
+
+	while (std::getline(log, line)) {
+		size_t pos;
+
+		if ((pos = line.find(throughputTag)) != std::string::npos) {
+			float simSecs = 0.0f;
+			float wallSecs = 0.0f;
+
+			std::sscanf(line.c_str() + pos + throughputTag.size(), "%d frames (%fs) in %fs wall-clock time: %f frames/s", &job.numFrames, &simSecs, &wallSecs, &job.framesPerSec);
+			continue;
+		}
+		if ((pos = line.find(checksumTag)) != std::string::npos) {
+			unsigned int checksum = 0;
+
+			// engines built without SYNCCHECK do not compute one
+			if (std::sscanf(line.c_str() + pos + checksumTag.size(), "%8x", &checksum) == 1) {
+				job.syncChecksum = line.substr(pos + checksumTag.size(), 8);
+			} else {
+				job.syncChecksum = "n/a";
+			}
+			continue;
+		}
+
+		job.numDesyncWarnings += (line.find(desyncTag) != std::string::npos);
+	}
+}
+
+static void RunJob(const ReplayFarmOptions& options, const std::string& workerDir, ReplayJob& job)
+{
+	std::string cmd = ShellQuote(options.engine);
+
+	if (!options.configFile.empty())
+		cmd += " --config " + ShellQuote(options.configFile);
+
+	cmd += " --write-dir " + ShellQuote(workerDir);
+
+	cmd += " " + ShellQuote(job.demoFile);
+	cmd += " > " + ShellQuote(job.logFile) + " 2>&1";
+
+	const auto t0 = std::chrono::steady_clock::now();
+
+	job.exitCode = RunProcess(cmd);
+	job.wallSecs = std::chrono::duration<float>(std::chrono::steady_clock::now() - t0).count();
+
+	ParseEngineLog(job);
+}
+
+static void RunJobs(const ReplayFarmOptions& options, const std::vector<std::string>& workerDirs, ReplayCache& cache, std::vector<ReplayJob*>& jobs)
+{
+	std::atomic<size_t> nextJob(0);
+	std::mutex logMutex;
+	std::vector<std::thread> workers;
+
+	const auto worker = [&](unsigned int workerNum) {
+		const std::string& workerDir = workerDirs[workerNum];
+
+		size_t n;
+
+		while ((n = nextJob++) < jobs.size()) {
+			SeedWorkerPathCaches(cache, workerDir);
+			RunJob(options, workerDir, *jobs[n]);
+			PublishWorkerPathCaches(cache, workerDir);
+
+			std::lock_guard<std::mutex> lck(logMutex);
+			std::cerr << "[ReplayFarm] " << jobs[n]->demoFile << ": exit=" << jobs[n]->exitCode << " time=" << jobs[n]->wallSecs << "s" << std::endl;
+		}
+	};
+
+	for (unsigned int i = 1; i < std::min(size_t(options.numJobs), jobs.size()); i++) {
+		workers.emplace_back(worker, i);
+	}
+
+	worker(0);
+
+	for (std::thread& t: workers) {
+		t.join();
+	}
+}
+
+
+int RunReplayFarm(const ReplayFarmOptions& options)
+{
+	std::vector<std::string> demoFiles;
+	std::vector<ReplayJob> jobs;
+
+	const std::string demoDir = FileSystemAbstraction::EnsurePathSepAtEnd(GetAbsolutePath(options.demoDir));
+	const std::string logDir = FileSystemAbstraction::EnsurePathSepAtEnd(options.logDir.empty()? demoDir: GetAbsolutePath(options.logDir));
+	const std::string workDir = logDir + "replayfarm/";
+
+	FileSystemAbstraction::FindFiles(demoFiles, demoDir, "", ".*\\.sdfz", FileQueryFlags::RECURSE);
+	std::sort(demoFiles.begin(), demoFiles.end());
+
+	if (demoFiles.empty()) {
+		std::cerr << "[ReplayFarm] no demos found in " << demoDir << std::endl;
+		return 0;
+	}
+	if (!FileSystem::CreateDirectory(logDir)) {
+		std::cerr << "[ReplayFarm] can not create log directory " << logDir << std::endl;
+		return demoFiles.size();
+	}
+
+	// workers always run with HeadlessFastSim unless told otherwise
+	ReplayFarmOptions jobOptions = options;
+
+	jobOptions.configFile = GetAbsolutePath(options.configFile);
+	jobOptions.results = GetAbsolutePath(options.results);
+
+	// a bare executable name is looked up in PATH
+	if (options.engine.find_first_of("/\\") != std::string::npos)
+		jobOptions.engine = GetAbsolutePath(options.engine);
+
+	if (jobOptions.configFile.empty()) {
+		jobOptions.configFile = logDir + "replayfarm.cfg";
+
+		std::ofstream cfg(jobOptions.configFile.c_str());
+		cfg << "HeadlessFastSim = 1" << std::endl;
+	}
+
+	ReplayCache cache;
+	cache.sharedDir = workDir + "shared/";
+	cache.cacheDir = FileSystem::GetCacheDir();
+
+	std::vector<std::string> workerDirs(std::max(1u, options.numJobs));
+
+	for (size_t i = 0; i < workerDirs.size(); i++) {
+		workerDirs[i] = workDir + "worker" + IntToString(i) + "/";
+	}
+
+	// TdfParser needs the base content, the scan also writes the archive cache
+	// the workers start from into the shared dir (when the scanner is deleted)
+	spring_clock::PushTickRate(false);
+	spring_time::setstarttime(spring_time::gettime(true));
+
+	dataDirLocater.SetWriteDir(cache.sharedDir);
+
+	try {
+		// errors are rethrown as in unitsync
+		FileSystemInitializer::PreInitializeConfigHandler(jobOptions.configFile);
+		FileSystemInitializer::Initialize();
+	} catch (const std::exception& ex) {
+		std::cerr << "[ReplayFarm] can not initialize the filesystem: " << ex.what() << std::endl;
+		return demoFiles.size();
+	}
+
+	if (archiveScanner->GetArchiveData(CArchiveScanner::GetSpringBaseContentName()).IsEmpty()) {
+		std::cerr << "[ReplayFarm] base content not found in the data-dirs" << std::endl;
+		FileSystemInitializer::Cleanup();
+		return demoFiles.size();
+	}
+
+	jobs.resize(demoFiles.size());
+
+	for (size_t n = 0; n < demoFiles.size(); n++) {
+		std::string logName = demoFiles[n] + ".log";
+		std::replace(logName.begin(), logName.end(), '/', '_');
+		std::replace(logName.begin(), logName.end(), '\\', '_');
+
+		jobs[n].demoFile = demoDir + demoFiles[n];
+		jobs[n].mapName = GetMapName(jobs[n].demoFile);
+		jobs[n].logFile = logDir + logName;
+	}
+
+	FileSystemInitializer::Cleanup();
+
+	for (const std::string& workerDir: workerDirs) {
+		SeedWorkerArchiveCache(cache, workerDir);
+	}
+
+	// phase 1: one demo per map (generates the shared caches), phase 2: the rest
+	std::map<std::string, ReplayJob*> firstJobPerMap;
+	std::vector<ReplayJob*> phaseJobs[2];
+
+	for (ReplayJob& job: jobs) {
+		const auto it = firstJobPerMap.find(job.mapName);
+
+		if (it == firstJobPerMap.end()) {
+			firstJobPerMap[job.mapName] = &job;
+			phaseJobs[0].push_back(&job);
+		} else {
+			phaseJobs[1].push_back(&job);
+		}
+	}
+
+	std::cerr << "[ReplayFarm] replaying " << jobs.size() << " demos (" << phaseJobs[0].size() << " maps) with " << options.numJobs << " workers" << std::endl;
+
+	RunJobs(jobOptions, workerDirs, cache, phaseJobs[0]);
+	RunJobs(jobOptions, workerDirs, cache, phaseJobs[1]);
+
+	std::ofstream resultFile;
+
+	if (!jobOptions.results.empty())
+		resultFile.open(jobOptions.results.c_str());
+
+	std::ostream& out = resultFile.is_open()? static_cast<std::ostream&>(resultFile): std::cout;
+
+	int numFailed = 0;
+
+	out << "demo,map,exitcode,seconds,frames,fps,syncchecksum,desyncwarnings" << std::endl;
+
+	for (const ReplayJob& job: jobs) {
+		out << CSVField(job.demoFile) << "," << CSVField(job.mapName) << "," << job.exitCode << ",";
+		out << job.wallSecs << "," << job.numFrames << "," << job.framesPerSec << ",";
+		out << CSVField(job.syncChecksum) << "," << job.numDesyncWarnings << std::endl;
+
+		numFailed += (job.exitCode != 0 || job.numDesyncWarnings > 0);
+	}
+
+	return numFailed;
+}
@@ -0,0 +1,35 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef REPLAY_FARM_H
+#define REPLAY_FARM_H
+
+#include <string>
+
+struct ReplayFarmOptions {
+	std::string demoDir;    ///< directory scanned (recursively) for demos
+	std::string engine;     ///< path to the spring-headless binary
+	std::string configFile; ///< engine config used by all workers
+	std::string logDir;     ///< where per-demo engine output is stored
+	std::string results;    ///< CSV output file, stdout if empty
+
+	unsigned int numJobs;
+};
+
+/**
+ * Replays every demo found in <demoDir> with a pool of spring-headless
+ * worker processes and writes one CSV line per demo (exit code, timing,
+ * sync checksum or n/a for engines built without SYNCCHECK, desync
+ * warnings); text fields are quoted as in RFC 4180 where needed.
+ *
+ * Every worker has its own engine write-dir below <logDir>/replayfarm;
+ * the archive cache and path estimator caches are shared read-only
+ * between them, and the first demo of every map is replayed before
+ * any other demo of the same map, to keep concurrent workers from all
+ * rebuilding the same caches. Start scripts are parsed with TdfParser,
+ * which needs the base content in the spring data-dirs.
+ *
+ * @return number of demos that failed or desynced
+ */
+int RunReplayFarm(const ReplayFarmOptions& options);
+
+#endif // REPLAY_FARM_H